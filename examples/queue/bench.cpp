@@ -0,0 +1,132 @@
+/*
+ * Compares the cost of dispatching the events of an M/M/1 queue
+ * with the different kinds of event: a class derived from Event
+ * (as in queue.hpp), GEvent, StaticEvent and FunctionEvent.
+ *
+ * Usage: queue_bench [length]
+ */
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include <metasim.hpp>
+
+using namespace std;
+using namespace MetaSim;
+
+/**
+ * An M/M/1 queue with its source. The events are created outside,
+ * so that the same model is used with all kinds of event.  */
+class MM1 : public Entity {
+        RandomVar &_at;
+        RandomVar &_st;
+        Event *_arrEvt;
+        Event *_servEvt;
+        int _size;
+public:
+        unsigned long served;
+
+        MM1(RandomVar &at, RandomVar &st) :
+                Entity("mm1"), _at(at), _st(st), _arrEvt(0), _servEvt(0),
+                _size(0), served(0)
+        {
+        }
+
+        void setEvents(Event *arr, Event *serv)
+        {
+                _arrEvt = arr;
+                _servEvt = serv;
+        }
+
+        void onArrival(Event *)
+        {
+                if (++_size == 1)
+                        _servEvt->post(SIMUL.getTime() + Tick(_st.get()));
+                _arrEvt->post(SIMUL.getTime() + Tick(_at.get()));
+        }
+
+        void onService(Event *)
+        {
+                served++;
+                if (--_size > 0)
+                        _servEvt->post(SIMUL.getTime() + Tick(_st.get()));
+        }
+
+        virtual void newRun()
+        {
+                _size = 0;
+                served = 0;
+                _arrEvt->post(Tick(_at.get()));
+        }
+        virtual void endRun() {}
+};
+
+class ArrivalEvent : public Event {
+        MM1 &_q;
+public:
+        ArrivalEvent(MM1 &q) : Event(), _q(q) {}
+        virtual void doit() { _q.onArrival(this); }
+};
+
+class ServiceEvent : public Event {
+        MM1 &_q;
+public:
+        ServiceEvent(MM1 &q) : Event(_DEFAULT_PRIORITY - 1), _q(q) {}
+        virtual void doit() { _q.onService(this); }
+};
+
+enum Kind { DERIVED, GENERIC, STATIC, FUNCTION };
+
+static const char *names[] = { "Event subclass", "GEvent",
+                               "StaticEvent", "FunctionEvent" };
+
+static void bench(Kind k, Tick length)
+{
+        Simulation sim;
+        SimulationContext::Scope scope(sim);
+        RandomGen gen(1);
+        ExponentialVar at(8, &gen);
+        ExponentialVar st(4, &gen);
+        MM1 q(at, st);
+
+        ArrivalEvent derArr(q);
+        ServiceEvent derServ(q);
+        GEvent<MM1> genArr, genServ(Event::_DEFAULT_PRIORITY - 1);
+        register_handler(genArr, &q, &MM1::onArrival);
+        register_handler(genServ, &q, &MM1::onService);
+        StaticEvent<MM1, &MM1::onArrival> statArr(&q);
+        StaticEvent<MM1, &MM1::onService> statServ(&q, Event::_DEFAULT_PRIORITY - 1);
+        FunctionEvent funArr([&q] (Event *e) { q.onArrival(e); });
+        FunctionEvent funServ([&q] (Event *e) { q.onService(e); },
+                              Event::_DEFAULT_PRIORITY - 1);
+
+        switch (k) {
+        case DERIVED:  q.setEvents(&derArr, &derServ); break;
+        case GENERIC:  q.setEvents(&genArr, &genServ); break;
+        case STATIC:   q.setEvents(&statArr, &statServ); break;
+        case FUNCTION: q.setEvents(&funArr, &funServ); break;
+        }
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        sim.initRuns(1);
+        sim.initSingleRun();
+        sim.run_to(length);
+        chrono::duration<double> d = chrono::steady_clock::now() - start;
+        unsigned long served = q.served;
+        sim.endSingleRun();
+
+        cout << names[k] << ": " << served << " packets served in "
+             << d.count() << " s, "
+             << 1e9 * d.count() / (2.0 * served) << " ns/event" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+        Tick length = 20000000;
+        if (argc > 1) length = Tick(atol(argv[1]));
+
+        bench(DERIVED, length);
+        bench(GENERIC, length);
+        bench(STATIC, length);
+        bench(FUNCTION, length);
+}
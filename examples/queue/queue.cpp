@@ -32,6 +32,8 @@ int main()
 
         AvgQueueSizeStat avgSizeStat(que, "avg_queue_size");
         avgSizeStat.attach(&source);
+        TimeAvgQueueSizeStat timeAvgSizeStat(que, "time_avg_queue_size");
+        timeAvgSizeStat.attach(&source);
 
         BaseStat::setTransitory(2000);
   
@@ -44,4 +46,8 @@ int main()
              << avgSizeStat.getMean() << endl;
         cout << "with a 95% confidence interval of " 
              << avgSizeStat.getConfInterval(BaseStat::C95) << endl;
+        cout << "The time average of the queue length is " 
+             << timeAvgSizeStat.getMean() << endl;
+        cout << "with a 95% confidence interval of " 
+             << timeAvgSizeStat.getConfInterval(BaseStat::C95) << endl;
 }//end main
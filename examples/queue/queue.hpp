@@ -214,3 +214,26 @@ public:
                                                                          this);
         }
 };
+
+/**
+ * The average queue length weighted by time: the length is recorded
+ * every time it changes, that is after every arrival and every
+ * departure. */
+class TimeAvgQueueSizeStat : public StatTimeAverage {
+        Queue &_queue;
+public:
+        TimeAvgQueueSizeStat(Queue &q, const char *n) :
+                StatTimeAverage(n),
+                _queue(q)
+        {
+        }
+
+        void probe(Source::ProduceEvent &/*e*/) { record(_queue.getSize()); }
+        void probe(Queue::ServiceEvent &/*e*/) { record(_queue.getSize()); }
+
+        void attach(Source *n)
+        {
+                new Particle<Source::ProduceEvent,TimeAvgQueueSizeStat>(&n->_prodEvent, this);
+                new Particle<Queue::ServiceEvent,TimeAvgQueueSizeStat>(&_queue._servEvent, this);
+        }
+};
@@ -37,6 +37,7 @@ WifiInterface::WifiInterface(const std::string &name, double radius, Node * n) :
   register_handler(_wait_for_backoff_evt, this, &WifiInterface::onBackoffTimeElapsed);
 
   _wifiTrace = nullptr;
+  _traceId = 0;
   _radius = radius;
   _c_w = _c_wMin;
 }
@@ -407,8 +408,7 @@ void WifiInterface::receive(const std::shared_ptr<Message> &m)
 
       if (_data_received_evt.getTime() < SIMUL.getTime() + m->transTime()) {
         _incoming_message = m;
-        _data_received_evt.drop();
-        _data_received_evt.post(SIMUL.getTime() + m->transTime());
+        _data_received_evt.reschedule(SIMUL.getTime() + m->transTime());
       }
 
       break;
@@ -431,9 +431,8 @@ void WifiInterface::receive(const std::shared_ptr<Message> &m)
       if (_data_received_evt.isInQueue()) {
         if (_data_received_evt.getTime() < SIMUL.getTime() + m->transTime()) {
           _incoming_message = m;
-          _data_received_evt.drop();
           //std::cout << "posting event 87" << std::endl;
-          _data_received_evt.post(SIMUL.getTime() + m->transTime());
+          _data_received_evt.reschedule(SIMUL.getTime() + m->transTime());
           //std::cout << "DONE" << std::endl;
         }
       } else {
@@ -461,8 +460,7 @@ void WifiInterface::receive(const std::shared_ptr<Message> &m)
 
         if (_data_received_evt.getTime() < SIMUL.getTime() + m->transTime()) {
           _incoming_message = m;
-          _data_received_evt.drop();
-          _data_received_evt.post(SIMUL.getTime() + m->transTime());
+          _data_received_evt.reschedule(SIMUL.getTime() + m->transTime());
         }
       } else {
         _incoming_message = m;
@@ -551,10 +549,22 @@ void WifiInterface::status(WifiInterfaceStatus s)
     */
     //}
 
-    _wifiTrace->record(SIMUL.getTime(), getName(), status2string(status()));
+    _wifiTrace->record(SIMUL.getTime(), _traceId, _traceStates[status()]);
   }
 }
 
+void WifiInterface::addTrace(WifiTrace * t)
+{
+  _wifiTrace = t;
+  if (t == nullptr) return;
+
+  // the names are resolved once, here
+  _traceId = t->entity(getName());
+  _traceStates.clear();
+  for (int s = IDLE; s <= RECEIVING_MESSAGE; ++s)
+    _traceStates.push_back(t->state(status2string(WifiInterfaceStatus(s))));
+}
+
 std::string WifiInterface::status2string(WifiInterfaceStatus s)
 {
   switch(s) {
@@ -5,9 +5,11 @@
 #include <deque>
 #include <string>
 #include <sstream>
+#include <vector>
 
 #include <metasim.hpp>
 #include <basestat.hpp>
+#include <statetrace.hpp>
 #include <trace.hpp>
 
 #include "message.hpp"
@@ -25,56 +27,47 @@ public:
 };
 
 class WifiTrace {
-  std::unique_ptr<MetaSim::TraceAscii> _trace;
+  MetaSim::StateTrace _trace;
   MetaSim::Tick lastTick;
   std::string name;
   unsigned int counter;
 
-public:
-  WifiTrace(const char * n) :
-    name(n),
-    counter(0)
+  static std::string fileName(const std::string & n, unsigned int c)
   {
     std::stringstream ss;
-    ss << name
+    ss << n
        << "_"
-       << counter
+       << c
        << ".txt";
-
-    lastTick = MetaSim::Tick(0);
-    _trace = std::unique_ptr<MetaSim::TraceAscii>(new MetaSim::TraceAscii(ss.str().c_str()));
+    return ss.str();
   }
 
-  void record(const MetaSim::Tick & when, const std::string & who, const std::string &  what)
+public:
+  WifiTrace(const char * n) :
+    _trace(fileName(n, 0)),
+    lastTick(0),
+    name(n),
+    counter(0)
+  {}
+
+  uint32_t entity(const std::string & who) { return _trace.entity(who); }
+  uint32_t state(const std::string & what) { return _trace.state(what); }
+
+  void record(const MetaSim::Tick & when, uint32_t who, uint32_t what)
   {
+    // a new run starts a new file
     if (when < lastTick) {
       counter++;
-      close();
-
-      std::stringstream ss;
-      ss << name
-         << "_"
-         << counter
-         << ".txt";
-      _trace = std::unique_ptr<MetaSim::TraceAscii>(new MetaSim::TraceAscii(ss.str().c_str()));
+      _trace.reopen(fileName(name, counter));
     }
 
     lastTick = when;
-
-    std::stringstream ss;
-    ss << lastTick
-       << "\t"
-       << who
-       << "\t"
-       << what
-       << std::endl;
-
-    _trace->record(ss.str().c_str());
+    _trace.record(when, who, what);
   }
 
   void close()
   {
-    _trace->close();
+    _trace.close();
   }
 };
 
@@ -183,6 +176,8 @@ protected:
   bool _waitingForAck;
 
   WifiTrace * _wifiTrace;
+  uint32_t _traceId;
+  std::vector<uint32_t> _traceStates;
   CollisionStat * _collisionStat;
 
   void status(WifiInterfaceStatus s);
@@ -253,7 +248,7 @@ public:
   std::string status2string(WifiInterfaceStatus s);
 
   void addStat(CollisionStat * c) { _collisionStat = c; }
-  void addTrace(WifiTrace * t) { _wifiTrace = t; }
+  void addTrace(WifiTrace * t);
   WifiInterfaceStatus status() { return _status; }
 
   void newRun();
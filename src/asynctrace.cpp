@@ -0,0 +1,126 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <chrono>
+#include <vector>
+
+#include <asynctrace.hpp>
+#include <event.hpp>
+
+namespace MetaSim {
+
+    using namespace std;
+
+    AsyncTrace::AsyncTrace(const string &filename, Policy p, 
+                           size_t capacity, bool compress) :
+        Trace(filename.c_str(), BINARY, false),
+        _policy(p),
+        _compress(compress),
+        _ring(capacity),
+        _out(new BinaryTrace(filename, 65536, compress)),
+        _writer(),
+        _stop(false),
+        _written(0),
+        _records(0),
+        _stalls(0),
+        _dropped(0),
+        _stallTime(0),
+        _names(),
+        _typeIds()
+    {
+        _writer = thread(&AsyncTrace::write, this);
+    }
+
+    AsyncTrace::~AsyncTrace()
+    {
+        close();
+    }
+
+    void AsyncTrace::overflow(const TraceRecord &r)
+    {
+        _stalls++;
+        if (_policy == DROP) {
+            _dropped++;
+            return;
+        }
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        while (!_ring.push(r)) this_thread::yield();
+        chrono::duration<double> d = chrono::steady_clock::now() - start;
+        _stallTime += d.count();
+    }
+
+    void AsyncTrace::write()
+    {
+        vector<TraceRecord> buf(4096);
+        while (true) {
+            size_t n = _ring.pop(&buf[0], buf.size());
+            for (size_t i = 0; i < n; ++i) _out->record(buf[i]);
+            _written.fetch_add(n, memory_order_relaxed);
+            if (n > 0) continue;
+
+            // stop only when the ring is empty after the request
+            if (_stop.load(memory_order_acquire) && _ring.empty()) break;
+            this_thread::sleep_for(chrono::microseconds(100));
+        }
+        _out->flush();
+    }
+
+    void AsyncTrace::record(Event *e)
+    {
+        record(e->getTime(), typeId(typeid(*e)), BinaryTrace::NO_ENTITY);
+    }
+
+    uint32_t AsyncTrace::typeId(const type_info &t)
+    {
+        map<const type_info *, uint32_t>::iterator i = _typeIds.find(&t);
+        if (i != _typeIds.end()) return i->second;
+        uint32_t id = _typeIds.size();
+        _typeIds[&t] = id;
+        setName(BinaryTrace::TYPE_NAME, id, t.name());
+        return id;
+    }
+
+    void AsyncTrace::setName(BinaryTrace::NameKind k, uint32_t id, 
+                             const string &n)
+    {
+        _names[make_pair(uint32_t(k), id)] = n;
+    }
+
+    void AsyncTrace::open(bool)
+    {
+        close();
+        _out.reset(new BinaryTrace(_filename, 65536, _compress));
+        _stop.store(false, memory_order_relaxed);
+        _written.store(0);
+        _records = 0;
+        _stalls = 0;
+        _dropped = 0;
+        _stallTime = 0;
+        _writer = thread(&AsyncTrace::write, this);
+    }
+
+    void AsyncTrace::close()
+    {
+        if (!_writer.joinable()) return;
+        _stop.store(true, memory_order_release);
+        _writer.join();
+
+        map<pair<uint32_t, uint32_t>, string>::iterator i;
+        for (i = _names.begin(); i != _names.end(); ++i)
+            _out->setName(BinaryTrace::NameKind(i->first.first), 
+                          i->first.second, i->second);
+        _out->close();
+    }
+
+} // namespace MetaSim
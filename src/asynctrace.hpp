@@ -0,0 +1,160 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __ASYNCTRACE_HPP__
+#define __ASYNCTRACE_HPP__
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <typeinfo>
+#include <utility>
+
+#include <stdint.h>
+
+#include <bintrace.hpp>
+#include <spscring.hpp>
+#include <tick.hpp>
+#include <trace.hpp>
+
+namespace MetaSim {
+
+    /**
+       \ingroup metasim_stat
+
+       A binary trace written by a background thread, so that the
+       file I/O and the compression do not run in the simulation
+       thread. The record() methods only copy the record in a
+       lock-free ring buffer (see SpscRing); the writer thread
+       takes the records from the ring and writes them with a
+       BinaryTrace (compressed, by default). The file has the
+       same format and is read with BinaryTraceReader.
+
+       When the ring is full, the policy decides what happens:
+       with BLOCK the simulation thread waits until there is room,
+       with DROP the record is discarded. In both cases the event
+       is counted (see getStalls(), getStallTime() and
+       getDropped()): if these counters grow, the trace I/O is
+       slowing down the simulation, and a larger ring (or a
+       faster disk) is needed.
+
+       The records must be produced by a single thread (the one
+       running the simulation). The names given with setName()
+       are written when the trace is closed.
+    */
+    class AsyncTrace : public Trace {
+    public:
+        /// What to do when the ring is full
+        enum Policy { BLOCK, DROP };
+
+        /**
+           Creates the file and starts the writer thread.
+
+           @param filename the name of the file
+           @param p        the policy when the ring is full
+           @param capacity the number of records of the ring
+           @param compress true to write compressed blocks
+        */
+        AsyncTrace(const std::string &filename, Policy p = BLOCK,
+                   size_t capacity = 65536, bool compress = true);
+        ~AsyncTrace();
+
+        /// Appends a record to the trace
+        inline void record(Tick t, uint32_t type, uint32_t entity,
+                           double payload = 0)
+            {
+                TraceRecord r;
+                r.tick = int64_t(t);
+                r.type = type;
+                r.entity = entity;
+                r.payload = payload;
+                record(r);
+            }
+
+        inline void record(const TraceRecord &r)
+            {
+                _records++;
+                if (!_ring.push(r)) overflow(r);
+            }
+
+        /// Records the execution of event e
+        virtual void record(Event *e);
+
+        /// See BinaryTrace::typeId()
+        uint32_t typeId(const std::type_info &t);
+
+        /// Gives the name n to the ID id of kind k
+        void setName(BinaryTrace::NameKind k, uint32_t id, const std::string &n);
+
+        /**
+           Closes the trace (see close()) and creates the file
+           again, empty, with a new writer thread: the counters
+           start from 0. The trace is always binary, whatever
+           type.
+        */
+        virtual void open(bool type = BINARY);
+
+        /// Waits for the writer to write all the records, and
+        /// closes the file
+        virtual void close();
+
+        Policy getPolicy() const { return _policy; }
+
+        /// Records passed to record()
+        unsigned long getRecords() const { return _records; }
+
+        /// Records written by the writer thread
+        unsigned long getWritten() const { return _written.load(); }
+
+        /// Records found the ring full
+        unsigned long getStalls() const { return _stalls; }
+
+        /// Records discarded (DROP policy)
+        unsigned long getDropped() const { return _dropped; }
+
+        /// Seconds spent by the simulation waiting for room in
+        /// the ring (BLOCK policy)
+        double getStallTime() const { return _stallTime; }
+
+        /// Records in the ring, not yet taken by the writer
+        size_t getPending() const { return _ring.size(); }
+
+    private:
+        Policy _policy;
+        bool _compress;
+        SpscRing<TraceRecord> _ring;
+        std::unique_ptr<BinaryTrace> _out;
+        std::thread _writer;
+        std::atomic<bool> _stop;
+        std::atomic<unsigned long> _written;
+
+        unsigned long _records;
+        unsigned long _stalls;
+        unsigned long _dropped;
+        double _stallTime;
+
+        std::map<std::pair<uint32_t, uint32_t>, std::string> _names;
+        std::map<const std::type_info *, uint32_t> _typeIds;
+
+        // the slow path of record()
+        void overflow(const TraceRecord &r);
+
+        // the body of the writer thread
+        void write();
+    };
+
+} // namespace MetaSim
+
+#endif // __ASYNCTRACE_HPP__
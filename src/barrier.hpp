@@ -0,0 +1,52 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __BARRIER_HPP__
+#define __BARRIER_HPP__
+
+#include <condition_variable>
+#include <mutex>
+
+namespace MetaSim {
+
+    /**
+       \ingroup metasim_ee
+
+       A reusable barrier for a fixed number of threads, used by
+       the parallel engines.
+    */
+    class Barrier {
+        std::mutex _m;
+        std::condition_variable _cv;
+        int _n;
+        int _waiting;
+        unsigned long _generation;
+    public:
+        Barrier(int n) : _n(n), _waiting(0), _generation(0) {}
+
+        /// Blocks until all the threads have called wait()
+        void wait() {
+            std::unique_lock<std::mutex> lock(_m);
+            unsigned long gen = _generation;
+            if (++_waiting == _n) {
+                _waiting = 0;
+                _generation++;
+                _cv.notify_all();
+            }
+            else while (gen == _generation) _cv.wait(lock);
+        }
+    };
+
+} // namespace MetaSim
+
+#endif // __BARRIER_HPP__
@@ -27,14 +27,8 @@ using namespace std;
 namespace MetaSim {
 
     double BaseStat::_TDistr[MAX_DISTR];
-    size_t BaseStat::_totalNumOfExp = 0;
-    size_t BaseStat::_expNum = 0;
-    bool BaseStat::_endOfSim = 0;
-    bool BaseStat::_initFlag = false;
-    Tick BaseStat::_transitory = 0;  
     bool TableOutput::_created = false;
     string TableOutput::_fname;
-    BaseStat::List BaseStat::_statList;
 
     // A bunch of customary exception messages
     const char* const EFFECTIVE_ATTACH = 
@@ -86,52 +80,69 @@ namespace MetaSim {
     };
 
     BaseStat::BaseStat(std::string n) :
+        _ctx(&SimulationContext::current()),
         _name(n)
     {
-        _statList.push_back(this);
+        _ctx->_statList.push_back(this);
     }
 
     BaseStat::~BaseStat()
     {
-        _statList.remove(this);
+        _ctx->_statList.remove(this);
     }
 
     void BaseStat::init(size_t n)  
     {
-        _totalNumOfExp = n;
-        _endOfSim = false;
-        _initFlag = true;
-        for_each(_statList.begin(), _statList.end(),
+        SimulationContext &ctx = SimulationContext::current();
+        ctx._statTotalExp = n;
+        ctx._statEndOfSim = false;
+        ctx._statInitFlag = true;
+        for_each(ctx._statList.begin(), ctx._statList.end(),
                  mem_fun(&BaseStat::init));
     }
   
     void BaseStat::init()
     {
         _exper.clear();
-        _expNum = 0;
+        _ctx->_statExpNum = 0;
     }  
 
     void BaseStat::setTransitory(Tick t)
     {
-        _transitory = t;
+        SimulationContext::current()._statTransitory = t;
     }
 
     bool BaseStat::chkTransitory()
     {
-        if (SIMUL.getTime() >= _transitory) return false;
+        SimulationContext &ctx = SimulationContext::current();
+        if (ctx.globTime >= ctx._statTransitory) return false;
         else return true;
     }
 
+    Tick BaseStat::getTransitory()
+    {
+        return SimulationContext::current()._statTransitory;
+    }
+
+    Tick BaseStat::now()
+    {
+        return SimulationContext::current().globTime;
+    }
+
     double BaseStat::t_student(int alfa, int dol)
     {
-        if (dol<1 || dol>30)
+        if (dol<1)
             return -1;
+        // over 30 degrees of freedom, the normal distribution
+        // is a good approximation
+        if (dol>30) 
+            dol = 0;
         switch (alfa) {
         case 90:
-            return t1_table[dol-1][0];
+            return dol ? t1_table[dol-1][0] : 1.645;
             break;
         case 95:
-            return t1_table[dol-1][1];
+            return dol ? t1_table[dol-1][1] : 1.960;
             break;
         default:
             return -1;
@@ -143,15 +154,42 @@ namespace MetaSim {
     //
     void BaseStat::endRun()
     {
-        for_each(_statList.begin(), _statList.end(),
+        SimulationContext &ctx = SimulationContext::current();
+        for_each(ctx._statList.begin(), ctx._statList.end(),
                  mem_fun(&BaseStat::collect));
-        if (++_expNum >= MAX_RUN)
+        if (++ctx._statExpNum >= MAX_RUN)
             throw Exc(TOO_MUCH_RUNS);
     }
 
     void BaseStat::endSim()
     {
-        _endOfSim = true;
+        SimulationContext::current()._statEndOfSim = true;
+    }
+
+    void BaseStat::getLastValues(vector<double> &v)
+    {
+        SimulationContext &ctx = SimulationContext::current();
+        for (List::iterator i = ctx._statList.begin(); 
+             i != ctx._statList.end(); ++i) 
+            v.push_back((*i)->getLastValue());
+    }
+
+    void BaseStat::setExperiments(const vector< vector<double> > &runs)
+    {
+        SimulationContext &ctx = SimulationContext::current();
+        if (runs.size() >= MAX_RUN) throw Exc(TOO_MUCH_RUNS);
+        for (size_t r = 0; r < runs.size(); ++r) 
+            if (runs[r].size() != ctx._statList.size()) 
+                throw Exc("Wrong number of statistical objects");
+
+        init(runs.size());
+        size_t k = 0;
+        for (List::iterator i = ctx._statList.begin(); 
+             i != ctx._statList.end(); ++i, ++k) 
+            for (size_t r = 0; r < runs.size(); ++r) 
+                (*i)->_exper.push_back(runs[r][k]);
+        ctx._statExpNum = runs.size();
+        endSim();
     }
 
     //
@@ -159,7 +197,8 @@ namespace MetaSim {
     //
     void BaseStat::newRun()
     {
-        for_each(_statList.begin(), _statList.end(),
+        SimulationContext &ctx = SimulationContext::current();
+        for_each(ctx._statList.begin(), ctx._statList.end(),
                  mem_fun(&BaseStat::initValue));
     }
 
@@ -168,11 +207,11 @@ namespace MetaSim {
     //
     double BaseStat::getMean()
     {
-        if (!_endOfSim) throw Exc(GET);
-        if (!_initFlag) throw Exc(NO_INIT);
+        if (!_ctx->_statEndOfSim) throw Exc(GET);
+        if (!_ctx->_statInitFlag) throw Exc(NO_INIT);
 
         double sum = accumulate(_exper.begin(), _exper.end(), 0.0);
-        sum /= _expNum;
+        sum /= _ctx->_statExpNum;
   
         return sum;
     }
@@ -205,14 +244,15 @@ namespace MetaSim {
         double sum = 0;
         double mu;		// the mean
   
-        if (!_endOfSim) throw Exc(GET);
-        if (!_initFlag) throw Exc(NO_INIT);
-        if (_expNum < 3) throw Exc(NEED_3);
+        size_t expNum = _ctx->_statExpNum;
+        if (!_ctx->_statEndOfSim) throw Exc(GET);
+        if (!_ctx->_statInitFlag) throw Exc(NO_INIT);
+        if (expNum < 3) throw Exc(NEED_3);
 
         mu = getMean();
 
         sum = accumulate(_exper.begin(), _exper.end(), 0.0, V(mu));
-        return sqrt(sum/((_expNum - 1) * _expNum));
+        return sqrt(sum/((expNum - 1) * expNum));
     }
 
     double BaseStat::getConfInterval(CONFIDENCE_INTERVAL c)
@@ -220,13 +260,24 @@ namespace MetaSim {
         double mu;		// the mean
         double s;		// the variance
   
-        if (!_endOfSim) throw Exc(GET);
-        if (!_initFlag) throw Exc(NO_INIT);
-        if (_expNum < 3) throw Exc(NEED_3);
+        size_t expNum = _ctx->_statExpNum;
+        if (!_ctx->_statEndOfSim) throw Exc(GET);
+        if (!_ctx->_statInitFlag) throw Exc(NO_INIT);
+        if (expNum < 3) throw Exc(NEED_3);
 
         mu = getMean();
         s = getVariance();
-        return t_student(c, (unsigned int) _expNum - 1) * s;
+        return t_student(c, (unsigned int) expNum - 1) * s;
+    }
+
+    bool BaseStat::hasPrecision(double relWidth, CONFIDENCE_INTERVAL c)
+    {
+        if (_ctx->_statExpNum < 3) return false;
+
+        double w = getConfInterval(c);
+        double mu = fabs(getMean());
+        if (mu == 0) return w == 0;
+        return w <= relWidth * mu;
     }
 
     void BaseStat::printAll()
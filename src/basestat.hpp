@@ -21,6 +21,7 @@
 #include <vector>
 
 #include <basetype.hpp>
+#include <simcontext.hpp>
 
 namespace MetaSim {
 
@@ -90,10 +91,12 @@ namespace MetaSim {
     private:
         static const int MAX_DISTR = 10000;
         static double _TDistr[MAX_DISTR];
-        static size_t _totalNumOfExp;
-        static size_t _expNum;
-        static bool _endOfSim;
-        static List _statList;
+
+        /// The simulation context in which this object is
+        /// registered. The context keeps the list of all the
+        /// statistical objects, and the state of the experiments
+        /// (number of experiments, current experiment, etc.).
+        SimulationContext *_ctx;
 
     protected:
 
@@ -122,21 +125,15 @@ namespace MetaSim {
         Experiments _exper;
 
         /** called at the end of the run, puts the current 
-            value in the array of experiments. */
-        inline void collect() {
-            if (_exper.size() <= _expNum) _exper.push_back(_val);
-            else _exper[_expNum] = _val;
+            value in the array of experiments. A derived class
+            that computes _val only at the end of the run can
+            override it, and then call BaseStat::collect(). */
+        virtual void collect() {
+            size_t expNum = _ctx->_statExpNum;
+            if (_exper.size() <= expNum) _exper.push_back(_val);
+            else _exper[expNum] = _val;
         }
 
-        // System-Wide data & functions needed to be visible 
-        // also to other kind of stats!
-        /// lenght of the transitory.
-        static Tick _transitory;
-
-        /// used to see if the base stat class has been
-        /// initialized. (???) 
-        static bool _initFlag;
-
         /// t-student function
         static double get_t_perc(double alpha);
 
@@ -152,14 +149,30 @@ namespace MetaSim {
         virtual ~BaseStat();
   
         typedef List::const_iterator iterator;
-        static inline iterator begin() { return _statList.begin(); }
-        static inline iterator end() { return _statList.end(); }
+        static inline iterator begin() 
+            { return SimulationContext::current()._statList.begin(); }
+        static inline iterator end() 
+            { return SimulationContext::current()._statList.end(); }
 
         /** 
             Level 1 function: it is called by the probe() (level 2) 
         */
         virtual void record(double) = 0;
         virtual void initValue() = 0;
+
+        /**
+           Appends to s the state of the object during a run,
+           that is everything that is modified by record().
+           Used by the Time Warp engine to restore the object
+           after a rollback. The default saves _val: a derived
+           class with more state must override this function
+           and restoreState().
+        */
+        virtual void saveState(std::vector<double> &s) const 
+            { s.push_back(_val); }
+
+        /// Restores the state saved by saveState(), advancing s
+        virtual void restoreState(const double *&s) { _val = *s++; }
   
         /** 
             level 2 function: called by the event action() method. 
@@ -202,8 +215,8 @@ namespace MetaSim {
            Returns the data collected in the last run
         */
         inline double getLastValue() {
-            if (_expNum > 0) 
-                return _exper[_expNum-1]; 
+            if (_ctx->_statExpNum > 0) 
+                return _exper[_ctx->_statExpNum-1]; 
             else return 0;
         }
 
@@ -227,11 +240,20 @@ namespace MetaSim {
 	
             @param c  can be C90 or C95 */
         double getConfInterval(CONFIDENCE_INTERVAL c = C95);
+
+        /**
+           Returns true if the half-width of the confidence
+           interval c is not larger than relWidth times the
+           absolute value of the mean (for example, relWidth =
+           0.05 means "within 5% of the mean"). It returns false
+           if less than 3 runs have been completed.
+        */
+        bool hasPrecision(double relWidth, CONFIDENCE_INTERVAL c = C95);
 	
         /*--------------------------------------------*/
 
         // debug!!
-        inline size_t getExpNum() { return _expNum; }
+        inline size_t getExpNum() { return _ctx->_statExpNum; }
         static void printAll();	
         void print();
 
@@ -254,12 +276,36 @@ namespace MetaSim {
         /// write the files.
         static void endSim();
 
+        /**
+           Appends to v the value collected in the last run by
+           every statistical object of the current context, in
+           the order in which the objects have been created.
+        */
+        static void getLastValues(std::vector<double> &v);
+
+        /**
+           Replaces the experiments of all the statistical objects
+           of the current context with the values in runs (one
+           vector per run, as returned by getLastValues()), and
+           closes the simulation so that getMean() and
+           getConfInterval() can be called. Used for merging the
+           results of runs executed elsewhere, for example by
+           Simulation::run_parallel().
+        */
+        static void setExperiments(const std::vector<std::vector<double> > &runs);
+
         /// specify how long the transitory will be
         /// data collected during transitory is discarded
         static void setTransitory(Tick t);
     
         /// check if we are currently inside the transitory
         static bool chkTransitory();
+
+        /// the end of the transitory
+        static Tick getTransitory();
+
+        /// the current time of the simulation of the current context
+        static Tick now();
     };
 
     /* ---------------------------------------------------------
@@ -346,10 +392,14 @@ namespace MetaSim {
         virtual void record(double a)
             {
                 if (chkTransitory()) return;
-                _val = _val * _count + a;
-                _val /= ++_count;
+                // Welford: no growing sum to lose precision in
+                _val += (a - _val) / ++_count;
             };
         virtual void initValue() { _val = _ini; _count = 0; };
+        virtual void saveState(std::vector<double> &s) const
+            { s.push_back(_val); s.push_back(_count); }
+        virtual void restoreState(const double *&s)
+            { _val = *s++; _count = *s++; }
     };
 
     /// Computes the quadratic mean value 
@@ -366,6 +416,10 @@ namespace MetaSim {
             }
 
         virtual void initValue() { _val = _ini; _count = 0; };
+        virtual void saveState(std::vector<double> &s) const
+            { s.push_back(_val); s.push_back(_count); }
+        virtual void restoreState(const double *&s)
+            { _val = *s++; _count = *s++; }
     };
 
 
@@ -425,6 +479,10 @@ namespace MetaSim {
                 _num = _ini;
                 _den = std::max(1.0,_ini);
             }
+        virtual void saveState(std::vector<double> &s) const
+            { s.push_back(_val); s.push_back(_num); s.push_back(_den); }
+        virtual void restoreState(const double *&s)
+            { _val = *s++; _num = *s++; _den = *s++; }
         int getNumSamples() 
             {
                 return _den;
@@ -432,6 +490,135 @@ namespace MetaSim {
     };
 
 
+    /// Computes the integral over time of a piecewise constant value
+    /**
+       Computes the integral over time of a value that changes only
+       when record() is called: record(v) means that from now on the
+       value is v, and adds to the integral the previous value times
+       the time elapsed since the previous change. The value at the
+       beginning of every run is the one given to the constructor.
+       The part of the integral inside the transitory (see
+       BaseStat::setTransitory()) is discarded, but the changes
+       recorded during the transitory are taken into account.
+
+       The integral is accumulated with the Kahan summation, so
+       that long runs made of many short intervals do not lose
+       precision. At the end of the run, the last interval is
+       added up to the end time of the run.
+    */
+    class StatTimeIntegral : public BaseStat {
+    protected:
+        double _ini;
+        double _cur;     // the current value
+        Tick _last;      // the time of the last change
+        double _sum;     // the integral
+        double _comp;    // the compensation of the Kahan sum
+
+        /// Adds the current value from the last change to t
+        inline void advance(Tick t)
+            {
+                Tick start = std::max(_last, getTransitory());
+                if (t > start) {
+                    double y = _cur * double(t - start) - _comp;
+                    double s = _sum + y;
+                    _comp = (s - _sum) - y;
+                    _sum = s;
+                }
+                _last = t;
+            }
+
+        virtual void collect()
+            {
+                advance(now());
+                _val = _sum;
+                BaseStat::collect();
+            }
+
+    public:
+        StatTimeIntegral(std::string name = "", double i = 0) :
+            BaseStat(name), _ini(i), _cur(i), _last(0), _sum(0), _comp(0)
+            {
+            }
+
+        virtual void record(double v)
+            {
+                advance(now());
+                _cur = v;
+                _val = _sum;
+            }
+        virtual void initValue()
+            {
+                _val = _sum = _comp = 0;
+                _cur = _ini;
+                _last = now();
+            }
+        virtual void saveState(std::vector<double> &s) const
+            { 
+                s.push_back(_val); s.push_back(_cur); s.push_back(_last);
+                s.push_back(_sum); s.push_back(_comp);
+            }
+        virtual void restoreState(const double *&s)
+            {
+                _val = *s++; _cur = *s++; _last = Tick(int64_t(*s++));
+                _sum = *s++; _comp = *s++;
+            }
+
+        /// The current value
+        double getLevel() const { return _cur; }
+    };
+
+    /// Computes the time average of a piecewise constant value
+    /**
+       Like StatTimeIntegral, but the value of the run is the
+       integral divided by the length of the run (minus the
+       transitory): for example, the average length of a queue,
+       if record() is called with the new length at every change.
+    */
+    class StatTimeAverage : public StatTimeIntegral {
+    protected:
+        Tick _start;     // the beginning of the run
+
+        inline double average(Tick t) const
+            {
+                Tick start = std::max(_start, getTransitory());
+                if (t <= start) return _cur;
+                return _sum / double(t - start);
+            }
+
+        virtual void collect()
+            {
+                Tick t = now();
+                advance(t);
+                _val = average(t);
+                BaseStat::collect();
+            }
+
+    public:
+        StatTimeAverage(std::string name = "", double i = 0) :
+            StatTimeIntegral(name, i), _start(0)
+            {
+            }
+
+        virtual void record(double v)
+            {
+                Tick t = now();
+                advance(t);
+                _cur = v;
+                _val = average(t);
+            }
+        virtual void initValue()
+            {
+                StatTimeIntegral::initValue();
+                _start = _last;
+                _val = _cur;
+            }
+        virtual void saveState(std::vector<double> &s) const
+            { StatTimeIntegral::saveState(s); s.push_back(_start); }
+        virtual void restoreState(const double *&s)
+            { StatTimeIntegral::restoreState(s); _start = Tick(int64_t(*s++)); }
+    };
+
+
     /// Produces output in gnuplot format
     /**
        Output for gnuplot. This class open a file for each statistical object   
@@ -0,0 +1,157 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <cmath>
+
+#include <batchmeans.hpp>
+
+namespace MetaSim {
+
+    using namespace std;
+
+    StatBatchMeans::StatBatchMeans(string name, size_t batches, 
+                                   size_t capacity) :
+        BaseStat(name), _batches(batches), _capacity(capacity), _size(5),
+        _n(0), _sum(0), _means(), _truncated(0), _bm()
+    {
+        if (batches < 3) throw Exc("At least 3 batches are needed");
+        if (capacity < 2 * batches) throw Exc("The capacity is too small");
+        // merged in pairs
+        if (_capacity % 2) _capacity++;
+    }
+
+    void StatBatchMeans::initValue()
+    {
+        _val = 0;
+        _size = 5;
+        _n = 0;
+        _sum = 0;
+        _means.clear();
+        _truncated = 0;
+        _bm.clear();
+    }
+
+    void StatBatchMeans::halve()
+    {
+        size_t h = _means.size() / 2;
+        for (size_t i = 0; i < h; ++i) 
+            _means[i] = (_means[2 * i] + _means[2 * i + 1]) / 2;
+        _means.resize(h);
+        _size *= 2;
+    }
+
+    void StatBatchMeans::collect()
+    {
+        analyze();
+        BaseStat::collect();
+    }
+
+    void StatBatchMeans::analyze()
+    {
+        size_t m = _means.size();
+        _bm.clear();
+        _truncated = 0;
+        if (m == 0) {
+            _val = _n ? _sum / _n : 0;
+            return;
+        }
+
+        // MSER: the variance of the last m - d batches (kept with
+        // the Welford update, adding the batches backwards) over
+        // (m - d)^2, minimized for d <= m / 2
+        double mean = 0;
+        double m2 = 0;
+        size_t best = m - 1;
+        double bestMser = 0;
+        for (size_t d = m; d-- > 0; ) {
+            double n = double(m - d);
+            double delta = _means[d] - mean;
+            mean += delta / n;
+            m2 += delta * (_means[d] - mean);
+            double mser = m2 / (n * n);
+            if (d <= m / 2 && (d == m / 2 || mser <= bestMser)) {
+                best = d;
+                bestMser = mser;
+            }
+        }
+
+        // the large batches, discarding the leftover at the
+        // beginning
+        size_t r = m - best;
+        size_t k = r < _batches ? r : _batches;
+        size_t b = r / k;
+        size_t first = m - k * b;
+        _truncated = first * _size;
+
+        double total = 0;
+        for (size_t j = 0; j < k; ++j) {
+            double s = 0;
+            for (size_t i = 0; i < b; ++i) s += _means[first + j * b + i];
+            _bm.push_back(s / b);
+            total += s / b;
+        }
+        _val = total / k;
+    }
+
+    double StatBatchMeans::getBatchConfInterval(CONFIDENCE_INTERVAL c) const
+    {
+        size_t k = _bm.size();
+        if (k < 3) throw Exc("Need at least 3 batches");
+
+        double mean = 0;
+        for (size_t j = 0; j < k; ++j) mean += _bm[j];
+        mean /= k;
+        double s2 = 0;
+        for (size_t j = 0; j < k; ++j) s2 += (_bm[j] - mean) * (_bm[j] - mean);
+        s2 /= (k - 1);
+        return t_student(c, int(k) - 1) * sqrt(s2 / k);
+    }
+
+    double StatBatchMeans::getLag1Correlation() const
+    {
+        size_t k = _bm.size();
+        if (k < 3) throw Exc("Need at least 3 batches");
+
+        double mean = 0;
+        for (size_t j = 0; j < k; ++j) mean += _bm[j];
+        mean /= k;
+        double num = 0;
+        double den = 0;
+        for (size_t j = 0; j < k; ++j) {
+            den += (_bm[j] - mean) * (_bm[j] - mean);
+            if (j + 1 < k) num += (_bm[j] - mean) * (_bm[j + 1] - mean);
+        }
+        return den > 0 ? num / den : 0;
+    }
+
+    void StatBatchMeans::saveState(vector<double> &s) const
+    {
+        s.push_back(_val);
+        s.push_back(_size);
+        s.push_back(_n);
+        s.push_back(_sum);
+        s.push_back(_means.size());
+        s.insert(s.end(), _means.begin(), _means.end());
+    }
+
+    void StatBatchMeans::restoreState(const double *&s)
+    {
+        _val = *s++;
+        _size = size_t(*s++);
+        _n = size_t(*s++);
+        _sum = *s++;
+        _means.resize(size_t(*s++));
+        for (size_t i = 0; i < _means.size(); ++i) _means[i] = *s++;
+    }
+
+} // namespace MetaSim
@@ -0,0 +1,126 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __BATCHMEANS_HPP__
+#define __BATCHMEANS_HPP__
+
+#include <string>
+#include <vector>
+
+#include <basestat.hpp>
+
+namespace MetaSim {
+
+    /**
+       \ingroup metasim_stat
+
+       Computes the steady-state mean of the recorded values from
+       a single long run, with the method of batch means and the
+       MSER-5 truncation of the warm-up period, instead of many
+       replications each paying its own transitory.
+
+       The values are averaged in small batches while the run
+       goes on (5 values each, as required by MSER-5), so the
+       memory does not depend on the length of the run: when
+       <i>capacity</i> batches have been stored, adjacent batches
+       are merged and the size of the batches doubles.
+
+       At the end of the run (or when analyze() is called):
+       - MSER-5 chooses the number d of initial batches to discard,
+         that minimizes the variance of the mean of the remaining
+         ones divided by their number (searching d in the first
+         half of the run);
+       - the remaining batches are grouped in <i>batches</i> large
+         batches of the same size;
+       - the value of the run is the mean of the large batches,
+         and getBatchConfInterval() is the confidence interval
+         computed from them (with batches - 1 degrees of freedom).
+
+       A large getLag1Correlation() (more than 0.2, say) means that
+       the batches are too short for the interval to be trusted,
+       and a longer run is needed.
+
+       @code
+       StatBatchMeans wait("waiting_time");
+       ...
+       SIMUL.run(10000000, 1);
+       cout << wait.getLastValue() << " +/- " 
+            << wait.getBatchConfInterval() << endl;
+       @endcode
+    */
+    class StatBatchMeans : public BaseStat {
+    protected:
+        size_t _batches;
+        size_t _capacity;
+        size_t _size;                // values per stored batch
+        size_t _n;                   // values in the current batch
+        double _sum;                 // their sum
+        std::vector<double> _means;  // the stored batches
+
+        size_t _truncated;           // results of analyze()
+        std::vector<double> _bm;
+
+        virtual void collect();
+
+        // merges the stored batches in pairs
+        void halve();
+
+    public:
+        /**
+           @param name     the name of the statistic
+           @param batches  the number of batches of the confidence
+                           interval (at least 3)
+           @param capacity the number of stored batches (at least
+                           twice batches)
+        */
+        StatBatchMeans(std::string name = "", size_t batches = 20,
+                       size_t capacity = 10000);
+
+        virtual void record(double x)
+            {
+                if (chkTransitory()) return;
+                _sum += x;
+                if (++_n < _size) return;
+                _means.push_back(_sum / _n);
+                _sum = 0;
+                _n = 0;
+                if (_means.size() >= _capacity) halve();
+            }
+        virtual void initValue();
+        virtual void saveState(std::vector<double> &s) const;
+        virtual void restoreState(const double *&s);
+
+        /// Truncates and batches the values recorded so far,
+        /// updating the value of the statistic
+        void analyze();
+
+        /// The number of values recorded in the run
+        size_t getObservations() const { return _means.size() * _size + _n; }
+
+        /// The number of values discarded by analyze() as warm-up
+        size_t getTruncation() const { return _truncated; }
+
+        /// The means of the batches computed by analyze()
+        const std::vector<double> &getBatchMeans() const { return _bm; }
+
+        /// The half-width of the confidence interval computed from
+        /// the batches of the last analyze()
+        double getBatchConfInterval(CONFIDENCE_INTERVAL c = C95) const;
+
+        /// The lag-1 autocorrelation of the batch means
+        double getLag1Correlation() const;
+    };
+
+} // namespace MetaSim
+
+#endif // __BATCHMEANS_HPP__
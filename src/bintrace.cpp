@@ -0,0 +1,310 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <cstring>
+#include <sstream>
+
+#include <bintrace.hpp>
+#include <event.hpp>
+
+namespace MetaSim {
+
+    using namespace std;
+
+    const uint32_t BinaryTrace::NO_ENTITY;
+    const uint32_t BinaryTrace::VERSION;
+    const uint32_t BinaryTrace::FLAG_COMPRESSED;
+    const uint32_t BinaryTrace::ORDER_MARK;
+    const char BinaryTrace::MAGIC[8] = { 'M', 'S', 'T', 'R', 'A', 'C', 'E', 0 };
+
+    namespace {
+        // variable-length encoding of the compressed blocks: 7
+        // bits per byte, the highest bit set if more bytes follow
+        inline void putVarint(vector<unsigned char> &b, uint64_t v)
+        {
+            while (v >= 0x80) {
+                b.push_back((unsigned char) (v | 0x80));
+                v >>= 7;
+            }
+            b.push_back((unsigned char) v);
+        }
+
+        inline uint64_t getVarint(const unsigned char *&p, 
+                                  const unsigned char *end)
+        {
+            uint64_t v = 0;
+            for (int shift = 0; p < end && shift < 64; shift += 7) {
+                unsigned char c = *p++;
+                v |= uint64_t(c & 0x7f) << shift;
+                if (!(c & 0x80)) return v;
+            }
+            throw BinaryTraceReader::Exc("Corrupted compressed block");
+        }
+
+        inline uint64_t zigzag(int64_t v)
+        {
+            return (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+        }
+
+        inline int64_t unzigzag(uint64_t v)
+        {
+            return int64_t(v >> 1) ^ -int64_t(v & 1);
+        }
+    }
+
+    BinaryTrace::BinaryTrace(const string &filename, size_t bufferSize, 
+                             bool compress) :
+        Trace(filename.c_str(), BINARY),
+        _buf(bufferSize > 0 ? bufferSize : 1),
+        _used(0),
+        _records(0),
+        _names(),
+        _typeIds(),
+        _flags(compress ? FLAG_COMPRESSED : 0),
+        _block()
+    {
+        if (!_os.is_open()) throw Exc();
+        writeHeader(0);
+    }
+
+    BinaryTrace::~BinaryTrace()
+    {
+        if (_os.is_open()) close();
+    }
+
+    void BinaryTrace::writeHeader(uint64_t namesOffset)
+    {
+        TraceHeader h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, MAGIC, sizeof(h.magic));
+        h.version = VERSION;
+        h.recordSize = sizeof(TraceRecord);
+        h.byteOrder = ORDER_MARK;
+        h.flags = _flags;
+        h.records = _records;
+        h.namesOffset = namesOffset;
+        _os.write(reinterpret_cast<const char *>(&h), sizeof(h));
+    }
+
+    void BinaryTrace::record(Event *e)
+    {
+        record(e->getTime(), typeId(typeid(*e)), NO_ENTITY);
+    }
+
+    uint32_t BinaryTrace::typeId(const type_info &t)
+    {
+        map<const type_info *, uint32_t>::iterator i = _typeIds.find(&t);
+        if (i != _typeIds.end()) return i->second;
+        uint32_t id = _typeIds.size();
+        _typeIds[&t] = id;
+        setName(TYPE_NAME, id, t.name());
+        return id;
+    }
+
+    void BinaryTrace::setName(NameKind k, uint32_t id, const string &n)
+    {
+        _names[make_pair(uint32_t(k), id)] = n;
+    }
+
+    void BinaryTrace::flush()
+    {
+        if (_used == 0) return;
+        if (!(_flags & FLAG_COMPRESSED)) {
+            _os.write(reinterpret_cast<const char *>(&_buf[0]), 
+                      _used * sizeof(TraceRecord));
+        }
+        else {
+            // the type is shifted to make room for a bit telling
+            // if the payload follows; NO_ENTITY + 1 is encoded as 0
+            _block.clear();
+            int64_t prev = 0;
+            for (size_t i = 0; i < _used; ++i) {
+                const TraceRecord &r = _buf[i];
+                putVarint(_block, zigzag(r.tick - prev));
+                prev = r.tick;
+                putVarint(_block, (uint64_t(r.type) << 1) | (r.payload != 0));
+                putVarint(_block, uint32_t(r.entity + 1));
+                if (r.payload != 0) {
+                    const unsigned char *p = 
+                        reinterpret_cast<const unsigned char *>(&r.payload);
+                    _block.insert(_block.end(), p, p + sizeof(double));
+                }
+            }
+            uint32_t h[2] = { uint32_t(_used), uint32_t(_block.size()) };
+            _os.write(reinterpret_cast<const char *>(h), sizeof(h));
+            _os.write(reinterpret_cast<const char *>(&_block[0]), _block.size());
+        }
+        _records += _used;
+        _used = 0;
+    }
+
+    void BinaryTrace::open(bool)
+    {
+        Trace::open(BINARY);
+        _used = 0;
+        _records = 0;
+        writeHeader(0);
+    }
+
+    void BinaryTrace::close()
+    {
+        if (!_os.is_open()) return;
+        flush();
+
+        uint64_t offset = _os.tellp();
+        uint32_t count = _names.size();
+        _os.write(reinterpret_cast<const char *>(&count), sizeof(count));
+        map<pair<uint32_t, uint32_t>, string>::iterator i;
+        for (i = _names.begin(); i != _names.end(); ++i) {
+            uint32_t f[3] = { i->first.first, i->first.second, 
+                              uint32_t(i->second.size()) };
+            _os.write(reinterpret_cast<const char *>(f), sizeof(f));
+            _os.write(i->second.data(), i->second.size());
+        }
+
+        _os.seekp(0);
+        writeHeader(offset);
+        Trace::close();
+    }
+
+    /*-----------------------------------------------------*/
+
+    BinaryTraceReader::BinaryTraceReader(const string &filename, 
+                                         size_t bufferSize) :
+        _is(filename.c_str(), ios::in | ios::binary),
+        _header(),
+        _names(),
+        _buf(bufferSize > 0 ? bufferSize : 1),
+        _pos(0),
+        _avail(0),
+        _read(0),
+        _block()
+    {
+        if (!_is) throw Exc("Cannot open " + filename);
+        if (!_is.read(reinterpret_cast<char *>(&_header), sizeof(_header)))
+            throw Exc("Truncated header");
+        if (memcmp(_header.magic, BinaryTrace::MAGIC, sizeof(_header.magic)))
+            throw Exc("Not a MetaSim binary trace");
+        if (_header.byteOrder != BinaryTrace::ORDER_MARK)
+            throw Exc("Trace written with a different byte order");
+        if (_header.version != BinaryTrace::VERSION)
+            throw Exc("Unsupported trace version");
+        if (_header.recordSize != sizeof(TraceRecord))
+            throw Exc("Unsupported record size");
+        if (_header.flags & ~BinaryTrace::FLAG_COMPRESSED)
+            throw Exc("Unsupported trace flags");
+
+        if (_header.namesOffset != 0) {
+            _is.seekg(_header.namesOffset);
+            uint32_t count = 0;
+            _is.read(reinterpret_cast<char *>(&count), sizeof(count));
+            for (uint32_t i = 0; i < count && _is; ++i) {
+                uint32_t f[3];
+                _is.read(reinterpret_cast<char *>(f), sizeof(f));
+                string n(f[2], ' ');
+                if (f[2] > 0) _is.read(&n[0], f[2]);
+                _names[make_pair(f[0], f[1])] = n;
+            }
+            if (!_is) throw Exc("Truncated name table");
+        }
+        rewind();
+    }
+
+    void BinaryTraceReader::rewind()
+    {
+        _is.clear();
+        _is.seekg(sizeof(TraceHeader));
+        _pos = _avail = 0;
+        _read = 0;
+    }
+
+    size_t BinaryTraceReader::fill()
+    {
+        if (_read == _header.records) return 0;
+
+        if (!(_header.flags & BinaryTrace::FLAG_COMPRESSED)) {
+            uint64_t left = _header.records - _read;
+            size_t n = left < _buf.size() ? size_t(left) : _buf.size();
+            _is.read(reinterpret_cast<char *>(&_buf[0]), n * sizeof(TraceRecord));
+            n = _is.gcount() / sizeof(TraceRecord);
+            _read += n;
+            return n;
+        }
+
+        // one compressed block
+        uint32_t h[2];
+        if (!_is.read(reinterpret_cast<char *>(h), sizeof(h))) 
+            throw Exc("Truncated compressed block");
+        _block.resize(h[1]);
+        if (h[1] > 0 && !_is.read(reinterpret_cast<char *>(&_block[0]), h[1]))
+            throw Exc("Truncated compressed block");
+        if (_buf.size() < h[0]) _buf.resize(h[0]);
+
+        const unsigned char *p = _block.empty() ? NULL : &_block[0];
+        const unsigned char *end = p + _block.size();
+        int64_t prev = 0;
+        for (uint32_t i = 0; i < h[0]; ++i) {
+            TraceRecord &r = _buf[i];
+            r.tick = prev + unzigzag(getVarint(p, end));
+            prev = r.tick;
+            uint64_t t = getVarint(p, end);
+            r.type = uint32_t(t >> 1);
+            r.entity = uint32_t(getVarint(p, end)) - 1;
+            r.payload = 0;
+            if (t & 1) {
+                if (end - p < (long) sizeof(double))
+                    throw Exc("Corrupted compressed block");
+                memcpy(&r.payload, p, sizeof(double));
+                p += sizeof(double);
+            }
+        }
+        _read += h[0];
+        return h[0];
+    }
+
+    bool BinaryTraceReader::next(TraceRecord &r)
+    {
+        if (_pos == _avail) {
+            _avail = fill();
+            _pos = 0;
+            if (_avail == 0) return false;
+        }
+        r = _buf[_pos++];
+        return true;
+    }
+
+    string BinaryTraceReader::getName(BinaryTrace::NameKind k, uint32_t id) const
+    {
+        map<pair<uint32_t, uint32_t>, string>::const_iterator i = 
+            _names.find(make_pair(uint32_t(k), id));
+        if (i != _names.end()) return i->second;
+        stringstream ss;
+        ss << id;
+        return ss.str();
+    }
+
+    void BinaryTraceReader::toAscii(ostream &os)
+    {
+        TraceRecord r;
+        while (next(r)) {
+            os << r.tick << '\t';
+            if (r.entity != BinaryTrace::NO_ENTITY)
+                os << getName(BinaryTrace::ENTITY_NAME, r.entity) << '\t';
+            os << getName(BinaryTrace::TYPE_NAME, r.type);
+            if (r.payload != 0) os << '\t' << r.payload;
+            os << '\n';
+        }
+        os.flush();
+    }
+
+} // namespace MetaSim
@@ -0,0 +1,274 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __BINTRACE_HPP__
+#define __BINTRACE_HPP__
+
+#include <cstddef>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#include <stdint.h>
+
+#include <baseexc.hpp>
+#include <tick.hpp>
+#include <trace.hpp>
+
+namespace MetaSim {
+
+    /**
+       \ingroup metasim_stat
+
+       A record of a binary trace (see BinaryTrace): the time, the
+       type of the record (for example, the type of the event or
+       the new state of the entity), the entity and a value.
+    */
+    struct TraceRecord {
+        int64_t tick;
+        uint32_t type;
+        uint32_t entity;
+        double payload;
+    };
+
+    /**
+       \ingroup metasim_stat
+
+       The header at the beginning of a binary trace file. All the
+       fields are written in the byte order of the machine that
+       wrote the trace; the reader checks byteOrder.
+
+       The file is made of the header, followed by <i>records</i>
+       TraceRecord structures (or, if flags contains
+       BinaryTrace::FLAG_COMPRESSED, by compressed blocks of
+       records), followed by the name table (if
+       namesOffset is not 0): a 32 bit count, then for every name
+       its kind, its ID and its length (32 bit each), followed by
+       the characters of the name.
+    */
+    struct TraceHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t recordSize;
+        uint32_t byteOrder;
+        uint32_t flags;
+        uint64_t records;
+        uint64_t namesOffset;
+    };
+
+    /**
+       \ingroup metasim_stat
+
+       A compact binary trace, made of fixed-size records (see
+       TraceRecord). The records are collected in a large buffer
+       and written with a single write every <i>bufferSize</i>
+       records, without formatting and without flushing after every
+       record, so that tracing long runs costs little more than a
+       copy of 24 bytes per record.
+
+       The names of the record types and of the entities can be
+       given with setName() at any time: they are written at the
+       end of the file when it is closed, so they do not cost
+       anything while the simulation runs. The trace can be read
+       with BinaryTraceReader, and converted to text with
+       BinaryTraceReader::toAscii() or with the trace2ascii tool.
+
+       If <i>compress</i> is true, every buffer is written as a
+       compressed block: the number of records and the length in
+       bytes (32 bit each), followed by the records encoded as
+       variable-length integers, the time as the difference from
+       the previous record of the block. A record usually takes 4
+       to 6 bytes instead of 24, at the cost of the encoding.
+
+       When the trace is added to an event (Event::addTrace()),
+       every execution of the event is recorded with the event
+       type as record type (see typeId()) and NO_ENTITY.
+    */
+    class BinaryTrace : public Trace {
+    public:
+        /// The kinds of name of the name table
+        enum NameKind { TYPE_NAME = 0, ENTITY_NAME = 1 };
+
+        /// The entity of the records not related to an entity
+        static const uint32_t NO_ENTITY = 0xffffffff;
+
+        static const uint32_t VERSION = 1;
+        static const uint32_t FLAG_COMPRESSED = 1;
+        static const uint32_t ORDER_MARK = 0x01020304;
+        static const char MAGIC[8];
+
+        /**
+           Creates the file and writes the header.
+
+           @param filename   the name of the file
+           @param bufferSize the number of records written together
+           @param compress   true to write compressed blocks
+        */
+        BinaryTrace(const std::string &filename, size_t bufferSize = 65536,
+                    bool compress = false);
+        ~BinaryTrace();
+
+        /// Appends a record to the trace
+        inline void record(Tick t, uint32_t type, uint32_t entity,
+                           double payload = 0)
+            {
+                TraceRecord &r = _buf[_used];
+                r.tick = int64_t(t);
+                r.type = type;
+                r.entity = entity;
+                r.payload = payload;
+                if (++_used == _buf.size()) flush();
+            }
+
+        inline void record(const TraceRecord &r)
+            {
+                _buf[_used] = r;
+                if (++_used == _buf.size()) flush();
+            }
+
+        /// Records the execution of event e
+        virtual void record(Event *e);
+
+        /**
+           Returns the record type associated to the C++ type t,
+           registering its name the first time.
+        */
+        uint32_t typeId(const std::type_info &t);
+
+        /// Gives the name n to the ID id of kind k
+        void setName(NameKind k, uint32_t id, const std::string &n);
+
+        /// Writes the buffered records to the file
+        void flush();
+
+        /// Reopens (and truncates) the file
+        virtual void open(bool type = BINARY);
+
+        /// Writes the buffered records and the names, and closes
+        /// the file
+        virtual void close();
+
+        /// Number of records written so far
+        uint64_t getRecords() const { return _records + _used; }
+
+    protected:
+        std::vector<TraceRecord> _buf;
+        size_t _used;
+        uint64_t _records;
+        std::map<std::pair<uint32_t, uint32_t>, std::string> _names;
+        std::map<const std::type_info *, uint32_t> _typeIds;
+        uint32_t _flags;
+        std::vector<unsigned char> _block;
+
+        void writeHeader(uint64_t namesOffset);
+    };
+
+    /**
+       \ingroup metasim_stat
+
+       Reads a file written by BinaryTrace, one record at a time,
+       with large buffered reads.
+
+       @code
+       BinaryTraceReader r("trace.bin");
+       for (BinaryTraceReader::iterator i = r.begin(); i != r.end(); ++i)
+           cout << i->tick << " " << r.getName(BinaryTrace::ENTITY_NAME, i->entity);
+       @endcode
+    */
+    class BinaryTraceReader {
+    public:
+        /**
+           \ingroup metasim_exc
+
+           Exceptions for the trace reader.
+        */
+        class Exc : public BaseExc {
+        public:
+            Exc(const std::string message,
+                const std::string cl = "BinaryTraceReader",
+                const std::string md = "bintrace.cpp")
+                : BaseExc(message,cl,md) {} ;
+        };
+
+        /// Opens the file and reads the header and the names
+        BinaryTraceReader(const std::string &filename,
+                          size_t bufferSize = 65536);
+
+        /// Reads the next record in r; returns false at the end
+        bool next(TraceRecord &r);
+
+        /// Goes back to the first record
+        void rewind();
+
+        /// The number of records in the file
+        uint64_t size() const { return _header.records; }
+
+        const TraceHeader &getHeader() const { return _header; }
+
+        /**
+           The name of ID id of kind k or, if the trace contains
+           no such name, the ID itself written in decimal.
+        */
+        std::string getName(BinaryTrace::NameKind k, uint32_t id) const;
+
+        /**
+           Writes the records from the current position to the
+           end, one per line, in the format of the text traces:
+           the time, the name of the entity and the name of the
+           type separated by tabs, followed by the payload if it
+           is not 0. The entity is omitted for the records without
+           entity.
+        */
+        void toAscii(std::ostream &os);
+
+        /// Input iterator on the records
+        class iterator :
+            public std::iterator<std::input_iterator_tag, TraceRecord> {
+            BinaryTraceReader *_r;
+            TraceRecord _rec;
+        public:
+            iterator(BinaryTraceReader *r = NULL) : _r(r), _rec()
+                { if (_r != NULL && !_r->next(_rec)) _r = NULL; }
+            const TraceRecord &operator*() const { return _rec; }
+            const TraceRecord *operator->() const { return &_rec; }
+            iterator &operator++()
+                { if (!_r->next(_rec)) _r = NULL; return *this; }
+            bool operator==(const iterator &i) const { return _r == i._r; }
+            bool operator!=(const iterator &i) const { return _r != i._r; }
+        };
+
+        /// Iterator from the current position
+        iterator begin() { return iterator(this); }
+        iterator end() { return iterator(); }
+
+    protected:
+        std::ifstream _is;
+        TraceHeader _header;
+        std::map<std::pair<uint32_t, uint32_t>, std::string> _names;
+        std::vector<TraceRecord> _buf;
+        size_t _pos;
+        size_t _avail;
+        uint64_t _read;
+        std::vector<unsigned char> _block;
+
+        /// Refills the buffer, returns the number of records read
+        size_t fill();
+    };
+
+} // namespace MetaSim
+
+#endif // __BINTRACE_HPP__
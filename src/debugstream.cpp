@@ -11,8 +11,9 @@
  *   (at your option) any later version.                                   *
  *                                                                         *
  ***************************************************************************/
-#include <algorithm>
 #include <iostream>
+#include <map>
+#include <mutex>
 
 #include <debugstream.hpp>
 #include <simul.hpp>
@@ -21,6 +22,40 @@ using namespace std;
 
 namespace MetaSim {
 
+    namespace {
+        // the registry of the debug levels, shared by all threads
+        struct LevelRegistry {
+            std::mutex mutex;
+            std::map<std::string, int> ids;
+            std::vector<std::string> names;
+        };
+
+        LevelRegistry &registry()
+        {
+            static LevelRegistry r;
+            return r;
+        }
+    }
+
+    int DebugStream::level(const std::string &s)
+    {
+        LevelRegistry &r = registry();
+        lock_guard<mutex> lock(r.mutex);
+        map<string, int>::iterator i = r.ids.find(s);
+        if (i != r.ids.end()) return i->second;
+        int id = r.names.size();
+        r.ids[s] = id;
+        r.names.push_back(s);
+        return id;
+    }
+
+    string DebugStream::levelName(int id)
+    {
+        LevelRegistry &r = registry();
+        lock_guard<mutex> lock(r.mutex);
+        return r.names.at(id);
+    }
+
     DebugStream::DebugStream() : 
         _os(&cerr),
         _autodelete(false),
@@ -57,41 +92,55 @@ namespace MetaSim {
     void DebugStream::enable(std::string s) 
     {
         if (s == "All") _isDebugAll = true;
-        else {
-            _dbgLevels.push_back(s);
-        }
+        else enable(level(s));
+    }
+
+    void DebugStream::enable(int id) 
+    {
+        if (id >= (int) _dbgLevels.size()) _dbgLevels.resize(id + 1, false);
+        _dbgLevels[id] = true;
     }
 
     void DebugStream::disable(std::string s) 
     {
         if (s == "All") _isDebugAll = false;
-        else {
-            std::vector<std::string>::iterator i = 
-                find(_dbgLevels.begin(),_dbgLevels.end(),s);
-            if (i != _dbgLevels.end()) _dbgLevels.erase(i);
-        }
+        else disable(level(s));
+    }
+
+    void DebugStream::disable(int id) 
+    {
+        if (id < (int) _dbgLevels.size()) _dbgLevels[id] = false;
+    }
+
+    bool DebugStream::inWindow() const
+    {
+        Tick t = SIMUL.getTime();
+        return !(t < _t1) && !(t > _t2);
     }
 
     void DebugStream::enter(std::string s) 
+    {
+        enter(level(s));
+    }
+
+    void DebugStream::enter(int id) 
     {
         _dbgStack.push_back(_isDebug);
-        std::vector<std::string>::iterator i = 
-            find(_dbgLevels.begin(), _dbgLevels.end(), s);
-        if (i == _dbgLevels.end()
-            || (SIMUL.getTime() < _t1) 
-            || (SIMUL.getTime() > _t2)) 
-            _isDebug = false;
-        else
-            _isDebug = true;
+        _isDebug = isEnabled(id) && inWindow();
         _isIndenting = true;
     }
 
     void DebugStream::enter(std::string s, std::string header) 
     {
         enter(s);
+        this->header(header);
+    }
+
+    void DebugStream::header(const std::string &h) 
+    {
         if (filter()) {
             indent();
-            (*_os) << header << endl;
+            (*_os) << h << endl;
             resetIndent();
             _indentLevel++;
         }
@@ -118,13 +167,6 @@ namespace MetaSim {
         _t2 = t2;
     }
 
-    bool DebugStream::filter() const
-    { 
-        if (_isDebug || _isDebugAll)
-            return true;
-        else return false;
-    }
-
     void DebugStream::resetIndent() 
     { 
         _isIndenting = true; 
@@ -25,6 +25,16 @@ namespace MetaSim {
        \ingroup metasim_util
      
        Helper class used to manipulate the debug output.
+
+       Debug levels are identified by a name, and interned to an
+       integer ID the first time the name is used (see level()):
+       the set of enabled levels is a bit vector indexed by ID, so
+       that entering a level only costs a bit test, and the
+       simulation time is checked against the window set with
+       setTransitory() only when the level is enabled. The DBG
+       macros of simul.hpp intern their level once per call site,
+       and do not evaluate their arguments when the output is
+       disabled.
     */
     class DebugStream {
     private:
@@ -34,16 +44,29 @@ namespace MetaSim {
         bool _isDebugAll;
         bool _isIndenting;
         int _indentLevel;
-        std::vector<std::string> _dbgLevels;
+        std::vector<bool> _dbgLevels;
         std::vector<bool> _dbgStack;
 
         Tick _t1;
         Tick _t2;
 
+        bool inWindow() const;
+
     public:
         DebugStream();
         ~DebugStream(); 
 
+        /**
+         * Returns the ID of the debug level called s, registering
+         * it if this is the first time. IDs are shared by all the
+         * simulations of the program, and this function can be
+         * called by any thread.
+         */
+        static int level(const std::string &s);
+
+        /// Returns the name of the debug level with ID id
+        static std::string levelName(int id);
+
         /**
          * Set the debug stream.
          */
@@ -59,12 +82,20 @@ namespace MetaSim {
          *  @param s String that identifies the debug level.
          */
         void enable(std::string s);
+        void enable(int id);
 
         /**
          *  Disable the output for a certain debug level.
          *  @param s String that identifies the debug level.
          */
         void disable(std::string s);
+        void disable(int id);
+
+        /// True if the output of level id is enabled
+        bool isEnabled(int id) const
+            {
+                return id < (int) _dbgLevels.size() && _dbgLevels[id];
+            }
 
         /**
          *  Enters in the specified debug level. From this point until
@@ -72,6 +103,7 @@ namespace MetaSim {
          *  is considered belonging to the current debug level.
          */
         void enter(std::string s);
+        void enter(int id);
 
         /**
          *  Enters in the specified debug level and output the header string.
@@ -80,6 +112,12 @@ namespace MetaSim {
          */
         void enter(std::string s, std::string header);
 
+        /**
+         *  Outputs the header of the current debug level (if its
+         *  output is enabled) and increases the indentation.
+         */
+        void header(const std::string &h);
+
         /**
          *  Exits from the current debug level.
          */  
@@ -96,7 +134,7 @@ namespace MetaSim {
         void setTransitory(Tick t1, Tick t2);
 
         // These helper function are only called by operator << and endl
-        bool filter() const;
+        bool filter() const { return _isDebug || _isDebugAll; }
         void resetIndent();
         void indent();
         std::ostream &getStream();
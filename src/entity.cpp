@@ -22,24 +22,20 @@ namespace MetaSim {
 
     using namespace std;
 
-    map<int, Entity*> Entity::_globMap;
-    map<string, Entity *> Entity::_index;
-    int Entity::_IDcount = 0;
-
     void Entity::_init()
     {
         if (_name == "") {
             std::stringstream ss;
-            ss << _IDcount + 1;
+            ss << _ctx->_entityCount + 1;
             _name = string(typeid(*this).name()) + ss.str();
         }
 
-	if (_index.find(_name) != _index.end())
+	if (_ctx->_entityIndex.find(_name) != _ctx->_entityIndex.end())
   	    throw Exc("Creating an entity with the same name " + _name);
 
-        _IDcount++;
-        _ID = _IDcount;
-        _globMap[_ID] = this;
+        _ctx->_entityCount++;
+        _ID = _ctx->_entityCount;
+        _ctx->_entityMap[_ID] = this;
 
         DBGENTER(_ENTITY_DBG_LEV);
 
@@ -47,7 +43,7 @@ namespace MetaSim {
         DBGPRINT_2("Entity type: ",  typeid(*this).name());
         DBGPRINT_2("Entity name:", _name);
 
-	_index[_name] = this;
+	_ctx->_entityIndex[_name] = this;
     }
 
     // Entity::Entity(const char *n) : _name(n) 
@@ -55,15 +51,16 @@ namespace MetaSim {
     //                 _init();
     //         }
 
-    Entity::Entity(const string &n) : _name(n) 
+    Entity::Entity(const string &n) : 
+        _ctx(&SimulationContext::current()), _name(n) 
     {
         _init();
     }
 
     Entity::~Entity()
     {
-        _globMap.erase(_ID);
-        _index.erase(_name);
+        _ctx->_entityMap.erase(_ID);
+        _ctx->_entityIndex.erase(_name);
     }
 
     void Entity::callNewRun()
@@ -71,9 +68,10 @@ namespace MetaSim {
   
         typedef map<int, Entity*>::iterator EI;
 
-        EI p = _globMap.begin();
+        map<int, Entity*> &m = SimulationContext::current()._entityMap;
+        EI p = m.begin();
 
-        while (p != _globMap.end()) {
+        while (p != m.end()) {
             DBGENTER(_ENTITY_DBG_LEV);
             DBGPRINT_2("Calling the newRun() of ",
                        p->second->getID());
@@ -90,8 +88,9 @@ namespace MetaSim {
     {
         typedef map<int, Entity*>::iterator EI;
 
-        EI p = _globMap.begin();
-        while (p != _globMap.end()) {
+        map<int, Entity*> &m = SimulationContext::current()._entityMap;
+        EI p = m.begin();
+        while (p != m.end()) {
             p->second->endRun();
             p++;
         }
@@ -105,8 +104,9 @@ namespace MetaSim {
  
         typedef map<string, Entity *>::iterator NI;
 
-        NI i = _index.find(n);
-        if (i != _index.end()) res = (*i).second;
+        map<string, Entity *> &idx = SimulationContext::current()._entityIndex;
+        NI i = idx.find(n);
+        if (i != idx.end()) res = (*i).second;
         return res;
     }
 
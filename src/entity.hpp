@@ -34,6 +34,7 @@
 
 #include <baseexc.hpp>
 #include <basetype.hpp>
+#include <simcontext.hpp>
 
 namespace MetaSim {
 
@@ -55,20 +56,14 @@ namespace MetaSim {
             \ingroup metasim_ee   
         */
         class Entity {
-                /** 
-                    It contains pairs <ID, pointer to entity>. It's
-                    used mainly to keep track of all the entities
-                    present in the system. */
-                static std::map<int , Entity *> _globMap;
-  
                 /**
-                   It contains pairs <string, pointer to entity>. It
-                   is used to refer entities by name. The string must
-                   be unique!! */
-                static std::map<std::string, Entity *> _index;
-
-                /// counter for assigning unique IDs to entities
-                static int _IDcount;
+                   The simulation context in which the entity is
+                   registered (the current one at construction
+                   time). The context keeps the pairs <ID, entity>
+                   and <name, entity> of all the entities, and
+                   the counter for assigning unique IDs.
+                */
+                SimulationContext *_ctx;
 
                 /// unique ID for the entity
                 int _ID;
@@ -124,8 +119,10 @@ namespace MetaSim {
                     with that ID. */
                 static inline Entity* getPointer(int id)
                 {
-                        std::map<int, Entity*>::const_iterator p = _globMap.find(id);
-                        if (p == _globMap.end()) return NULL;
+                        const std::map<int, Entity*> &m = 
+                                SimulationContext::current()._entityMap;
+                        std::map<int, Entity*>::const_iterator p = m.find(id);
+                        if (p == m.end()) return NULL;
                         else return p->second;
                 };
 
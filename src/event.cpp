@@ -11,36 +11,37 @@
  *   (at your option) any later version.                                   *
  *                                                                         *
  ***************************************************************************/
+#include <algorithm>
 #include <string>
 #include <typeinfo>
 #include <sstream>
+#include <vector>
 
 #include <entity.hpp>
 #include <event.hpp>
+#include <rollback.hpp>
 #include <simul.hpp>
 
 namespace MetaSim {
-    /** ------------------------------------------------------------
-     * Initialize static members of class Event
-     * ------------------------------------------------------------
-     */
-    Event::EventQueue Event::_eventQueue;
-
-    long Event::counter = 0;
-
     /**
      * Constructor for Event. 
      */
     Event::Event(int p) :
+        _ctx(NULL),
         _order(0),
         _isInQueue(false),
-        _stats(), 
-        _particles(),
-        _traces(),
+        _inBatch(false),
+        _qpos(0),
+        _qprev(NULL),
+        _qnext(NULL),
+        _qchild(NULL),
+        _observers(),
         _time(MAXTICK),
         _lastTime(MAXTICK),
         _priority(p),
         _std_priority(p),
+        _pool(NULL),
+        _poolSize(0),
         _disposable(false)
                 
     {
@@ -48,50 +49,41 @@ namespace MetaSim {
 
     Event::~Event()
     {
-        std::deque<ParticleInterface *>::iterator itp;
-        for (itp=_particles.begin(); itp!=_particles.end(); itp++) 
-            delete (*itp);
-    }
-
-    bool Event::Cmp::operator() (Event* e1, Event* e2) const {
-        Tick firstTime, secondTime;
-	
-        firstTime  = e1->getTime();
-        secondTime = e2->getTime();
-	
-        if (firstTime < secondTime) return true;
-        else if (firstTime == secondTime) {
-            if (e1->getPriority() < e2->getPriority()) return true;
-            else if (e1->getPriority() == e2->getPriority()) {
-                if (e1->_order < (unsigned long)e2->_order) 
-                    return true;
-                else return false;
-            }
-            else return false;
-        }
-        else return false;
+        if (_isInQueue) drop();
+
+        for (size_t i = 0; i < _observers.size(); ++i)
+            if (_observers[i].kind == ObserverList::PARTICLE)
+                delete static_cast<ParticleInterface *>(_observers[i].obj);
     }
 
     void Event::post(Tick myTime, bool disp) throw (Exc, BaseExc)
+    {
+        SimulationContext &ctx = SimulationContext::current();
+        postOrdered(myTime, disp, ctx._eventCounter);
+        ctx._eventCounter++;
+    }
+
+    void Event::postOrdered(Tick myTime, bool disp, unsigned long order)
     {
         if (_isInQueue) throw Exc("Event already enqueued");
 
-        if (myTime < SIMUL.getTime()) {
+        SimulationContext &ctx = SimulationContext::current();
+
+        if (myTime < ctx.globTime) {
 	    std::stringstream str;
-	    str << "Time: " << SIMUL.getTime() << " -- Posting event" << typeid(*this).name() << " in the past at time: " << myTime;
+	    str << "Time: " << ctx.globTime << " -- Posting event" << typeid(*this).name() << " in the past at time: " << myTime;
             throw Exc(str.str());
 	}
 
+        UndoLog *log = UndoLog::active();
+        if (log != NULL) log->saveEvent(this);
+
         setTime(myTime);
 
-        _order = counter++;
+        _ctx = &ctx;
+        _order = order;
 
-        std::pair<EventQueue::iterator,bool> p;
-        p =_eventQueue.insert(this);
-    
-        if (!p.second) {
-            throw Exc("Already in queue!\n");
-        }
+        ctx._eventQueue->insert(this);
 
         _isInQueue = true;
         _disposable = disp;
@@ -101,28 +93,115 @@ namespace MetaSim {
         
     }
 
+    void Event::dispose()
+    {
+        if (_pool == NULL) {
+            delete this;
+            return;
+        }
+        MemoryPool *pool = _pool;
+        size_t sz = _poolSize;
+        this->~Event();
+        pool->deallocate(this, sz);
+    }
+
+    void Event::reschedule(Tick myTime) throw (Exc, BaseExc)
+    {
+        if (!_isInQueue) {
+            post(myTime, _disposable);
+            return;
+        }
+
+        if (myTime < _ctx->globTime) {
+	    std::stringstream str;
+	    str << "Time: " << _ctx->globTime << " -- Rescheduling event" << typeid(*this).name() << " in the past at time: " << myTime;
+            throw Exc(str.str());
+	}
+
+        UndoLog *log = UndoLog::active();
+        if (log != NULL) log->saveEvent(this);
+
+        requeue(myTime, _priority, _ctx->_eventCounter++);
+
+        DBGENTER(_EVENT_DBG_LEV);
+        print();
+    }
+
     // erase the event from the event queue
     void Event::drop()
     {
         DBGENTER(_EVENT_DBG_LEV);
         print();
         
-        _eventQueue.erase(this);
+        if (!_isInQueue) return;
+
+        UndoLog *log = UndoLog::active();
+        if (log != NULL) log->saveEvent(this);
+
+        if (_inBatch) leaveBatch();
+        else _ctx->_eventQueue->erase(this);
         _isInQueue = false;
     };
 
+    void Event::leaveBatch()
+    {
+        _ctx->_batch[_qpos] = NULL;
+        _inBatch = false;
+    }
+
+    void Event::requeue(Tick t, int prio, unsigned long order)
+    {
+        if (!_inBatch) {
+            _ctx->_eventQueue->update(this, t, prio, order);
+            return;
+        }
+        leaveBatch();
+        _time = t;
+        _priority = prio;
+        _order = order;
+        _ctx->_eventQueue->insert(this);
+    }
+
+    Event *Event::extractFirst()
+    {
+        Event *e = SimulationContext::current()._eventQueue->pop();
+        if (e != NULL) e->_isInQueue = false;
+        return e;
+    }
+
+    void Event::extractBatch()
+    {
+        SimulationContext &ctx = SimulationContext::current();
+        std::vector<Event *> &b = ctx._batch;
+        size_t first = b.size();
+        ctx._eventQueue->popBatch(b);
+        for (size_t i = first; i < b.size(); ++i) {
+            b[i]->_inBatch = true;
+            b[i]->_qpos = i;
+        }
+    }
+
 
     void Event::process(bool disp)
     {
         DBGENTER(_EVENT_DBG_LEV);
-        drop();
 //                 setTime(SIMUL.getTime());
         print();
         // WARNING! Changed the behavior completely.  now we
         // do not process the event immediately, but we post
         // in the queue with immediate (maximum) priority.
-        setPriority(_IMMEDIATE_PRIORITY);
-        post(SIMUL.getTime(), disp);
+        UndoLog *log = UndoLog::active();
+        if (log != NULL) log->saveEvent(this);
+
+        if (_isInQueue) {
+            requeue(_ctx->globTime, _IMMEDIATE_PRIORITY, 
+                    _ctx->_eventCounter++);
+            _disposable = disp;
+        }
+        else {
+            setPriority(_IMMEDIATE_PRIORITY);
+            post(SIMUL.getTime(), disp);
+        }
 
 //                 action();
         
@@ -140,10 +219,6 @@ namespace MetaSim {
     // see comment below on exceptions to be thrown by this function
     void Event::action()
     {
-        std::deque<BaseStat *>::iterator its;
-        std::deque<Trace *>::iterator itt;
-        std::deque<ParticleInterface *>::iterator itp;
-
         DBGENTER(_EVENT_DBG_LEV);
 
         /* Handles the event ONLY if it has target!!! Otherwise executes
@@ -161,21 +236,27 @@ namespace MetaSim {
         // It may repost the event
         doit();
 
-        for(its = _stats.begin(); its != _stats.end(); its++)
-            (*its)->probe(this);
+        if (_observers.empty()) return;
 
-        // the new way of doing statistics. The old way
-        // remains valid, but it is deprecated.
-        DBGPRINT_2("Calling the particle probes, size = ", 
-                   _particles.size());
-        for (itp = _particles.begin(); itp != _particles.end(); itp++) {
-            DBGPRINT("Calling probe");
-            (*itp)->probe();
+        // statistics, particles and traces, in this order (the
+        // list keeps them grouped by kind). An index is used
+        // because an observer could add another one.
+        DBGPRINT_2("Calling the observers, size = ", _observers.size());
+        for (size_t i = 0; i < _observers.size(); ++i) {
+            const ObserverList::Entry &o = _observers[i];
+            switch (o.kind) {
+            case ObserverList::STAT:
+                static_cast<BaseStat *>(o.obj)->probe(this);
+                break;
+            case ObserverList::PARTICLE:
+                DBGPRINT("Calling probe");
+                static_cast<ParticleInterface *>(o.obj)->probe();
+                break;
+            case ObserverList::TRACE:
+                static_cast<Trace *>(o.obj)->record(this);
+                break;
+            }
         }
- 
-        for(itt = _traces.begin(); itt != _traces.end(); itt++)
-            (*itt)->record(this);
- 
     }
 
     // DEBUG!!! Prints events data on the dbg stream.
@@ -186,12 +267,23 @@ namespace MetaSim {
                    "] event=", typeid(*this).name());
     }
 
+    void Event::printQueue()
+    {
+        if (!SIMUL.dbg.filter()) return;
+
+        std::vector<Event *> v;
+        SimulationContext::current()._eventQueue->getEvents(v);
+        std::sort(v.begin(), v.end(), Cmp());
+        for (size_t i = 0; i < v.size(); ++i)
+            v[i]->print();
+    }
+
     void Event::addParticle(ParticleInterface *s)
     {
         DBGENTER(_EVENT_DBG_LEV);
         DBGPRINT_2("Event name ", typeid(*this).name());
-        _particles.push_back(s);
-        DBGPRINT_2("size is now: ", _particles.size());
+        _observers.add(s, ObserverList::PARTICLE);
+        DBGPRINT_2("size is now: ", _observers.count(ObserverList::PARTICLE));
     }
 
 } // namespace MetaSim 
@@ -14,15 +14,18 @@
 #ifndef __EVENT_HPP__
 #define __EVENT_HPP__
 
-#include <deque>
 #include <iostream>
 #include <limits>
+#include <new>
 #include <typeinfo>
+#include <utility>
 
 #include <simul.hpp>
 #include <basestat.hpp>
+#include <eventqueue.hpp>
+#include <observers.hpp>
+#include <simcontext.hpp>
 #include <particle.hpp>
-#include <plist.hpp>
 #include <trace.hpp>
 
 namespace MetaSim {
@@ -41,9 +44,10 @@ namespace MetaSim {
         need to derive a class from this, overriding the virtual
         doit() method.
 
-        This class also inclides a static qevent queue, where all
-        "active" events are enqueued. To insert an event in the
-        queue, you can call the post() method specyfing a
+        All the "active" events are enqueued in the event queue of
+        the current simulation (see Simulation::setEventQueue()
+        for the available implementations). To insert an event in
+        the queue, you can call the post() method specyfing a
         triggering time. Events are ordered in the queue by
         triggering time. In case of two events with the same
         triggering time, events are ordered by priority. In fact,
@@ -89,34 +93,40 @@ namespace MetaSim {
                 : BaseExc(message,cl,md) {} ;
         };
   
-    private:
         /**
-           Template specialization for less function
-           object. It is used to order the event in the event
-           queue. Events are ordered by triggering time, and
-           in case of tie, by priority. In case of another
-           tie, event objects are ordered by pointer
-           value. This is because the implementation of the
-           priority queue does not allows ties. If you try to
-           insert an event object twice, you get an exception!
+           Function object used to order the events in the
+           event queue. Events are ordered by triggering time,
+           and in case of tie, by priority. In case of another
+           tie, event objects are ordered by insertion order
+           (FIFO), so that the order is always total and does
+           not depend on the queue implementation. The messages
+           of the parallel engines take an insertion order that
+           does not depend on when they arrive (see
+           Simulation::messageOrder()).
         */
         class Cmp {
         public:
-            bool operator() (Event* e1, Event* e2) const;
+            inline bool operator() (const Event* e1, const Event* e2) const
+                {
+                    if (e1->_time < e2->_time) return true;
+                    if (e2->_time < e1->_time) return false;
+                    if (e1->_priority != e2->_priority)
+                        return e1->_priority < e2->_priority;
+                    return e1->_order < e2->_order;
+                }
         };
-                
-        typedef priority_list<Event*, Cmp> EventQueue;
-  
-        /**
-           Event queue. This is the global event queue, used
-           by the simulation engine.
-        */ 
-        static EventQueue _eventQueue;
+
+    private:
+        friend class EventQueue;
+        friend class Simulation;
+        friend class UndoLog;
 
         /**
-           counter for fifo insertion
+           The simulation context in which the event has been
+           posted the last time: the event is in its event queue
+           when _isInQueue is true.
         */
-        static long counter;
+        SimulationContext *_ctx;
 
         /**
            number of fifo insertion
@@ -125,20 +135,25 @@ namespace MetaSim {
   
         /// Tells if the element is in the event queue;
         bool _isInQueue;
-  
-        /// A queue of all the statistical object. All these
-        /// objects will be "invoked" after the event handler
-        /// (doit()) has been processed.  @todo will be
-        /// removed, eventually
-        std::deque<BaseStat *> _stats;
 
-        /// NEW
-        std::deque<ParticleInterface *> _particles;
+        /// Tells if the event has been extracted with the batch
+        /// of simultaneous events which is being dispatched (see
+        /// Simulation::sim_batch()); such an event is still
+        /// considered in the queue, and its index in the batch
+        /// is kept in _qpos.
+        bool _inBatch;
 
-        /// A queue of object which manage the tracing
-        /// process. All these objects will be "invoked" after
-        /// the event handler (doit()) has been processed.
-        std::deque<Trace *> _traces;
+        /// Position in the event queue (used by the heaps)
+        size_t _qpos;
+
+        /// Links used by the node based event queues
+        Event *_qprev, *_qnext, *_qchild;
+  
+        /// The statistical objects, the particles and the
+        /// traces, all invoked after the event handler (doit())
+        /// has been processed. The particles are owned by the
+        /// event.
+        ObserverList _observers;
 
         /// Triggering time of the event.
         Tick _time;
@@ -159,10 +174,26 @@ namespace MetaSim {
         int _priority;
 
         int _std_priority;
+
+        /// The pool the event has been allocated from by
+        /// create(), and the size of its block; NULL if the
+        /// event has been allocated in another way.
+        MemoryPool *_pool;
+        size_t _poolSize;
 	
         /// We hide operator= to avoid improper use.
         Event& operator=(Event &);
 
+        /// Removes the event from the batch being dispatched
+        void leaveBatch();
+
+        /// Moves the event (which must be queued) to a new
+        /// position in the queue
+        void requeue(Tick t, int prio, unsigned long order);
+
+        /// post() with the given insertion order
+        void postOrdered(Tick myTime, bool disp, unsigned long order);
+
     protected:
         /// Indicates if the event has to be destroyed after
         /// bein processed. Normally, this flag is set to
@@ -223,6 +254,20 @@ namespace MetaSim {
         */
         void post(Tick myTime, bool disp = false) throw(Exc, BaseExc);
 
+        /**
+           Moves the event to a new triggering time. It is
+           equivalent to drop() followed by post(myTime,
+           isDisposable()), and the event is ordered as if it
+           was posted now; however, the event queue moves the
+           event in place instead of extracting and inserting
+           it again. If the event is not in the queue, it is
+           simply posted.
+
+           @param myTime the new triggering time for the event,
+           which cannot be in the past.
+        */
+        void reschedule(Tick myTime) throw(Exc, BaseExc);
+
         /**
            Processes the event immediately. 
         */
@@ -242,12 +287,26 @@ namespace MetaSim {
             object. The event is not extracted from the queue
         */
         static inline Event *getFirst() {
-            if (_eventQueue.empty()) 
-                return NULL;
-            else
-                return _eventQueue.front();
+            return SimulationContext::current()._eventQueue->front();
         }
 
+        /** 
+            Extracts the first event from the event queue and
+            returns it, or returns NULL if the queue is
+            empty. Equivalent to getFirst() followed by
+            drop(), but it does not need to search the event
+            again. Used by the main simulation engine.
+        */
+        static Event *extractFirst();
+
+        /**
+            Extracts from the event queue the first event and all
+            the following ones with the same time and priority,
+            in their order, and puts them in the batch of the
+            current simulation (see Simulation::sim_batch()).
+        */
+        static void extractBatch();
+
         /** 
             Returns the event priority.  It is a identifier
             for the event priority. In the old version, events
@@ -311,6 +370,54 @@ namespace MetaSim {
 
         inline bool isInQueue() { return _isInQueue; }
 
+        /// True if the event has been created by create()
+        inline bool isPooled() const { return _pool != NULL; }
+
+        /**
+           Creates an event of class T with the given constructor
+           arguments, taking the memory from the pool of the
+           current simulation instead of the heap. Such an event
+           must be posted as disposable: after it has been
+           processed, its memory goes back to the pool, to be
+           reused by the next call. Hence, models that create an
+           event for every packet (or job, or message) do not
+           call the system allocator in the steady state.
+
+           @code
+           Event::create<PacketArrival>(node, pkt)->post(t, true);
+           @endcode
+
+           A pooled event must never be destroyed with delete:
+           the simulation that created it disposes of it (see
+           dispose()). For the same reason, it cannot be sent to
+           another logical process: LogicalProcess::send() and
+           TimeWarpLP::send() raise an exception.
+        */
+        template<class T, class... Args>
+        static T *create(Args&&... args) 
+            {
+                MemoryPool &pool = SimulationContext::current()._eventPool;
+                void *mem = pool.allocate(sizeof(T));
+                T *e;
+                try {
+                    e = new (mem) T(std::forward<Args>(args)...);
+                } catch (...) {
+                    pool.deallocate(mem, sizeof(T));
+                    throw;
+                }
+                static_cast<Event *>(e)->_pool = &pool;
+                static_cast<Event *>(e)->_poolSize = sizeof(T);
+                return e;
+            }
+
+        /**
+           Destroys a disposable event: if it was allocated by
+           create(), its memory goes back to the pool, otherwise
+           it is deleted. Called by the simulation engine after
+           the event has been processed.
+        */
+        void dispose();
+
         /** 
             Add a new stat probe to this event. All the
             statistical objects that are related to this event
@@ -321,7 +428,7 @@ namespace MetaSim {
             by a different kind of mechanisms.
         */
         inline void addStat(BaseStat *actStat) { 
-            _stats.push_back(actStat);
+            _observers.add(actStat, ObserverList::STAT);
         }
 
         /** 
@@ -334,7 +441,9 @@ namespace MetaSim {
             Add a new trace probe to this event. It is useful
             for defining different kinds of tracing all at the
             same time.  */
-        inline void addTrace(Trace *t) { _traces.push_back(t); }  
+        inline void addTrace(Trace *t) {
+            _observers.add(t, ObserverList::TRACE);
+        }  
 
         /** 
             This method is called when the event is triggered.
@@ -364,14 +473,7 @@ namespace MetaSim {
         /** 
             for debugging
         */
-        static void printQueue() {
-            EventQueue::iterator it;
-    
-            for (it = _eventQueue.begin(); 
-                 it != _eventQueue.end(); 
-                 it++) 
-                (*it)->print();
-        }
+        static void printQueue();
 
     };
 
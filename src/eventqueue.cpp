@@ -0,0 +1,811 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <algorithm>
+#include <limits>
+
+#include <event.hpp>
+#include <eventqueue.hpp>
+
+namespace MetaSim {
+
+    EventQueue *EventQueue::create(Type t)
+    {
+        switch (t) {
+        case SET:
+            return new SetEventQueue();
+        case BINARY_HEAP:
+            return new BinaryHeapEventQueue();
+        case QUAD_HEAP:
+            return new QuadHeapEventQueue();
+        case PAIRING_HEAP:
+            return new PairingHeapEventQueue();
+        case CALENDAR:
+            return new CalendarEventQueue();
+        case LADDER:
+            return new LadderEventQueue();
+        }
+        throw Exc("Unknown event queue type");
+    }
+
+    inline bool EventQueue::less(const Event *e1, const Event *e2)
+    {
+        return Event::Cmp()(e1, e2);
+    }
+
+    inline size_t &EventQueue::pos(Event *e) { return e->_qpos; }
+    inline Event *&EventQueue::prev(Event *e) { return e->_qprev; }
+    inline Event *&EventQueue::next(Event *e) { return e->_qnext; }
+    inline Event *&EventQueue::child(Event *e) { return e->_qchild; }
+
+    inline void EventQueue::setKey(Event *e, Tick t, int prio, 
+                                   unsigned long order)
+    {
+        e->_time = t;
+        e->_priority = prio;
+        e->_order = order;
+    }
+
+    void EventQueue::update(Event *e, Tick t, int prio, unsigned long order)
+    {
+        erase(e);
+        setKey(e, t, prio, order);
+        insert(e);
+    }
+
+    void EventQueue::popBatch(std::vector<Event *> &v)
+    {
+        Event *e = pop();
+        if (e == NULL) return;
+        v.push_back(e);
+
+        Event *f;
+        while ((f = front()) != NULL && f->_time == e->_time && 
+               f->_priority == e->_priority)
+            v.push_back(pop());
+    }
+
+    /*-----------------------------------------------------*/
+
+    void SetEventQueue::insert(Event *e)
+    {
+        if (!_set.insert(e).second)
+            throw Exc("Already in queue!\n");
+    }
+
+    void SetEventQueue::erase(Event *e)
+    {
+        _set.erase(e);
+    }
+
+    Event *SetEventQueue::front()
+    {
+        if (_set.empty()) return NULL;
+        return *_set.begin();
+    }
+
+    Event *SetEventQueue::pop()
+    {
+        if (_set.empty()) return NULL;
+        Event *e = *_set.begin();
+        _set.erase(_set.begin());
+        return e;
+    }
+
+    void SetEventQueue::popBatch(std::vector<Event *> &v)
+    {
+        if (_set.empty()) return;
+        Event *e = *_set.begin();
+        Set::iterator i = _set.begin();
+        while (i != _set.end() && (*i)->getTime() == e->getTime() &&
+               (*i)->getPriority() == e->getPriority())
+            v.push_back(*i++);
+        _set.erase(_set.begin(), i);
+    }
+
+    void SetEventQueue::getEvents(std::vector<Event *> &v) const
+    {
+        v.insert(v.end(), _set.begin(), _set.end());
+    }
+
+    /*-----------------------------------------------------*/
+
+    template<int D>
+    void HeapEventQueue<D>::siftUp(size_t i)
+    {
+        Event *e = _heap[i];
+        while (i > 0) {
+            size_t p = (i - 1) / D;
+            if (!less(e, _heap[p])) break;
+            place(_heap[p], i);
+            i = p;
+        }
+        place(e, i);
+    }
+
+    template<int D>
+    void HeapEventQueue<D>::siftDown(size_t i)
+    {
+        Event *e = _heap[i];
+        size_t n = _heap.size();
+        for (;;) {
+            size_t c = D * i + 1;
+            if (c >= n) break;
+            size_t last = std::min(c + D, n);
+            size_t best = c;
+            for (size_t k = c + 1; k < last; ++k)
+                if (less(_heap[k], _heap[best])) best = k;
+            if (!less(_heap[best], e)) break;
+            place(_heap[best], i);
+            i = best;
+        }
+        place(e, i);
+    }
+
+    template<int D>
+    void HeapEventQueue<D>::restore(size_t i)
+    {
+        if (i > 0 && less(_heap[i], _heap[(i - 1) / D])) siftUp(i);
+        else siftDown(i);
+    }
+
+    template<int D>
+    void HeapEventQueue<D>::insert(Event *e)
+    {
+        _heap.push_back(e);
+        siftUp(_heap.size() - 1);
+    }
+
+    template<int D>
+    void HeapEventQueue<D>::erase(Event *e)
+    {
+        size_t i = pos(e);
+        if (i >= _heap.size() || _heap[i] != e)
+            throw Exc("Event not in queue");
+
+        Event *last = _heap.back();
+        _heap.pop_back();
+        if (i == _heap.size()) return;
+
+        place(last, i);
+        restore(i);
+    }
+
+    template<int D>
+    void HeapEventQueue<D>::update(Event *e, Tick t, int prio, 
+                                   unsigned long order)
+    {
+        size_t i = pos(e);
+        if (i >= _heap.size() || _heap[i] != e)
+            throw Exc("Event not in queue");
+
+        setKey(e, t, prio, order);
+        restore(i);
+    }
+
+    template<int D>
+    Event *HeapEventQueue<D>::pop()
+    {
+        if (_heap.empty()) return NULL;
+
+        Event *e = _heap[0];
+        Event *last = _heap.back();
+        _heap.pop_back();
+        if (!_heap.empty()) {
+            place(last, 0);
+            siftDown(0);
+        }
+        return e;
+    }
+
+    template<int D>
+    void HeapEventQueue<D>::getEvents(std::vector<Event *> &v) const
+    {
+        v.insert(v.end(), _heap.begin(), _heap.end());
+    }
+
+    template class HeapEventQueue<2>;
+    template class HeapEventQueue<4>;
+
+    /*-----------------------------------------------------*/
+
+    // Links: child(e) is the first child of e, next(e) the sibling
+    // on its right, prev(e) the sibling on its left or the parent
+    // when e is the first child. Roots have prev == next == NULL.
+
+    Event *PairingHeapEventQueue::meld(Event *a, Event *b)
+    {
+        if (a == NULL) return b;
+        if (b == NULL) return a;
+        if (less(b, a)) std::swap(a, b);
+
+        // b becomes the first child of a
+        next(b) = child(a);
+        if (child(a) != NULL) prev(child(a)) = b;
+        prev(b) = a;
+        child(a) = b;
+        return a;
+    }
+
+    Event *PairingHeapEventQueue::mergePairs(Event *first)
+    {
+        if (first == NULL) return NULL;
+
+        // first pass: meld the siblings in pairs, from left to
+        // right, and push the results on a stack (linked by next)
+        Event *stack = NULL;
+        while (first != NULL) {
+            Event *a = first;
+            Event *b = next(a);
+            first = (b != NULL) ? next(b) : NULL;
+            prev(a) = next(a) = NULL;
+            if (b != NULL) {
+                prev(b) = next(b) = NULL;
+                a = meld(a, b);
+            }
+            next(a) = stack;
+            stack = a;
+        }
+
+        // second pass: meld the pairs from right to left
+        Event *r = stack;
+        stack = next(r);
+        next(r) = NULL;
+        while (stack != NULL) {
+            Event *a = stack;
+            stack = next(a);
+            next(a) = NULL;
+            r = meld(r, a);
+        }
+        return r;
+    }
+
+    void PairingHeapEventQueue::detach(Event *e)
+    {
+        Event *p = prev(e);
+        if (child(p) == e) child(p) = next(e);
+        else next(p) = next(e);
+        if (next(e) != NULL) prev(next(e)) = p;
+        prev(e) = next(e) = NULL;
+    }
+
+    void PairingHeapEventQueue::insert(Event *e)
+    {
+        prev(e) = next(e) = child(e) = NULL;
+        _root = meld(_root, e);
+        ++_size;
+    }
+
+    void PairingHeapEventQueue::erase(Event *e)
+    {
+        if (e == _root) {
+            pop();
+            return;
+        }
+        detach(e);
+        Event *sub = mergePairs(child(e));
+        child(e) = NULL;
+        _root = meld(_root, sub);
+        --_size;
+    }
+
+    void PairingHeapEventQueue::update(Event *e, Tick t, int prio, 
+                                       unsigned long order)
+    {
+        // the insertion order always grows, so the key decreases
+        // only if the time or the priority decrease
+        bool decrease = t < e->getTime() ||
+            (t == e->getTime() && prio < e->getPriority());
+
+        if (!decrease) {
+            EventQueue::update(e, t, prio, order);
+            return;
+        }
+
+        // decrease-key: the subtree rooted in e is still a
+        // valid heap, cut it and meld it with the root
+        setKey(e, t, prio, order);
+        if (e != _root) {
+            detach(e);
+            _root = meld(_root, e);
+        }
+    }
+
+    Event *PairingHeapEventQueue::pop()
+    {
+        Event *e = _root;
+        if (e == NULL) return NULL;
+
+        _root = mergePairs(child(e));
+        child(e) = NULL;
+        --_size;
+        return e;
+    }
+
+    void PairingHeapEventQueue::getEvents(std::vector<Event *> &v) const
+    {
+        std::vector<Event *> todo;
+        if (_root != NULL) todo.push_back(_root);
+        while (!todo.empty()) {
+            Event *e = todo.back();
+            todo.pop_back();
+            v.push_back(e);
+            if (next(e) != NULL) todo.push_back(next(e));
+            if (child(e) != NULL) todo.push_back(child(e));
+        }
+    }
+
+    /*-----------------------------------------------------*/
+
+    // Every bucket is a list sorted by Event::Cmp, linked with
+    // prev/next; pos(e) is the index of the bucket. The current
+    // day ends at _top; all the events in the queue are never
+    // earlier than the beginning of the current day (_top - _width).
+
+    const size_t CalendarEventQueue::MIN_BUCKETS;
+    const size_t CalendarEventQueue::SAMPLE_SIZE;
+
+    CalendarEventQueue::CalendarEventQueue() :
+        _head(MIN_BUCKETS, (Event *)NULL),
+        _tail(MIN_BUCKETS, (Event *)NULL),
+        _mask(MIN_BUCKETS - 1),
+        _width(1),
+        _size(0),
+        _cur(0),
+        _top(1),
+        _lastKey(0),
+        _gapSum(0),
+        _gapCount(0)
+    {
+    }
+
+    inline CalendarEventQueue::key_t CalendarEventQueue::key(const Event *e)
+    {
+        return (long int) e->getTime();
+    }
+
+    void CalendarEventQueue::setCursor(key_t k)
+    {
+        key_t start = (k / _width) * _width;
+        _cur = bucket(k);
+        if (start > std::numeric_limits<key_t>::max() - _width)
+            _top = std::numeric_limits<key_t>::max();
+        else
+            _top = start + _width;
+    }
+
+    Event *CalendarEventQueue::locate()
+    {
+        if (_size == 0) return NULL;
+
+        // scan at most one year, day by day
+        for (size_t n = 0; n < _head.size(); ++n) {
+            Event *h = _head[_cur];
+            if (h != NULL && key(h) < _top) return h;
+            _cur = (_cur + 1) & _mask;
+            if (_top > std::numeric_limits<key_t>::max() - _width)
+                _top = std::numeric_limits<key_t>::max();
+            else
+                _top += _width;
+        }
+
+        // the events are very sparse: direct search among the
+        // heads of the buckets
+        Event *best = NULL;
+        for (size_t i = 0; i < _head.size(); ++i)
+            if (_head[i] != NULL && (best == NULL || less(_head[i], best)))
+                best = _head[i];
+        setCursor(key(best));
+        return best;
+    }
+
+    void CalendarEventQueue::link(Event *e)
+    {
+        size_t b = bucket(key(e));
+        pos(e) = b;
+
+        // most of the insertions go at the end of the bucket
+        // (same time, greater insertion order), so we search
+        // backwards starting from the tail
+        Event *p = _tail[b];
+        while (p != NULL && less(e, p)) p = prev(p);
+
+        prev(e) = p;
+        if (p == NULL) {
+            next(e) = _head[b];
+            _head[b] = e;
+        }
+        else {
+            next(e) = next(p);
+            next(p) = e;
+        }
+        if (next(e) == NULL) _tail[b] = e;
+        else prev(next(e)) = e;
+    }
+
+    void CalendarEventQueue::unlink(Event *e)
+    {
+        size_t b = pos(e);
+        if (prev(e) == NULL) _head[b] = next(e);
+        else next(prev(e)) = next(e);
+        if (next(e) == NULL) _tail[b] = prev(e);
+        else prev(next(e)) = prev(e);
+        prev(e) = next(e) = NULL;
+    }
+
+    void CalendarEventQueue::insert(Event *e)
+    {
+        key_t k = key(e);
+        if (_size == 0 || k < _top - _width) setCursor(k);
+
+        link(e);
+        ++_size;
+
+        if (_size > 2 * _head.size()) resize(2 * _head.size());
+    }
+
+    void CalendarEventQueue::erase(Event *e)
+    {
+        unlink(e);
+        --_size;
+
+        if (_size < _head.size() / 2 && _head.size() > MIN_BUCKETS)
+            resize(_head.size() / 2);
+    }
+
+    bool CalendarEventQueue::checkWidth(key_t k, size_t n)
+    {
+        // check that the width is still adequate for the
+        // separation of the extracted events
+        if (k >= _lastKey) {
+            _gapSum += k - _lastKey;
+            _gapCount += n;
+        }
+        _lastKey = k;
+        if (_gapCount >= 2 * _head.size()) {
+            key_t w = std::max(key_t(1), 3 * (_gapSum / key_t(_gapCount)));
+            _gapSum = 0;
+            _gapCount = 0;
+            if (w > 2 * _width || 2 * w < _width) {
+                rebuild(_head.size(), w);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Event *CalendarEventQueue::pop()
+    {
+        Event *e = locate();
+        if (e == NULL) return NULL;
+
+        unlink(e);
+        --_size;
+
+        if (checkWidth(key(e), 1)) return e;
+
+        if (_size < _head.size() / 2 && _head.size() > MIN_BUCKETS)
+            resize(_head.size() / 2);
+
+        return e;
+    }
+
+    void CalendarEventQueue::popBatch(std::vector<Event *> &v)
+    {
+        Event *e = locate();
+        if (e == NULL) return;
+
+        // the events with the same time are all in the same
+        // bucket, in order: they are its first ones
+        size_t b = pos(e);
+        key_t k = key(e);
+        Tick t = e->getTime();
+        int prio = e->getPriority();
+        size_t n = 0;
+        do {
+            unlink(e);
+            --_size;
+            v.push_back(e);
+            n++;
+            e = _head[b];
+        } while (e != NULL && e->getTime() == t && e->getPriority() == prio);
+
+        // the queue is not shrunk: usually the handlers of the
+        // batch post as many events again
+        checkWidth(k, n);
+    }
+
+    void CalendarEventQueue::resize(size_t nb)
+    {
+        // Brown's heuristic: the new width is three times the
+        // average separation of the first events, excluding the
+        // separations greater than twice the average
+        std::vector<Event *> v;
+        getEvents(v);
+        size_t n = std::min(v.size(), SAMPLE_SIZE);
+        if (n < 2) {
+            rebuild(nb, _width);
+            return;
+        }
+        std::partial_sort(v.begin(), v.begin() + n, v.end(), Event::Cmp());
+
+        double avg = double(key(v[n - 1]) - key(v[0])) / (n - 1);
+        double sum = 0;
+        size_t count = 0;
+        for (size_t i = 1; i < n; ++i) {
+            double gap = key(v[i]) - key(v[i - 1]);
+            if (gap <= 2 * avg) {
+                sum += gap;
+                count++;
+            }
+        }
+        key_t w = _width;
+        if (count > 0 && sum > 0) 
+            w = std::max(key_t(1), key_t(3 * sum / count));
+        rebuild(nb, w);
+    }
+
+    void CalendarEventQueue::rebuild(size_t nb, key_t width)
+    {
+        std::vector<Event *> v;
+        getEvents(v);
+        std::sort(v.begin(), v.end(), Event::Cmp());
+
+        _head.assign(nb, (Event *)NULL);
+        _tail.assign(nb, (Event *)NULL);
+        _mask = nb - 1;
+        _width = width;
+
+        // in order, so that every event is appended to the tail
+        for (size_t i = 0; i < v.size(); ++i) link(v[i]);
+        if (!v.empty()) setCursor(key(v[0]));
+    }
+
+    void CalendarEventQueue::getEvents(std::vector<Event *> &v) const
+    {
+        for (size_t i = 0; i < _head.size(); ++i)
+            for (Event *e = _head[i]; e != NULL; e = next(e))
+                v.push_back(e);
+    }
+
+    /*-----------------------------------------------------*/
+
+    const size_t LadderEventQueue::THRESHOLD;
+    const size_t LadderEventQueue::MAX_RUNGS;
+    const size_t LadderEventQueue::TOP;
+    const size_t LadderEventQueue::BOTTOM;
+    const int LadderEventQueue::RUNG_SHIFT;
+
+    LadderEventQueue::LadderEventQueue() :
+        _top(NULL),
+        _topStart(std::numeric_limits<key_t>::min()),
+        _topMin(0),
+        _topMax(0),
+        _topSize(0),
+        _rungs(),
+        _bottom(NULL),
+        _bottomTail(NULL),
+        _bottomSize(0),
+        _size(0)
+    {
+    }
+
+    inline LadderEventQueue::key_t LadderEventQueue::key(const Event *e)
+    {
+        return (long int) e->getTime();
+    }
+
+    // the top and the buckets are unsorted lists, with the new
+    // events at the head
+
+    void LadderEventQueue::push(Event *&head, Event *e)
+    {
+        prev(e) = NULL;
+        next(e) = head;
+        if (head != NULL) prev(head) = e;
+        head = e;
+    }
+
+    void LadderEventQueue::remove(Event *&head, Event *e)
+    {
+        if (prev(e) == NULL) head = next(e);
+        else next(prev(e)) = next(e);
+        if (next(e) != NULL) prev(next(e)) = prev(e);
+        prev(e) = next(e) = NULL;
+    }
+
+    void LadderEventQueue::insertBottom(Event *e)
+    {
+        // usually the new event goes near the end
+        Event *p = _bottomTail;
+        while (p != NULL && less(e, p)) p = prev(p);
+
+        prev(e) = p;
+        if (p == NULL) {
+            next(e) = _bottom;
+            _bottom = e;
+        }
+        else {
+            next(e) = next(p);
+            next(p) = e;
+        }
+        if (next(e) == NULL) _bottomTail = e;
+        else prev(next(e)) = e;
+        pos(e) = BOTTOM;
+        _bottomSize++;
+    }
+
+    void LadderEventQueue::addToRung(size_t r, Event *e)
+    {
+        Rung &g = _rungs[r];
+        size_t b = size_t((key(e) - g.start) / g.width);
+        push(g.head[b], e);
+        g.count[b]++;
+        g.size++;
+        pos(e) = (r << RUNG_SHIFT) | b;
+    }
+
+    void LadderEventQueue::insert(Event *e)
+    {
+        key_t k = key(e);
+        ++_size;
+
+        if (k >= _topStart) {
+            if (_topSize == 0 || k < _topMin) _topMin = k;
+            if (_topSize == 0 || k > _topMax) _topMax = k;
+            push(_top, e);
+            pos(e) = TOP;
+            _topSize++;
+            return;
+        }
+        // the first rung whose current bucket does not begin
+        // after the event
+        for (size_t r = 0; r < _rungs.size(); ++r) {
+            if (k >= _rungs[r].curStart()) {
+                addToRung(r, e);
+                return;
+            }
+        }
+        insertBottom(e);
+    }
+
+    void LadderEventQueue::erase(Event *e)
+    {
+        size_t p = pos(e);
+        if (p == TOP) {
+            remove(_top, e);
+            _topSize--;
+        }
+        else if (p == BOTTOM) {
+            if (e == _bottomTail) _bottomTail = prev(e);
+            remove(_bottom, e);
+            _bottomSize--;
+        }
+        else {
+            Rung &g = _rungs[p >> RUNG_SHIFT];
+            size_t b = p & ((size_t(1) << RUNG_SHIFT) - 1);
+            remove(g.head[b], e);
+            g.count[b]--;
+            g.size--;
+        }
+        if (--_size == 0) {
+            // nothing is left: the next events start a new ladder
+            _rungs.clear();
+            _topStart = std::numeric_limits<key_t>::min();
+        }
+    }
+
+    void LadderEventQueue::spawn(Event *list, size_t nb, key_t start, key_t width)
+    {
+        _rungs.push_back(Rung());
+        Rung &g = _rungs.back();
+        g.start = start;
+        g.width = width;
+        g.cur = 0;
+        g.size = 0;
+        g.head.assign(nb, (Event *)NULL);
+        g.count.assign(nb, 0);
+
+        size_t r = _rungs.size() - 1;
+        while (list != NULL) {
+            Event *e = list;
+            list = next(e);
+            addToRung(r, e);
+        }
+    }
+
+    bool LadderEventQueue::refill()
+    {
+        while (true) {
+            if (_rungs.empty()) {
+                if (_topSize == 0) return false;
+
+                // the top becomes the first rung
+                key_t range = _topMax - _topMin;
+                key_t width = range / key_t(_topSize) + 1;
+                size_t nb = size_t(range / width) + 1;
+                Event *list = _top;
+                _top = NULL;
+                _topSize = 0;
+                spawn(list, nb, _topMin, width);
+                if (_topMax >= std::numeric_limits<key_t>::max() - width)
+                    _topStart = std::numeric_limits<key_t>::max();
+                else
+                    _topStart = _topMin + key_t(nb) * width;
+                continue;
+            }
+
+            Rung &g = _rungs.back();
+            while (g.cur < g.head.size() && g.head[g.cur] == NULL) g.cur++;
+            if (g.cur == g.head.size()) {
+                _rungs.pop_back();
+                continue;
+            }
+
+            size_t b = g.cur;
+            size_t n = g.count[b];
+            Event *list = g.head[b];
+            key_t start = g.curStart();
+            key_t width = g.width;
+            g.head[b] = NULL;
+            g.count[b] = 0;
+            g.size -= n;
+            g.cur++;
+
+            if (n > THRESHOLD && width > 1 && _rungs.size() < MAX_RUNGS) {
+                key_t w = std::max(key_t(1), width / key_t(n));
+                spawn(list, size_t((width - 1) / w) + 1, start, w);
+                continue;
+            }
+
+            // sorted into the bottom
+            std::vector<Event *> v;
+            v.reserve(n);
+            for (Event *e = list; e != NULL; e = next(e)) v.push_back(e);
+            std::sort(v.begin(), v.end(), Event::Cmp());
+            for (size_t i = 0; i < v.size(); ++i) {
+                prev(v[i]) = i > 0 ? v[i - 1] : NULL;
+                next(v[i]) = i + 1 < v.size() ? v[i + 1] : NULL;
+                pos(v[i]) = BOTTOM;
+            }
+            _bottom = v.front();
+            _bottomTail = v.back();
+            _bottomSize = v.size();
+            return true;
+        }
+    }
+
+    Event *LadderEventQueue::front()
+    {
+        if (_bottom == NULL && !refill()) return NULL;
+        return _bottom;
+    }
+
+    Event *LadderEventQueue::pop()
+    {
+        Event *e = front();
+        if (e != NULL) erase(e);
+        return e;
+    }
+
+    void LadderEventQueue::getEvents(std::vector<Event *> &v) const
+    {
+        for (Event *e = _top; e != NULL; e = next(e)) v.push_back(e);
+        for (size_t r = 0; r < _rungs.size(); ++r)
+            for (size_t b = 0; b < _rungs[r].head.size(); ++b)
+                for (Event *e = _rungs[r].head[b]; e != NULL; e = next(e))
+                    v.push_back(e);
+        for (Event *e = _bottom; e != NULL; e = next(e)) v.push_back(e);
+    }
+
+} // namespace MetaSim
@@ -0,0 +1,400 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __EVENTQUEUE_HPP__
+#define __EVENTQUEUE_HPP__
+
+#include <cstddef>
+#include <limits>
+#include <set>
+#include <vector>
+
+#include <baseexc.hpp>
+#include <mempool.hpp>
+#include <tick.hpp>
+
+namespace MetaSim {
+
+    class Event;
+
+    /**
+       \ingroup metasim_ee
+
+       The interface of the event queue used by the simulation
+       engine. Events are kept ordered by triggering time, then by
+       priority, then by insertion order (see Event::Cmp); every
+       implementation must respect exactly this ordering, so that
+       changing the queue never changes the result of a simulation.
+
+       The queue does not own the events. The implementations that
+       need per-event bookkeeping (position in the heap, links of the
+       node based structures) keep it inside the Event object itself,
+       so that erasing an event never requires a search.
+
+       The implementation is selected with
+       Simulation::setEventQueue().
+    */
+    class EventQueue {
+    public:
+        /// The available implementations
+        enum Type {
+            /// red-black tree (std::set), the original implementation
+            SET,
+            /// binary heap with intrusive position index
+            BINARY_HEAP,
+            /// 4-ary heap with intrusive position index
+            QUAD_HEAP,
+            /// pairing heap with intrusive links
+            PAIRING_HEAP,
+            /// calendar queue (Brown) with automatic resizing
+            CALENDAR,
+            /// ladder queue (Tang, Goh and Thng)
+            LADDER
+        };
+
+        /// The implementation used when nothing else is specified
+        static const Type DEFAULT = QUAD_HEAP;
+
+        /**
+           \ingroup metasim_exc
+
+           Exceptions for the event queues.
+        */
+        class Exc : public BaseExc {
+        public:
+            Exc(const std::string message,
+                const std::string cl = "EventQueue",
+                const std::string md = "eventqueue.cpp")
+                : BaseExc(message,cl,md) {} ;
+        };
+
+        virtual ~EventQueue() {}
+
+        /// Builds a new (empty) queue of the given type
+        static EventQueue *create(Type t);
+
+        /// Inserts the event, its time must be already set
+        virtual void insert(Event *e) = 0;
+
+        /// Removes the event, which must be in this queue
+        virtual void erase(Event *e) = 0;
+
+        /**
+           Changes the key (time, priority and insertion order) of
+           an event which is already in this queue, moving it to
+           its new position. The default implementation erases
+           and inserts the event again; the heaps override it to
+           move the event in place.
+        */
+        virtual void update(Event *e, Tick t, int prio, unsigned long order);
+
+        /// Returns the first event, or NULL if the queue is empty
+        virtual Event *front() = 0;
+
+        /// Removes and returns the first event, or NULL if empty
+        virtual Event *pop() = 0;
+
+        /**
+           Removes the first event and all the following ones
+           with the same time and priority, and appends them to v
+           in their order. The default implementation calls pop()
+           for each of them; SetEventQueue removes them with a
+           single operation, and CalendarEventQueue takes them
+           from the head of a single bucket.
+        */
+        virtual void popBatch(std::vector<Event *> &v);
+
+        virtual bool empty() const = 0;
+        virtual size_t size() const = 0;
+
+        /// Appends all the queued events to v, in no particular order
+        virtual void getEvents(std::vector<Event *> &v) const = 0;
+
+        /**
+           The pool of the nodes allocated by the queue for every
+           event, or NULL if the queue does not allocate memory
+           (the links are kept inside the events).
+        */
+        virtual const MemoryPool *getNodePool() const { return NULL; }
+
+    protected:
+        // accessors to the private fields of Event reserved to
+        // the queue implementations
+        static bool less(const Event *e1, const Event *e2);
+        static size_t &pos(Event *e);
+        static Event *&prev(Event *e);
+        static Event *&next(Event *e);
+        static Event *&child(Event *e);
+        static void setKey(Event *e, Tick t, int prio, unsigned long order);
+    };
+
+    /**
+       \ingroup metasim_ee
+
+       Event queue implemented on top of std::set. Every insertion
+       allocates a tree node (from a MemoryPool, so that the nodes
+       are recycled), and erasing requires a search.
+    */
+    class SetEventQueue : public EventQueue {
+        struct Cmp {
+            bool operator()(const Event *e1, const Event *e2) const
+                { return less(e1, e2); }
+        };
+        typedef std::set<Event *, Cmp, PoolAllocator<Event *> > Set;
+        MemoryPool _nodes;
+        Set _set;
+    public:
+        SetEventQueue() : _nodes(), _set(Cmp(), PoolAllocator<Event *>(&_nodes)) {}
+        virtual void insert(Event *e);
+        virtual void erase(Event *e);
+        virtual Event *front();
+        virtual Event *pop();
+        virtual void popBatch(std::vector<Event *> &v);
+        virtual bool empty() const { return _set.empty(); }
+        virtual size_t size() const { return _set.size(); }
+        virtual void getEvents(std::vector<Event *> &v) const;
+        virtual const MemoryPool *getNodePool() const { return &_nodes; }
+    };
+
+    /**
+       \ingroup metasim_ee
+
+       Implicit D-ary heap stored in a vector. Every event keeps its
+       index in the vector, so erase() and update() are O(log n)
+       without searching. D = 2 is the classical binary heap; D = 4 is
+       usually faster, because the tree is shallower and the
+       children of a node share the same cache lines.
+    */
+    template<int D>
+    class HeapEventQueue : public EventQueue {
+        std::vector<Event *> _heap;
+
+        void place(Event *e, size_t i) { _heap[i] = e; pos(e) = i; }
+        void siftUp(size_t i);
+        void siftDown(size_t i);
+        void restore(size_t i);
+    public:
+        virtual void insert(Event *e);
+        virtual void erase(Event *e);
+        virtual void update(Event *e, Tick t, int prio, unsigned long order);
+        virtual Event *front() { return _heap.empty() ? NULL : _heap[0]; }
+        virtual Event *pop();
+        virtual bool empty() const { return _heap.empty(); }
+        virtual size_t size() const { return _heap.size(); }
+        virtual void getEvents(std::vector<Event *> &v) const;
+    };
+
+    typedef HeapEventQueue<2> BinaryHeapEventQueue;
+    typedef HeapEventQueue<4> QuadHeapEventQueue;
+
+    /**
+       \ingroup metasim_ee
+
+       Pairing heap: insertion is O(1), extraction of the minimum
+       is O(log n) amortized, and moving an event to an earlier
+       time (decrease-key) is O(1). The links are stored inside the
+       events, so no memory is allocated by the queue.
+    */
+    class PairingHeapEventQueue : public EventQueue {
+        Event *_root;
+        size_t _size;
+
+        Event *meld(Event *a, Event *b);
+        Event *mergePairs(Event *first);
+        void detach(Event *e);
+    public:
+        PairingHeapEventQueue() : _root(NULL), _size(0) {}
+        virtual void insert(Event *e);
+        virtual void erase(Event *e);
+        virtual void update(Event *e, Tick t, int prio, unsigned long order);
+        virtual Event *front() { return _root; }
+        virtual Event *pop();
+        virtual bool empty() const { return _root == NULL; }
+        virtual size_t size() const { return _size; }
+        virtual void getEvents(std::vector<Event *> &v) const;
+    };
+
+    /**
+       \ingroup metasim_ee
+
+       Calendar queue (R. Brown, "Calendar queues: a fast O(1)
+       priority queue implementation for the simulation event set
+       problem", CACM 1988).
+
+       Time is divided in "days" of fixed width, and a "year" of
+       nb days is mapped on an array of nb buckets, each one being
+       a sorted list of events (linked through the events
+       themselves). When the events are spread over time with a
+       roughly uniform density, as in most network models, insert
+       and extraction take O(1) on average.
+
+       The number of buckets is doubled (halved) when the number
+       of events grows over 2*nb (falls under nb/2), and the
+       width of a day is recomputed, as suggested by Brown, from
+       the separation of the first events in the queue. In
+       addition, the queue keeps track of the separation among
+       the extracted events, and recomputes the width when it
+       drifts too far from the optimal value, even if the number
+       of events does not change.
+
+       Events with the same triggering time always fall in the
+       same bucket, which is ordered by Event::Cmp; hence ties are
+       resolved exactly as in the other implementations.
+    */
+    class CalendarEventQueue : public EventQueue {
+        typedef long int key_t;
+
+        static const size_t MIN_BUCKETS = 16;
+        static const size_t SAMPLE_SIZE = 25;
+
+        std::vector<Event *> _head;
+        std::vector<Event *> _tail;
+        size_t _mask;
+        key_t _width;
+        size_t _size;
+
+        // current day: bucket index and end of the day
+        size_t _cur;
+        key_t _top;
+
+        // separation among the extracted events
+        key_t _lastKey;
+        key_t _gapSum;
+        size_t _gapCount;
+
+        static key_t key(const Event *e);
+
+        size_t bucket(key_t k) const { return (k / _width) & _mask; }
+        void setCursor(key_t k);
+        Event *locate();
+        void link(Event *e);
+        void unlink(Event *e);
+        void resize(size_t nb);
+        void rebuild(size_t nb, key_t width);
+        // updates the separation among the extracted events with
+        // n events at key k; returns true if the queue is rebuilt
+        bool checkWidth(key_t k, size_t n);
+    public:
+        CalendarEventQueue();
+        virtual void insert(Event *e);
+        virtual void erase(Event *e);
+        virtual Event *front() { return locate(); }
+        virtual Event *pop();
+        virtual void popBatch(std::vector<Event *> &v);
+        virtual bool empty() const { return _size == 0; }
+        virtual size_t size() const { return _size; }
+        virtual void getEvents(std::vector<Event *> &v) const;
+
+        /// The current width of a bucket (for debugging)
+        key_t getWidth() const { return _width; }
+
+        /// The current number of buckets (for debugging)
+        size_t getBuckets() const { return _head.size(); }
+    };
+
+    /**
+       \ingroup metasim_ee
+
+       Ladder queue (W. T. Tang, R. S. M. Goh and I. L.-J. Thng,
+       "Ladder queue: an O(1) priority queue structure for
+       large-scale discrete event simulation", ACM TOMACS 2005).
+
+       The events are kept in three tiers:
+       - top: an unsorted list of the events far in the future,
+         those with time not less than the end of the ladder;
+       - ladder: a few rungs of buckets, each rung covering one
+         bucket of the rung above with narrower buckets; the
+         buckets are unsorted lists;
+       - bottom: a sorted list of the first events.
+
+       When the bottom is empty, the first non-empty bucket of the
+       last rung is sorted into the bottom if it holds at most
+       THRESHOLD events, otherwise it is spread on a new rung. When
+       the ladder is empty, the whole top becomes the first rung,
+       with a width computed from its minimum and maximum time. 
+       Unlike the calendar queue, the ladder adapts to skewed
+       distributions of the times without resizing the whole
+       structure, and every event is sorted only once, in a small
+       bucket.
+
+       The events of the bottom are ordered by Event::Cmp; the
+       events with the same time always go in the same bucket, so
+       ties are resolved exactly as in the other implementations.
+    */
+    class LadderEventQueue : public EventQueue {
+        typedef long int key_t;
+
+        static const size_t THRESHOLD = 50;
+        static const size_t MAX_RUNGS = 8;
+
+        // where an event is: pos() is TOP, BOTTOM, or the rung in
+        // the high bits and the bucket in the low ones
+        static const size_t TOP = ~size_t(0);
+        static const size_t BOTTOM = ~size_t(0) - 1;
+        static const int RUNG_SHIFT = 8 * sizeof(size_t) - 8;
+
+        struct Rung {
+            key_t start;
+            key_t width;
+            size_t cur;
+            std::vector<Event *> head;
+            std::vector<size_t> count;
+            size_t size;
+
+            // the beginning of the current bucket (the largest key
+            // when the rung has been consumed)
+            key_t curStart() const
+                {
+                    if (cur >= head.size()) return std::numeric_limits<key_t>::max();
+                    return start + key_t(cur) * width;
+                }
+        };
+
+        Event *_top;
+        key_t _topStart;
+        key_t _topMin, _topMax;
+        size_t _topSize;
+
+        std::vector<Rung> _rungs;
+
+        Event *_bottom;
+        Event *_bottomTail;
+        size_t _bottomSize;
+
+        size_t _size;
+
+        static key_t key(const Event *e);
+
+        void push(Event *&head, Event *e);
+        void remove(Event *&head, Event *e);
+        void insertBottom(Event *e);
+        void addToRung(size_t r, Event *e);
+        void spawn(Event *list, size_t nb, key_t start, key_t width);
+        bool refill();
+    public:
+        LadderEventQueue();
+        virtual void insert(Event *e);
+        virtual void erase(Event *e);
+        virtual Event *front();
+        virtual Event *pop();
+        virtual bool empty() const { return _size == 0; }
+        virtual size_t size() const { return _size; }
+        virtual void getEvents(std::vector<Event *> &v) const;
+
+        /// The current number of rungs (for debugging)
+        size_t getRungs() const { return _rungs.size(); }
+    };
+
+} // namespace MetaSim
+
+#endif // __EVENTQUEUE_HPP__
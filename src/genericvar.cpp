@@ -29,6 +29,7 @@
  * *** empty log message ***
  * 
  */
+#include <algorithm>
 #include <cmath>
 
 #include <genericvar.hpp>
@@ -80,8 +81,58 @@ namespace MetaSim {
     }    
 
 
+    void GenericVar::build()
+    {
+        if (_pdf.empty()) {
+            string errMsg = Exc::_WRONGPDF + string("\n");
+            throw Exc(errMsg, "GenericVar");
+        }
+
+        size_t n = _pdf.size();
+        double CDF = 0;
+        _values.clear();
+        _cdf.clear();
+        for (map<int, double>::iterator i = _pdf.begin(); i != _pdf.end(); ++i) {
+            CDF = CDF + i->second;
+            _values.push_back(i->first);
+            _cdf.push_back(CDF);
+        }
+
+        // Vose: every entry of the table has probability 1/n; a
+        // value with less than 1/n fills its entry with a value
+        // that has more
+        vector<double> q(n);
+        vector<size_t> small, large;
+        size_t k = 0;
+        for (map<int, double>::iterator i = _pdf.begin(); i != _pdf.end(); ++i, ++k) {
+            q[k] = i->second * n / CDF;
+            if (q[k] < 1) small.push_back(k);
+            else large.push_back(k);
+        }
+        _prob.assign(n, 1);
+        _alias.resize(n);
+        for (k = 0; k < n; ++k) _alias[k] = k;
+        while (!small.empty() && !large.empty()) {
+            size_t s = small.back();
+            size_t l = large.back();
+            small.pop_back();
+            _prob[s] = q[s];
+            _alias[s] = l;
+            q[l] = (q[l] + q[s]) - 1;
+            if (q[l] < 1) {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+        // what remains has probability 1 but for the rounding
+
+        // the fraction of u * n must still have 20 bits at least:
+        // up to 2048 values with the 2^31 - 1 of Park-Miller
+        _useAlias = double(n) * (1 << 20) <= double(_gen->getModule()) + 1;
+    }
+
     GenericVar::GenericVar(const std::string &fileName) : 
-        UniformVar(0, 1, NULL)
+        UniformVar(0, 1, NULL), _useAlias(false), _method(_defMethod)
     {
         ifstream inFile(fileName.c_str());
 
@@ -91,26 +142,37 @@ namespace MetaSim {
         }
 
         readPDF(inFile);
+        build();
+    }
+
+    GenericVar::GenericVar(const map<int, double> &pdf, RandomGen *g) :
+        UniformVar(0, 1, g), _pdf(pdf), _useAlias(false), _method(_defMethod)
+    {
+        build();
     }
 
     double GenericVar::get()
     {
-        double v, CDF;
-        map<int, double>::iterator i;
+        double v = UniformVar::get();
 
-        v = UniformVar::get();
-        CDF = 0;
+        if (_useAlias && _method != LEGACY) {
+            double u = v * _values.size();
+            size_t i = size_t(u);
+            return (u - i) < _prob[i] ? _values[i] : _values[_alias[i]];
+        }
 
-        for(i = _pdf.begin(); i != _pdf.end(); i++) {
-            CDF = CDF + i->second;
-            if (CDF > v) {
-                return i->first;
-            }
+        // the first value at which the CDF exceeds v
+        vector<double>::iterator i = upper_bound(_cdf.begin(), _cdf.end(), v);
+        if (i == _cdf.end()) {
+            /* It means that v > 1 or that lim_{i -> \infty} CDF < 1... */
+            throw Exc("Panic", "GenericVar");
         }
+        return _values[i - _cdf.begin()];
+    }
 
-        /* We cannot arrive here... */
-        /* It means that v > 1 or that lim_{i -> \infty} CDF < 1... */
-        throw Exc("Panic", "GenericVar");
+    void GenericVar::fill(double *out, size_t n)
+    {
+        for (size_t i = 0; i < n; ++i) out[i] = GenericVar::get();
     }
     
     RandomVar *GenericVar::createInstance(vector<string> &par)
@@ -121,5 +183,79 @@ namespace MetaSim {
         return new GenericVar(par[0]);
     }
 
+    /*-----------------------------------------------------*/
+
+    void EmpiricalVar::build()
+    {
+        bool ok = !_x.empty() && _x.size() == _f.size() && _f[0] >= 0 &&
+            fabs(_f.back() - 1) < PDF_ERR;
+        for (size_t k = 1; ok && k < _x.size(); ++k)
+            ok = _x[k] >= _x[k - 1] && _f[k] >= _f[k - 1];
+        if (!ok) {
+            string errMsg = Exc::_WRONGPDF + string("\n");
+            throw Exc(errMsg, "EmpiricalVar");
+        }
+        _f.back() = 1;
+
+        size_t m = _f.size();
+        _guide.resize(m);
+        size_t k = 0;
+        for (size_t j = 0; j < m; ++j) {
+            while (k + 2 < m && _f[k + 1] <= double(j) / m) ++k;
+            _guide[j] = k;
+        }
+    }
+
+    EmpiricalVar::EmpiricalVar(const std::string &fileName) :
+        UniformVar(0, 1, NULL), _x(), _f(), _guide()
+    {
+        ifstream inFile(fileName.c_str());
+
+        if (!inFile.is_open()) {
+            string errMsg = Exc::_FILEOPEN  + string(fileName) + "\n";
+            throw Exc(errMsg, "EmpiricalVar");
+        }
+
+        double x, f;
+        while (inFile >> x >> f) {
+            _x.push_back(x);
+            _f.push_back(f);
+        }
+        build();
+    }
+
+    EmpiricalVar::EmpiricalVar(const vector<double> &x, const vector<double> &f,
+                               RandomGen *g) :
+        UniformVar(0, 1, g), _x(x), _f(f), _guide()
+    {
+        build();
+    }
+
+    double EmpiricalVar::get()
+    {
+        double u = UniformVar::get();
+        size_t last = _x.size() - 1;
+
+        if (u < _f[0] || last == 0) return _x[0];
+
+        size_t k = _guide[size_t(u * _guide.size())];
+        while (k + 1 < last && _f[k + 1] <= u) ++k;
+        // here _f[k] <= u < _f[k + 1]
+        return _x[k] + (u - _f[k]) / (_f[k + 1] - _f[k]) * (_x[k + 1] - _x[k]);
+    }
+
+    void EmpiricalVar::fill(double *out, size_t n)
+    {
+        for (size_t i = 0; i < n; ++i) out[i] = EmpiricalVar::get();
+    }
+
+    RandomVar *EmpiricalVar::createInstance(vector<string> &par)
+    {
+        if (par.size() != 1) 
+            throw ParseExc("Wrong number of parameters", "EmpiricalVar");
+        
+        return new EmpiricalVar(par[0]);
+    }
+
 
 } // namespace MetaSim
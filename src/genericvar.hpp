@@ -51,6 +51,7 @@
 
 #include <iostream>
 #include <map>
+#include <vector>
 
 #include <randomvar.hpp>
 
@@ -58,19 +59,95 @@ namespace MetaSim {
 
     /**
        This random variable is used to model a generic distribution.
+
+       The PDF is read from a file of pairs (value, probability),
+       with integer values. It is sampled with the alias method of
+       Walker (in the version of Vose), that takes one number from
+       the generator and a constant time whatever the number of
+       values. When the table is so large that the precision of the
+       generator would not be enough to choose both the entry and
+       the alias with one number (more than 2048 values with the
+       Park-Miller generator), and with the LEGACY method (see
+       RandomVar::Method), the variable inverts the CDF instead,
+       with a binary search in a flat array; LEGACY gives the same
+       values as the previous versions of the library.
     */
     class GenericVar: public UniformVar {
         std::map<int, double> _pdf;
+
+        // the values, and for the alias method the probability of
+        // taking each entry instead of its alias
+        std::vector<double> _values;
+        std::vector<double> _prob;
+        std::vector<size_t> _alias;
+        // the CDF at every value, for the inversion
+        std::vector<double> _cdf;
+        bool _useAlias;
+        Method _method;
+
         void readPDF(std::ifstream &f, int mode = 0);// throw(Exc);
+
+        /// Builds the tables from _pdf
+        void build();
     public:
         GenericVar(const std::string &filename);
 
+        /// A variable with the given PDF, that must sum to 1
+        GenericVar(const std::map<int, double> &pdf, RandomGen *g = NULL);
+
         virtual ~GenericVar() {}
   
         virtual double get(void);
+        virtual void fill(double *out, size_t n);
+
+        void setMethod(Method k) { _method = k; }
+        Method getMethod() const { return _method; }
+
+        static RandomVar *createInstance(vector<string> &par);
+        virtual double getMaximum() throw(MaxException)
+            { return _values.back(); }
+        virtual double getMinimum() throw(MaxException)
+            { return _values.front(); }
+    };
+
+    /**
+       A continuous random variable with a piecewise linear CDF,
+       for example an empirical distribution of measured times.
+       
+       The CDF is given by points (x, F(x)), with x increasing and
+       F(x) non decreasing up to 1, and it is linear between two
+       points. If the first F(x) is not 0, the variable takes the
+       first x with that probability. The variable is sampled by
+       inversion: a guide table, with an entry for every point,
+       gives the segment that contains F(x) = u, or one close to
+       it, so the time of a sample does not depend on the number
+       of points.
+
+       The file contains a point per line, x and F(x) separated by
+       blanks.
+    */
+    class EmpiricalVar: public UniformVar {
+        std::vector<double> _x;
+        std::vector<double> _f;
+        // the first segment that ends after i / (size - 1)
+        std::vector<size_t> _guide;
+
+        void build();
+    public:
+        EmpiricalVar(const std::string &filename);
+
+        EmpiricalVar(const std::vector<double> &x, const std::vector<double> &f,
+                     RandomGen *g = NULL);
+
+        virtual ~EmpiricalVar() {}
+
+        virtual double get();
+        virtual void fill(double *out, size_t n);
 
         static RandomVar *createInstance(vector<string> &par);
-  };
+        virtual double getMaximum() throw(MaxException) { return _x.back(); }
+        virtual double getMinimum() throw(MaxException) { return _x.front(); }
+    };
 
 } // namespace metasim
 
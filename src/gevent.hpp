@@ -23,6 +23,11 @@
 #ifndef __GEVENT_HPP__
 #define __GEVENT_HPP__
 
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
 #include <event.hpp>
 
 namespace MetaSim {
@@ -116,6 +121,152 @@ namespace MetaSim {
   { 
     evt._obj = obj; evt._fun = fun; 
   }
+
+  /**
+     \ingroup metasim_ee
+
+     Like GEvent, but the handler is a template argument, so it is
+     known at compile time: the doit() method calls it directly (and
+     the compiler can inline it), without the indirect call through
+     a pointer to member and the checks of GEvent::doit(). The
+     object is given to the constructor, or later with setObject(),
+     and must be set before the event is triggered.
+
+     \code
+     class Node : public Entity {
+       StaticEvent<Node, &Node::onRecv> _recv_evt;
+     public:
+       Node() : Entity("node"), _recv_evt(this) {}
+       void onRecv(Event *e);
+     };
+     \endcode
+  */
+  template<class X, void (X::* F)(Event *)>
+  class StaticEvent : public Event {
+    X *_obj;
+
+    StaticEvent(const StaticEvent &);
+    StaticEvent &operator=(const StaticEvent &);
+
+  public:
+    /**
+       @param obj the object whose handler is called
+       @param p   priority of this event
+    */
+    StaticEvent(X *obj = NULL, int p = Event::_DEFAULT_PRIORITY) :
+      Event(p), _obj(obj)
+    {}
+
+    void setObject(X *obj) { _obj = obj; }
+    X *getObject() const { return _obj; }
+
+    /// Calls the handler on the object
+    virtual void doit() { (_obj->*F)(this); }
+  };
+
+  /**
+     \ingroup metasim_ee
+
+     An event that calls a callable object (a lambda, a function
+     object or a function pointer) with signature void(Event *).
+     Callables of up to BUFFER_SIZE bytes (for example, a lambda
+     capturing a few pointers) are stored inside the event; larger
+     ones are allocated on the heap. Together with
+     Event::create(), it allows to post an action without defining
+     a new class:
+
+     \code
+     Event::create<FunctionEvent>([this] (Event *) { serve(); })
+       ->post(SIMUL.getTime() + 10, true);
+     \endcode
+  */
+  class FunctionEvent : public Event {
+  public:
+    static const size_t BUFFER_SIZE = 4 * sizeof(void *);
+
+  private:
+    typedef void (*Invoker)(void *, Event *);
+    typedef void (*Destroyer)(void *);
+
+    template<class Fn>
+    struct Handler {
+      static void invoke(void *f, Event *e) { (*static_cast<Fn *>(f))(e); }
+      static void destroyLocal(void *f) { static_cast<Fn *>(f)->~Fn(); }
+      static void destroyHeap(void *f) { delete static_cast<Fn *>(f); }
+    };
+
+    static void invokeNothing(void *, Event *) {}
+
+    typename std::aligned_storage<BUFFER_SIZE>::type _buf;
+    void *_fn;
+    Invoker _invoke;
+    Destroyer _destroy;
+
+    FunctionEvent(const FunctionEvent &);
+    FunctionEvent &operator=(const FunctionEvent &);
+
+    void clear()
+    {
+      if (_destroy != NULL) _destroy(_fn);
+      _fn = NULL;
+      _invoke = &invokeNothing;
+      _destroy = NULL;
+    }
+
+    // stores f inside the event or on the heap: the choice is
+    // made at compile time, so that the placement new is not
+    // compiled for the callables that do not fit
+    template<class Fn>
+    void store(Fn &f, std::true_type)
+    {
+      _fn = new (&_buf) Fn(std::move(f));
+      _destroy = &Handler<Fn>::destroyLocal;
+    }
+
+    template<class Fn>
+    void store(Fn &f, std::false_type)
+    {
+      _fn = new Fn(std::move(f));
+      _destroy = &Handler<Fn>::destroyHeap;
+    }
+
+  public:
+    /// An event without handler: doit() does nothing
+    FunctionEvent(int p = Event::_DEFAULT_PRIORITY) :
+      Event(p), _fn(NULL), _invoke(&invokeNothing), _destroy(NULL)
+    {}
+
+    /**
+       @param f the callable invoked by doit()
+       @param p priority of this event
+    */
+    template<class Fn>
+    FunctionEvent(Fn f, int p = Event::_DEFAULT_PRIORITY) :
+      Event(p), _fn(NULL), _invoke(&invokeNothing), _destroy(NULL)
+    {
+      setHandler(std::move(f));
+    }
+
+    ~FunctionEvent() { clear(); }
+
+    /// Replaces the callable invoked by doit()
+    template<class Fn>
+    void setHandler(Fn f)
+    {
+      clear();
+      store(f, std::integral_constant<bool,
+            sizeof(Fn) <= BUFFER_SIZE &&
+            std::alignment_of<Fn>::value <= 
+            std::alignment_of<decltype(_buf)>::value>());
+      _invoke = &Handler<Fn>::invoke;
+    }
+
+    /// True if the callable is stored inside the event
+    bool isLocal() const { return _fn == &_buf; }
+
+    /// Calls the callable
+    virtual void doit() { _invoke(_fn, this); }
+  };
 }  
 
 #endif
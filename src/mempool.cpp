@@ -0,0 +1,78 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <new>
+
+#include <mempool.hpp>
+
+namespace MetaSim {
+
+    MemoryPool::MemoryPool() :
+        _free(MAX_SIZE / GRANULE + 1, (Block *) NULL),
+        _slabs(),
+        _allocations(0),
+        _reuses(0),
+        _inUse(0)
+    {
+    }
+
+    MemoryPool::~MemoryPool()
+    {
+        for (size_t i = 0; i < _slabs.size(); ++i)
+            ::operator delete(_slabs[i]);
+    }
+
+    void *MemoryPool::allocate(size_t sz)
+    {
+        _allocations++;
+        _inUse++;
+        if (sz > MAX_SIZE) return ::operator new(sz);
+
+        size_t c = (sz + GRANULE - 1) / GRANULE;
+        if (c == 0) c = 1;
+        Block *b = _free[c];
+        if (b != NULL) {
+            _free[c] = b->next;
+            _reuses++;
+            return b;
+        }
+
+        // a new slab, divided in blocks of this class
+        size_t bsz = c * GRANULE;
+        char *slab = static_cast<char *>(::operator new(SLAB_SIZE));
+        _slabs.push_back(slab);
+        for (size_t off = bsz; off + bsz <= SLAB_SIZE; off += bsz) {
+            Block *f = reinterpret_cast<Block *>(slab + off);
+            f->next = _free[c];
+            _free[c] = f;
+        }
+        return slab;
+    }
+
+    void MemoryPool::deallocate(void *p, size_t sz)
+    {
+        if (p == NULL) return;
+        _inUse--;
+        if (sz > MAX_SIZE) {
+            ::operator delete(p);
+            return;
+        }
+
+        size_t c = (sz + GRANULE - 1) / GRANULE;
+        if (c == 0) c = 1;
+        Block *b = static_cast<Block *>(p);
+        b->next = _free[c];
+        _free[c] = b;
+    }
+
+} // namespace MetaSim
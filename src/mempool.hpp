@@ -0,0 +1,114 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __MEMPOOL_HPP__
+#define __MEMPOOL_HPP__
+
+#include <cstddef>
+#include <vector>
+
+namespace MetaSim {
+
+    /**
+       \ingroup metasim_ee
+
+       A memory pool for small objects of many sizes, used for the
+       disposable events (see Event::create()) and for the nodes of
+       the event queues.
+
+       Sizes are rounded up to a multiple of GRANULE bytes, and every
+       size class has its free list. When a free list is empty, a new
+       slab of SLAB_SIZE bytes is allocated and divided into blocks of
+       that class. Memory is given back to the system only when the
+       pool is destroyed. Blocks larger than MAX_SIZE are allocated
+       directly with operator new.
+
+       A pool is not thread safe: every simulation has its own.
+
+       The counters can be used to check that a model does not
+       allocate memory from the system in the steady state.
+    */
+    class MemoryPool {
+        static const size_t GRANULE = 16;
+        static const size_t MAX_SIZE = 512;
+        static const size_t SLAB_SIZE = 16384;
+
+        struct Block { Block *next; };
+
+        std::vector<Block *> _free;
+        std::vector<void *> _slabs;
+
+        unsigned long _allocations;
+        unsigned long _reuses;
+        unsigned long _inUse;
+
+        MemoryPool(const MemoryPool &);
+        MemoryPool &operator=(const MemoryPool &);
+
+    public:
+        MemoryPool();
+        ~MemoryPool();
+
+        /// Returns a block of at least sz bytes
+        void *allocate(size_t sz);
+
+        /// Gives back block p, of sz bytes
+        void deallocate(void *p, size_t sz);
+
+        /// Number of calls to allocate()
+        unsigned long getAllocations() const { return _allocations; }
+
+        /// Number of allocations served by a free list
+        unsigned long getReuses() const { return _reuses; }
+
+        /// Number of slabs allocated from the system
+        unsigned long getSlabs() const { return _slabs.size(); }
+
+        /// Number of blocks currently allocated
+        unsigned long getInUse() const { return _inUse; }
+    };
+
+    /**
+       \ingroup metasim_ee
+
+       Standard allocator that takes the memory from a MemoryPool,
+       for the node based containers.
+    */
+    template<class T>
+    class PoolAllocator {
+    public:
+        typedef T value_type;
+
+        MemoryPool *_pool;
+
+        PoolAllocator(MemoryPool *p) : _pool(p) {}
+
+        template<class U>
+        PoolAllocator(const PoolAllocator<U> &a) : _pool(a._pool) {}
+
+        T *allocate(size_t n)
+            { return static_cast<T *>(_pool->allocate(n * sizeof(T))); }
+        void deallocate(T *p, size_t n)
+            { _pool->deallocate(p, n * sizeof(T)); }
+
+        template<class U>
+        bool operator==(const PoolAllocator<U> &a) const
+            { return _pool == a._pool; }
+        template<class U>
+        bool operator!=(const PoolAllocator<U> &a) const
+            { return _pool != a._pool; }
+    };
+
+} // namespace MetaSim
+
+#endif // __MEMPOOL_HPP__
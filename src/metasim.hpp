@@ -19,22 +19,36 @@
 #ifndef __METASIM_HPP__
 #define __METASIM_HPP__
 
+#include <asynctrace.hpp>
 #include <baseexc.hpp>
 #include <basestat.hpp>
 #include <basetype.hpp>
+#include <batchmeans.hpp>
+#include <bintrace.hpp>
 #include <debugstream.hpp>
 #include <entity.hpp>
 #include <event.hpp>
+#include <eventqueue.hpp>
 #include <factory.hpp>
 #include <genericvar.hpp>
 #include <gevent.hpp>
 #include <history.hpp>
+#include <mempool.hpp>
+#include <observers.hpp>
+#include <parallel.hpp>
 #include <plist.hpp>
+#include <quantile.hpp>
+#include <randomgen.hpp>
 #include <randomvar.hpp>
 #include <regvar.hpp>
+#include <rollback.hpp>
+#include <simcontext.hpp>
 #include <simul.hpp>
+#include <spscring.hpp>
+#include <statetrace.hpp>
 #include <strtoken.hpp>
 #include <tick.hpp>
+#include <timewarp.hpp>
 #include <trace.hpp>
 
 #endif
@@ -0,0 +1,47 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <observers.hpp>
+
+namespace MetaSim {
+
+    void ObserverList::add(void *obj, Kind k)
+    {
+        if (_size == _capacity) {
+            Entry *d = new Entry[2 * _capacity];
+            for (unsigned i = 0; i < _size; ++i) d[i] = _data[i];
+            if (_data != _local) delete[] _data;
+            _data = d;
+            _capacity *= 2;
+        }
+
+        // after the last entry of the same (or a previous) kind
+        unsigned pos = _size;
+        while (pos > 0 && _data[pos - 1].kind > k) {
+            _data[pos] = _data[pos - 1];
+            pos--;
+        }
+        _data[pos].obj = obj;
+        _data[pos].kind = k;
+        _size++;
+    }
+
+    size_t ObserverList::count(Kind k) const
+    {
+        size_t n = 0;
+        for (unsigned i = 0; i < _size; ++i)
+            if (_data[i].kind == k) n++;
+        return n;
+    }
+
+} // namespace MetaSim
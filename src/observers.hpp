@@ -0,0 +1,76 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __OBSERVERS_HPP__
+#define __OBSERVERS_HPP__
+
+#include <cstddef>
+
+namespace MetaSim {
+
+    /**
+       \ingroup metasim_ee
+
+       The list of the objects invoked after an event has been
+       processed: statistics, particles and traces (see
+       Event::addStat(), Event::addParticle() and
+       Event::addTrace()).
+
+       Most events have no observer, or only one, so the list is
+       a small vector of tagged pointers with room for one entry
+       inside the object; the entries are moved to the heap only
+       when a second one is added. The entries are kept grouped by
+       kind (first the statistics, then the particles, then the
+       traces), and in order of insertion within each kind, so
+       that a single loop on the list invokes them in the same
+       order as three separate lists.
+
+       The list does not own the observers.
+    */
+    class ObserverList {
+    public:
+        enum Kind { STAT = 0, PARTICLE = 1, TRACE = 2 };
+
+        struct Entry {
+            void *obj;
+            Kind kind;
+        };
+
+    private:
+        Entry *_data;
+        unsigned _size;
+        unsigned _capacity;
+        Entry _local[1];
+
+        ObserverList(const ObserverList &);
+        ObserverList &operator=(const ObserverList &);
+
+    public:
+        ObserverList() : _data(_local), _size(0), _capacity(1) {}
+        ~ObserverList() { if (_data != _local) delete[] _data; }
+
+        /// Adds obj after the other observers of the same kind
+        void add(void *obj, Kind k);
+
+        bool empty() const { return _size == 0; }
+        size_t size() const { return _size; }
+
+        /// Number of observers of kind k
+        size_t count(Kind k) const;
+
+        const Entry &operator[](size_t i) const { return _data[i]; }
+    };
+
+} // namespace MetaSim
+
+#endif // __OBSERVERS_HPP__
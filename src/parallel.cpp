@@ -0,0 +1,203 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <algorithm>
+#include <exception>
+#include <thread>
+
+#include <barrier.hpp>
+#include <parallel.hpp>
+
+namespace MetaSim {
+
+    using namespace std;
+
+    LogicalProcess::LogicalProcess(ParallelSimulation *p, int id, int n,
+                                   RandomGen *g) :
+        Simulation(), _psim(p), _id(id), _outbox(n), _sent(0),
+        _horizon(0), _gen(g)
+    {
+        _randomGen = g;
+    }
+
+    LogicalProcess *LogicalProcess::current()
+    {
+        return dynamic_cast<LogicalProcess *>(&SimulationContext::current());
+    }
+
+    Tick LogicalProcess::nextTime()
+    {
+        Scope scope(*this);
+        Event *e = Event::getFirst();
+        if (e == NULL) return MAXTICK;
+        return e->getTime();
+    }
+
+    void LogicalProcess::window()
+    {
+        Scope scope(*this);
+        Event *e;
+        while ((e = Event::getFirst()) != NULL && e->getTime() < _horizon)
+            if (getBatchDispatch()) sim_batch();
+            else sim_step();
+    }
+
+    void LogicalProcess::send(int dst, Event *e, Tick t, bool disp)
+    {
+        // the destination would give the memory back to the pool
+        // of this LP from its own thread
+        if (e->isPooled())
+            throw ParallelSimulation::Exc("A pooled event cannot be sent");
+        if (dst < 0 || dst >= _psim->size())
+            throw ParallelSimulation::Exc("Unknown destination LP");
+        Tick la = _psim->getLookahead(_id, dst);
+        if (la == MAXTICK)
+            throw ParallelSimulation::Exc("The LPs are not connected");
+        if (t < globTime + la)
+            throw ParallelSimulation::Exc("Message violates the lookahead");
+
+        Message m;
+        m.evt = e;
+        m.time = t;
+        m.src = _id;
+        m.seq = _sent++;
+        m.disp = disp;
+        _outbox[dst].push_back(m);
+    }
+
+    ParallelSimulation::ParallelSimulation(int n) :
+        _lp(), _lookahead(n, vector<Tick>(n, MAXTICK))
+    {
+        if (n < 1) throw Exc("At least one LP is needed");
+        if (n > Simulation::MAX_MESSAGE_SOURCES) throw Exc("Too many LPs");
+        for (int i = 0; i < n; ++i)
+            _lp.push_back(new LogicalProcess(this, i, n, 
+                                             RandomVar::getGenerator()->split()));
+    }
+
+    ParallelSimulation::~ParallelSimulation()
+    {
+        for (size_t i = 0; i < _lp.size(); ++i) delete _lp[i];
+    }
+
+    void ParallelSimulation::connect(int src, int dst, Tick lookahead)
+    {
+        if (lookahead <= 0) throw Exc("The lookahead must be positive");
+        _lookahead.at(src).at(dst) = lookahead;
+    }
+
+    void ParallelSimulation::deliver()
+    {
+        // the position of a message in the queue depends only on
+        // its key (see Simulation::postMessage()), not on the
+        // order of delivery
+        for (size_t dst = 0; dst < _lp.size(); ++dst) {
+            SimulationContext::Scope scope(*_lp[dst]);
+            for (size_t src = 0; src < _lp.size(); ++src) {
+                vector<LogicalProcess::Message> &box = _lp[src]->_outbox[dst];
+                for (size_t i = 0; i < box.size(); ++i)
+                    _lp[dst]->postMessage(box[i].evt, box[i].time, box[i].disp,
+                                          LogicalProcess::messageOrder(box[i].src, 
+                                                                       box[i].seq));
+                box.clear();
+            }
+        }
+    }
+
+    bool ParallelSimulation::horizons(Tick stop)
+    {
+        size_t n = _lp.size();
+        vector<Tick> next(n);
+        bool pending = false;
+        for (size_t i = 0; i < n; ++i) {
+            next[i] = _lp[i]->nextTime();
+            if (next[i] <= stop) pending = true;
+        }
+        if (!pending) return false;
+
+        for (size_t i = 0; i < n; ++i) {
+            Tick h = stop + 1;
+            for (size_t j = 0; j < n; ++j) {
+                if (_lookahead[j][i] == MAXTICK || next[j] == MAXTICK)
+                    continue;
+                h = min(h, next[j] + _lookahead[j][i]);
+            }
+            _lp[i]->_horizon = h;
+        }
+        return true;
+    }
+
+    void ParallelSimulation::run_to(Tick stop)
+    {
+        int n = _lp.size();
+        Barrier barrier(n + 1);
+        bool done = false;
+        vector<exception_ptr> errors(n);
+
+        // every worker executes one window of its LP between
+        // two waits on the barrier; the coordinator (this
+        // thread) delivers the messages and computes the
+        // horizons while the workers are waiting
+        vector<thread> workers;
+        for (int i = 0; i < n; ++i) {
+            workers.push_back(thread([&, i] () {
+                while (true) {
+                    barrier.wait();
+                    if (done) break;
+                    try {
+                        _lp[i]->window();
+                    } catch (...) {
+                        errors[i] = current_exception();
+                    }
+                    barrier.wait();
+                }
+            }));
+        }
+
+        exception_ptr error;
+        try {
+            while (!error) {
+                deliver();
+                if (!horizons(stop)) break;
+                barrier.wait();
+                barrier.wait();
+                for (int i = 0; i < n && !error; ++i) error = errors[i];
+            }
+        } catch (...) {
+            error = current_exception();
+        }
+
+        done = true;
+        barrier.wait();
+        for (int i = 0; i < n; ++i) workers[i].join();
+        if (error) rethrow_exception(error);
+
+        for (int i = 0; i < n; ++i)
+            if (_lp[i]->globTime < stop) _lp[i]->globTime = stop;
+    }
+
+    void ParallelSimulation::run(Tick stop)
+    {
+        for (size_t i = 0; i < _lp.size(); ++i) {
+            _lp[i]->initRuns(1);
+            _lp[i]->initSingleRun();
+        }
+        run_to(stop);
+        for (size_t i = 0; i < _lp.size(); ++i) {
+            _lp[i]->endSingleRun();
+            SimulationContext::Scope scope(*_lp[i]);
+            BaseStat::endSim();
+        }
+    }
+
+} // namespace MetaSim
@@ -0,0 +1,239 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __PARALLEL_HPP__
+#define __PARALLEL_HPP__
+
+#include <memory>
+#include <vector>
+
+#include <baseexc.hpp>
+#include <event.hpp>
+#include <randomvar.hpp>
+#include <simul.hpp>
+#include <tick.hpp>
+
+namespace MetaSim {
+
+    class ParallelSimulation;
+
+    /**
+       \ingroup metasim_ee
+
+       A logical process (LP) of a ParallelSimulation: a partition
+       of the model, with its own entities, event queue and clock,
+       executed by its own thread. Being a Simulation, an LP is
+       populated by making it current (with a
+       SimulationContext::Scope) while the entities of the
+       partition are created.
+
+       An entity of an LP must never touch directly the objects of
+       another LP. To trigger an event of another LP, it calls
+       send(), which delivers the event to the destination at the
+       given time, that must respect the lookahead of the link.
+
+       Every LP has its own random generator (see getGenerator()),
+       split from the default generator of the thread that creates
+       the ParallelSimulation. While the LP is current it is the
+       default generator of the RandomVar objects, so that the
+       variables created without a generator while the partition
+       is populated draw from it, and not from a generator shared
+       by all the threads.
+    */
+    class LogicalProcess : public Simulation {
+        friend class ParallelSimulation;
+
+        // a message: an event of the destination LP, to be
+        // posted at the given time
+        struct Message {
+            Event *evt;
+            Tick time;
+            int src;
+            unsigned long seq;
+            bool disp;
+        };
+
+        ParallelSimulation *_psim;
+        int _id;
+
+        // messages sent by this LP during the current window,
+        // one outbox per destination. Every outbox is written
+        // only by the thread of this LP, and read by the
+        // coordinator after the end of the window.
+        std::vector< std::vector<Message> > _outbox;
+        unsigned long _sent;
+
+        // events of this LP must be executed before this time
+        Tick _horizon;
+
+        std::unique_ptr<RandomGen> _gen;
+
+        LogicalProcess(ParallelSimulation *p, int id, int n, RandomGen *g);
+
+        // executes the events before the horizon
+        void window();
+
+        // the time of the next event, or MAXTICK
+        Tick nextTime();
+
+    public:
+        /// The index of this LP in its ParallelSimulation
+        int getID() const { return _id; }
+
+        /// The random generator of this LP
+        RandomGen &getGenerator() { return *_gen; }
+
+        /**
+           Returns the LP which is current in the calling thread,
+           or NULL if the current simulation is not an LP.
+        */
+        static LogicalProcess *current();
+
+        /**
+           Sends event e to LP dst, which will post it at time t.
+           The event must belong to LP dst, and it must not be
+           already posted nor created by Event::create(). There
+           must be a link from this LP to dst, and t must be at
+           least the current time plus the lookahead of the link,
+           otherwise an exception is raised. If disp is true, the event is disposable
+           (see Event::post()).
+        */
+        void send(int dst, Event *e, Tick t, bool disp = false);
+    };
+
+    /**
+       \ingroup metasim_ee
+
+       Conservative parallel simulation engine. The model is
+       partitioned in logical processes (see LogicalProcess), each
+       one executed by its own thread; the LPs communicate only
+       through messages sent on links declared with connect(),
+       each with a lookahead: a message sent on a link at time t
+       is always delivered at time t + lookahead or later.
+
+       The synchronisation follows the YAWNS protocol (Nicol): the
+       simulation proceeds in windows. At the beginning of every
+       window each LP i computes a horizon, the minimum over its
+       incoming links j -> i of the time of the next event of j
+       plus the lookahead of the link; then all the LPs execute in
+       parallel, without any further synchronisation, their events
+       which come before their horizon. No message sent during the
+       window can fall before the horizon of its destination, so
+       the messages are delivered only at the end of the window.
+       Since the phases are separated by a barrier, the outboxes
+       need no lock and no atomic operation.
+
+       Among the events of an LP with the same time and priority,
+       the local ones come first, in the order in which they are
+       posted, then the messages by source LP and sending order
+       (see Simulation::messageOrder()), whatever the order in
+       which they are delivered; TimeWarpSimulation uses the same
+       order. It does not depend on the scheduling of the threads:
+       hence the result of a parallel simulation is always the
+       same. It is also the same as executing the whole
+       model sequentially, as long as the order among events with
+       the same time and priority on the same LP is not relevant to
+       the model, because their relative order is decided by a
+       different rule, and as long as the random variables of each
+       partition draw from a copy of the generator of its LP (see
+       LogicalProcess::getGenerator()).
+
+       @code
+       ParallelSimulation ps(2);
+       {
+           SimulationContext::Scope s(ps.getLP(0));
+           // create the entities of partition 0
+       }
+       {
+           SimulationContext::Scope s(ps.getLP(1));
+           // create the entities of partition 1
+       }
+       ps.connect(0, 1, 10);
+       ps.connect(1, 0, 10);
+       ps.run(100000);
+       @endcode
+    */
+    class ParallelSimulation {
+        std::vector<LogicalProcess *> _lp;
+
+        // _lookahead[src][dst], or MAXTICK if there is no link
+        std::vector< std::vector<Tick> > _lookahead;
+
+        ParallelSimulation(const ParallelSimulation &);
+        ParallelSimulation &operator=(const ParallelSimulation &);
+
+        // posts the messages of all the outboxes
+        void deliver();
+
+        // computes the horizons; returns false if no LP has
+        // an event before stop
+        bool horizons(Tick stop);
+
+    public:
+        /**
+           \ingroup metasim_exc
+
+           Exceptions for the parallel engine.
+        */
+        class Exc : public BaseExc {
+        public:
+            Exc(const std::string message,
+                const std::string cl = "ParallelSimulation",
+                const std::string md = "parallel.cpp")
+                : BaseExc(message,cl,md) {} ;
+        };
+
+        /// Creates a parallel simulation with n logical processes
+        ParallelSimulation(int n);
+        ~ParallelSimulation();
+
+        /// The number of logical processes
+        int size() const { return _lp.size(); }
+
+        /// Returns the i-th logical process
+        LogicalProcess &getLP(int i) { return *_lp.at(i); }
+
+        /**
+           Declares a link from LP src to LP dst. The lookahead
+           must be strictly positive.
+        */
+        void connect(int src, int dst, Tick lookahead);
+
+        /// Returns the lookahead of the link src -> dst, or
+        /// MAXTICK if the LPs are not connected
+        Tick getLookahead(int src, int dst) const
+            { return _lookahead.at(src).at(dst); }
+
+        /**
+           Executes one run: calls Entity::newRun() on all the
+           entities, executes all the events up to time
+           <i>stop</i> (included), then calls Entity::endRun() and
+           closes the statistics of every LP. The LPs are
+           executed in parallel, one thread each.
+        */
+        void run(Tick stop);
+
+        /**
+           Executes in parallel all the events up to time
+           <i>stop</i> (included), without initialising or
+           closing the run: it is the parallel equivalent of
+           Simulation::run_to(). The LPs must have been
+           initialised with Simulation::initRuns() and
+           Simulation::initSingleRun().
+        */
+        void run_to(Tick stop);
+    };
+
+} // namespace MetaSim
+
+#endif // __PARALLEL_HPP__
@@ -0,0 +1,452 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <quantile.hpp>
+
+namespace MetaSim {
+
+    using namespace std;
+
+    namespace {
+        // the scale function of the t-digest (k1), and its inverse
+        inline double kScale(double q, double delta)
+        {
+            return delta / (2 * M_PI) * asin(2 * q - 1);
+        }
+
+        inline double kInverse(double k, double delta)
+        {
+            return (sin(k * 2 * M_PI / delta) + 1) / 2;
+        }
+    }
+
+    TDigest::TDigest(double compression) :
+        _compression(compression > 10 ? compression : 10),
+        _bufSize(size_t(5 * _compression)),
+        _c(), _buf(), _tmp(),
+        _min(numeric_limits<double>::infinity()),
+        _max(-numeric_limits<double>::infinity())
+    {
+        _buf.reserve(_bufSize);
+    }
+
+    void TDigest::compress() const
+    {
+        if (_buf.empty()) return;
+
+        _tmp.clear();
+        _tmp.insert(_tmp.end(), _c.begin(), _c.end());
+        _tmp.insert(_tmp.end(), _buf.begin(), _buf.end());
+        _buf.clear();
+        sort(_tmp.begin(), _tmp.end());
+
+        double total = 0;
+        for (size_t i = 0; i < _tmp.size(); ++i) total += _tmp[i].weight;
+
+        // a centroid grows while its right end stays within one
+        // unit of k from its left end
+        _c.clear();
+        Centroid cur = _tmp[0];
+        double before = 0;
+        double limit = total * kInverse(kScale(0, _compression) + 1, 
+                                        _compression);
+        for (size_t i = 1; i < _tmp.size(); ++i) {
+            const Centroid &n = _tmp[i];
+            if (before + cur.weight + n.weight <= limit) {
+                cur.weight += n.weight;
+                cur.mean += (n.mean - cur.mean) * n.weight / cur.weight;
+            }
+            else {
+                _c.push_back(cur);
+                before += cur.weight;
+                limit = total * kInverse(kScale(before / total, _compression) + 1,
+                                         _compression);
+                cur = n;
+            }
+        }
+        _c.push_back(cur);
+    }
+
+    void TDigest::merge(const TDigest &d)
+    {
+        d.compress();
+        for (size_t i = 0; i < d._c.size(); ++i) {
+            if (_buf.size() >= _bufSize) compress();
+            _buf.push_back(d._c[i]);
+        }
+        if (d._min < _min) _min = d._min;
+        if (d._max > _max) _max = d._max;
+    }
+
+    double TDigest::count() const
+    {
+        compress();
+        double total = 0;
+        for (size_t i = 0; i < _c.size(); ++i) total += _c[i].weight;
+        return total;
+    }
+
+    size_t TDigest::centroids() const
+    {
+        compress();
+        return _c.size();
+    }
+
+    double TDigest::quantile(double p) const
+    {
+        compress();
+        if (_c.empty()) return 0;
+        if (p <= 0) return _min;
+        if (p >= 1) return _max;
+        if (_c.size() == 1) return _c[0].mean;
+
+        double total = 0;
+        for (size_t i = 0; i < _c.size(); ++i) total += _c[i].weight;
+        double index = p * total;
+
+        // between the minimum and the center of the first centroid
+        double half = _c[0].weight / 2;
+        if (index < half) 
+            return _min + (_c[0].mean - _min) * index / half;
+
+        // between the centers of two centroids
+        double before = 0;
+        for (size_t i = 0; i + 1 < _c.size(); ++i) {
+            double left = before + _c[i].weight / 2;
+            double right = before + _c[i].weight + _c[i + 1].weight / 2;
+            if (index <= right) 
+                return _c[i].mean + (_c[i + 1].mean - _c[i].mean) * 
+                    (index - left) / (right - left);
+            before += _c[i].weight;
+        }
+
+        // between the center of the last centroid and the maximum
+        const Centroid &last = _c.back();
+        double left = total - last.weight / 2;
+        return last.mean + (_max - last.mean) * (index - left) / (total - left);
+    }
+
+    void TDigest::clear()
+    {
+        _c.clear();
+        _buf.clear();
+        _min = numeric_limits<double>::infinity();
+        _max = -numeric_limits<double>::infinity();
+    }
+
+    void TDigest::save(vector<double> &s) const
+    {
+        compress();
+        s.push_back(_min);
+        s.push_back(_max);
+        s.push_back(_c.size());
+        for (size_t i = 0; i < _c.size(); ++i) {
+            s.push_back(_c[i].mean);
+            s.push_back(_c[i].weight);
+        }
+    }
+
+    void TDigest::restore(const double *&s)
+    {
+        _buf.clear();
+        _min = *s++;
+        _max = *s++;
+        _c.resize(size_t(*s++));
+        for (size_t i = 0; i < _c.size(); ++i) {
+            _c[i].mean = *s++;
+            _c[i].weight = *s++;
+        }
+    }
+
+    HdrHistogram::HdrHistogram(double highest, int digits, double unit) :
+        _unit(unit), _digits(digits), _highest(0), _halfMag(0),
+        _halfCount(0), _mask(0), _counts(), _total(0),
+        _min(numeric_limits<double>::infinity()),
+        _max(-numeric_limits<double>::infinity())
+    {
+        if (digits < 0 || digits > 5) 
+            throw Exc("The significant digits must be between 0 and 5");
+        if (unit <= 0 || highest < 2 * unit) 
+            throw Exc("Wrong range");
+        _highest = uint64_t(highest / unit);
+
+        // the sub-buckets of every bucket are enough to tell apart
+        // values that differ in the last significant digit
+        uint64_t largest = 2;
+        for (int i = 0; i < digits; ++i) largest *= 10;
+        uint64_t subCount = 1;
+        int subMag = 0;
+        while (subCount < largest) {
+            subCount *= 2;
+            subMag++;
+        }
+        if (subMag < 1) {
+            subCount = 2;
+            subMag = 1;
+        }
+        _halfMag = subMag - 1;
+        _halfCount = subCount / 2;
+        _mask = subCount - 1;
+
+        // every bucket doubles the range
+        int buckets = 1;
+        uint64_t untrackable = subCount;
+        while (untrackable <= _highest) {
+            if (untrackable > numeric_limits<uint64_t>::max() / 2) {
+                buckets++;
+                break;
+            }
+            untrackable <<= 1;
+            buckets++;
+        }
+        _counts.resize(size_t(buckets + 1) * _halfCount);
+    }
+
+    uint64_t HdrHistogram::highestEquivalent(size_t i) const
+    {
+        int bucket = int(i >> _halfMag) - 1;
+        uint64_t sub = (i & (_halfCount - 1)) + _halfCount;
+        if (bucket < 0) {
+            sub -= _halfCount;
+            bucket = 0;
+        }
+        return (sub << bucket) + (uint64_t(1) << bucket) - 1;
+    }
+
+    void HdrHistogram::merge(const HdrHistogram &h)
+    {
+        if (h._unit != _unit || h._digits != _digits || 
+            h._counts.size() != _counts.size())
+            throw Exc("Merging histograms with different parameters");
+        for (size_t i = 0; i < _counts.size(); ++i) _counts[i] += h._counts[i];
+        _total += h._total;
+        if (h._min < _min) _min = h._min;
+        if (h._max > _max) _max = h._max;
+    }
+
+    double HdrHistogram::quantile(double p) const
+    {
+        if (_total == 0) return 0;
+        double target = ceil(p * _total);
+        if (target < 1) target = 1;
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < _counts.size(); ++i) {
+            seen += _counts[i];
+            if (seen >= target) {
+                double v = highestEquivalent(i) * _unit;
+                return std::max(_min, std::min(v, _max));
+            }
+        }
+        return _max;
+    }
+
+    void HdrHistogram::clear()
+    {
+        fill(_counts.begin(), _counts.end(), 0);
+        _total = 0;
+        _min = numeric_limits<double>::infinity();
+        _max = -numeric_limits<double>::infinity();
+    }
+
+    void HdrHistogram::save(vector<double> &s) const
+    {
+        s.push_back(_min);
+        s.push_back(_max);
+        s.push_back(_total);
+        s.insert(s.end(), _counts.begin(), _counts.end());
+    }
+
+    void HdrHistogram::restore(const double *&s)
+    {
+        _min = *s++;
+        _max = *s++;
+        _total = uint64_t(*s++);
+        for (size_t i = 0; i < _counts.size(); ++i) _counts[i] = uint64_t(*s++);
+    }
+
+    StatQuantile::StatQuantile(string name, double p) :
+        BaseStat(name), _p(p), _count(0)
+    {
+        if (p < 0 || p > 1) throw Exc("The probability must be in [0, 1]");
+        _dn[0] = 0;
+        _dn[1] = p / 2;
+        _dn[2] = p;
+        _dn[3] = (1 + p) / 2;
+        _dn[4] = 1;
+        fill(_q, _q + 5, 0.0);
+        fill(_n, _n + 5, 0.0);
+        fill(_np, _np + 5, 0.0);
+    }
+
+    void StatQuantile::initValue()
+    {
+        _val = 0;
+        _count = 0;
+    }
+
+    double StatQuantile::parabolic(int i, double d) const
+    {
+        return _q[i] + d / (_n[i + 1] - _n[i - 1]) * 
+            ((_n[i] - _n[i - 1] + d) * (_q[i + 1] - _q[i]) / (_n[i + 1] - _n[i]) +
+             (_n[i + 1] - _n[i] - d) * (_q[i] - _q[i - 1]) / (_n[i] - _n[i - 1]));
+    }
+
+    double StatQuantile::linear(int i, int d) const
+    {
+        return _q[i] + d * (_q[i + d] - _q[i]) / (_n[i + d] - _n[i]);
+    }
+
+    void StatQuantile::record(double x)
+    {
+        if (chkTransitory()) return;
+
+        // the first five values are the initial markers
+        if (_count < 5) {
+            int c = int(_count);
+            _q[c] = x;
+            _count++;
+            sort(_q, _q + c + 1);
+            int k = int(ceil(_p * (c + 1))) - 1;
+            _val = _q[k < 0 ? 0 : k];
+            if (c == 4) {
+                for (int i = 0; i < 5; ++i) {
+                    _n[i] = i;
+                    _np[i] = 4 * _dn[i];
+                }
+            }
+            return;
+        }
+
+        // the cell of x, stretching the extreme markers if needed
+        int k;
+        if (x < _q[0]) {
+            _q[0] = x;
+            k = 0;
+        }
+        else if (x >= _q[4]) {
+            _q[4] = x;
+            k = 3;
+        }
+        else {
+            k = 0;
+            while (x >= _q[k + 1]) ++k;
+        }
+        for (int i = k + 1; i < 5; ++i) _n[i] += 1;
+        for (int i = 0; i < 5; ++i) _np[i] += _dn[i];
+        _count++;
+
+        // moves the middle markers towards their desired positions
+        for (int i = 1; i < 4; ++i) {
+            double d = _np[i] - _n[i];
+            if ((d >= 1 && _n[i + 1] - _n[i] > 1) || 
+                (d <= -1 && _n[i - 1] - _n[i] < -1)) {
+                int s = d > 0 ? 1 : -1;
+                double q = parabolic(i, s);
+                if (_q[i - 1] < q && q < _q[i + 1]) _q[i] = q;
+                else _q[i] = linear(i, s);
+                _n[i] += s;
+            }
+        }
+        _val = _q[2];
+    }
+
+    void StatQuantile::saveState(vector<double> &s) const
+    {
+        s.push_back(_val);
+        s.push_back(_count);
+        s.insert(s.end(), _q, _q + 5);
+        s.insert(s.end(), _n, _n + 5);
+        s.insert(s.end(), _np, _np + 5);
+    }
+
+    void StatQuantile::restoreState(const double *&s)
+    {
+        _val = *s++;
+        _count = *s++;
+        for (int i = 0; i < 5; ++i) _q[i] = *s++;
+        for (int i = 0; i < 5; ++i) _n[i] = *s++;
+        for (int i = 0; i < 5; ++i) _np[i] = *s++;
+    }
+
+    StatTDigest::StatTDigest(string name, double p, double compression) :
+        BaseStat(name), _p(p), _run(compression), _pooled(compression)
+    {
+        if (p < 0 || p > 1) throw Exc("The probability must be in [0, 1]");
+    }
+
+    void StatTDigest::initValue()
+    {
+        _val = 0;
+        _run.clear();
+    }
+
+    void StatTDigest::collect()
+    {
+        _val = _run.quantile(_p);
+        if (getExpNum() == 0) _pooled.clear();
+        _pooled.merge(_run);
+        BaseStat::collect();
+    }
+
+    void StatTDigest::saveState(vector<double> &s) const
+    {
+        s.push_back(_val);
+        _run.save(s);
+    }
+
+    void StatTDigest::restoreState(const double *&s)
+    {
+        _val = *s++;
+        _run.restore(s);
+    }
+
+    StatHistogram::StatHistogram(string name, double p, double highest, 
+                                 int digits, double unit) :
+        BaseStat(name), _p(p), _run(highest, digits, unit), 
+        _pooled(highest, digits, unit)
+    {
+        if (p < 0 || p > 1) throw Exc("The probability must be in [0, 1]");
+    }
+
+    void StatHistogram::initValue()
+    {
+        _val = 0;
+        _run.clear();
+    }
+
+    void StatHistogram::collect()
+    {
+        _val = _run.quantile(_p);
+        if (getExpNum() == 0) _pooled.clear();
+        _pooled.merge(_run);
+        BaseStat::collect();
+    }
+
+    void StatHistogram::saveState(vector<double> &s) const
+    {
+        s.push_back(_val);
+        _run.save(s);
+    }
+
+    void StatHistogram::restoreState(const double *&s)
+    {
+        _val = *s++;
+        _run.restore(s);
+    }
+
+} // namespace MetaSim
@@ -0,0 +1,326 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __QUANTILE_HPP__
+#define __QUANTILE_HPP__
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include <baseexc.hpp>
+#include <basestat.hpp>
+
+namespace MetaSim {
+
+    /**
+       \ingroup metasim_stat
+
+       A t-digest: a constant-memory summary of a distribution,
+       from which any quantile can be estimated, very accurately
+       near the tails (p = 0.99, 0.999). The samples are clustered
+       in centroids whose size is small near the tails and larger
+       in the middle; their number is bounded by about
+       <i>compression</i>.
+
+       The samples are collected in a buffer, and merged with the
+       centroids when the buffer is full, so adding a sample costs
+       little more than a push_back. Two digests can be merged,
+       for example to pool the samples of several replications.
+    */
+    class TDigest {
+    public:
+        TDigest(double compression = 100);
+
+        /// Adds x, with weight w
+        inline void add(double x, double w = 1)
+            {
+                if (_buf.size() >= _bufSize) compress();
+                Centroid c = { x, w };
+                _buf.push_back(c);
+                if (x < _min) _min = x;
+                if (x > _max) _max = x;
+            }
+
+        /// Adds all the samples of d
+        void merge(const TDigest &d);
+
+        /// The estimate of the p-quantile (0 <= p <= 1), 0 if
+        /// the digest is empty
+        double quantile(double p) const;
+
+        /// The total weight of the samples
+        double count() const;
+
+        double min() const { return _min; }
+        double max() const { return _max; }
+
+        /// The number of centroids, after merging the buffer
+        size_t centroids() const;
+
+        void clear();
+
+        /// Appends the state of the digest to s
+        void save(std::vector<double> &s) const;
+
+        /// Restores the state written by save(), advancing s
+        void restore(const double *&s);
+
+    private:
+        struct Centroid {
+            double mean;
+            double weight;
+            bool operator<(const Centroid &c) const { return mean < c.mean; }
+        };
+
+        double _compression;
+        size_t _bufSize;
+        mutable std::vector<Centroid> _c;
+        mutable std::vector<Centroid> _buf;
+        mutable std::vector<Centroid> _tmp;
+        double _min;
+        double _max;
+
+        // merges the buffer with the centroids
+        void compress() const;
+    };
+
+    /**
+       \ingroup metasim_stat
+
+       A histogram with logarithmic buckets (HDR histogram), that
+       keeps <i>digits</i> significant decimal digits on the whole
+       range from <i>unit</i> to <i>highest</i>. The values are
+       counted in multiples of unit; a value larger than highest
+       is counted as highest, a negative value as 0.
+
+       Recording a value is an index computation and an
+       increment; the memory is fixed by the range and the
+       precision (a few tens of thousands of counters for three
+       digits over a range of 10^9). Histograms with the same
+       parameters can be merged exactly.
+    */
+    class HdrHistogram {
+    public:
+        /**
+           \ingroup metasim_exc
+
+           Exceptions for the histograms.
+        */
+        class Exc : public BaseExc {
+        public:
+            Exc(const std::string message,
+                const std::string cl = "HdrHistogram",
+                const std::string md = "quantile.cpp")
+                : BaseExc(message,cl,md) {} ;
+        };
+
+        /**
+           @param highest the highest value
+           @param digits  the significant digits, between 0 and 5
+           @param unit    the resolution
+        */
+        HdrHistogram(double highest = 1e9, int digits = 3, double unit = 1);
+
+        /// Counts n times the value x
+        inline void add(double x, uint64_t n = 1)
+            {
+                double v = x / _unit;
+                uint64_t u = v <= 0 ? 0 : (v >= _highest ? _highest : 
+                                           uint64_t(v + 0.5));
+                _counts[index(u)] += n;
+                _total += n;
+                if (x < _min) _min = x;
+                if (x > _max) _max = x;
+            }
+
+        /// Adds the counts of h, that must have the same
+        /// parameters
+        void merge(const HdrHistogram &h);
+
+        /**
+           The estimate of the p-quantile (0 <= p <= 1): the
+           highest value equivalent to the bucket where the
+           quantile falls, limited by the minimum and the maximum
+           recorded values. It returns 0 if the histogram is empty.
+        */
+        double quantile(double p) const;
+
+        /// The number of values
+        uint64_t count() const { return _total; }
+
+        double min() const { return _min; }
+        double max() const { return _max; }
+
+        /// The number of buckets
+        size_t buckets() const { return _counts.size(); }
+
+        void clear();
+
+        /// Appends the state of the histogram to s
+        void save(std::vector<double> &s) const;
+
+        /// Restores the state written by save(), advancing s
+        void restore(const double *&s);
+
+    private:
+        double _unit;
+        int _digits;
+        uint64_t _highest;
+        int _halfMag;
+        uint64_t _halfCount;
+        uint64_t _mask;
+        std::vector<uint64_t> _counts;
+        uint64_t _total;
+        double _min;
+        double _max;
+
+        inline size_t index(uint64_t v) const
+            {
+                int bucket = 63 - __builtin_clzll(v | _mask) - _halfMag;
+                uint64_t sub = v >> bucket;
+                return (size_t(bucket + 1) << _halfMag) + (sub - _halfCount);
+            }
+
+        // the highest value counted in bucket i, in units
+        uint64_t highestEquivalent(size_t i) const;
+    };
+
+    /**
+       \ingroup metasim_stat
+
+       Computes the p-quantile of the recorded values with the P²
+       algorithm (Jain and Chlamtac), with five markers, that is
+       constant memory and constant time per value. The value of
+       every run is the estimate at the end of the run.
+
+       The P² estimates of different runs cannot be merged: to
+       pool the samples of all the runs use StatTDigest or
+       StatHistogram.
+    */
+    class StatQuantile : public BaseStat {
+    protected:
+        double _p;
+        double _count;
+        double _q[5];    // marker heights
+        double _n[5];    // marker positions
+        double _np[5];   // desired positions
+        double _dn[5];   // increments of the desired positions
+
+        double parabolic(int i, double d) const;
+        double linear(int i, int d) const;
+
+    public:
+        StatQuantile(std::string name = "", double p = 0.5);
+
+        virtual void record(double x);
+        virtual void initValue();
+        virtual void saveState(std::vector<double> &s) const;
+        virtual void restoreState(const double *&s);
+
+        double getProbability() const { return _p; }
+    };
+
+    /**
+       \ingroup metasim_stat
+
+       Computes the p-quantile of the recorded values with a
+       TDigest. The value of every run is the p-quantile of the
+       run, so getMean() and getConfInterval() work as for the
+       other statistics; moreover, the digests of all the runs
+       are merged in a pooled digest, from which any quantile of
+       all the samples can be computed (see getPooled()).
+
+       The value (getValue()) is computed at the end of the run:
+       during the run, use getRun().quantile().
+    */
+    class StatTDigest : public BaseStat {
+    protected:
+        double _p;
+        TDigest _run;
+        TDigest _pooled;
+
+        virtual void collect();
+
+    public:
+        StatTDigest(std::string name = "", double p = 0.99,
+                    double compression = 100);
+
+        virtual void record(double x)
+            {
+                if (chkTransitory()) return;
+                _run.add(x);
+            }
+        virtual void initValue();
+        virtual void saveState(std::vector<double> &s) const;
+        virtual void restoreState(const double *&s);
+
+        double getProbability() const { return _p; }
+
+        /// The digest of the current run
+        const TDigest &getRun() const { return _run; }
+
+        /**
+           The digest of all the completed runs. It can be merged
+           with the digests of replications executed elsewhere
+           (for example, in another SimulationContext).
+        */
+        TDigest &getPooled() { return _pooled; }
+    };
+
+    /**
+       \ingroup metasim_stat
+
+       Computes the p-quantile of the recorded values with an
+       HdrHistogram. Like StatTDigest, the value of every run is
+       the p-quantile of the run, and the histograms of all the
+       runs are merged in a pooled histogram (see getPooled()).
+
+       The value (getValue()) is computed at the end of the run:
+       during the run, use getRun().quantile().
+    */
+    class StatHistogram : public BaseStat {
+    protected:
+        double _p;
+        HdrHistogram _run;
+        HdrHistogram _pooled;
+
+        virtual void collect();
+
+    public:
+        StatHistogram(std::string name = "", double p = 0.99,
+                      double highest = 1e9, int digits = 3,
+                      double unit = 1);
+
+        virtual void record(double x)
+            {
+                if (chkTransitory()) return;
+                _run.add(x);
+            }
+        virtual void initValue();
+        virtual void saveState(std::vector<double> &s) const;
+        virtual void restoreState(const double *&s);
+
+        double getProbability() const { return _p; }
+
+        /// The histogram of the current run
+        const HdrHistogram &getRun() const { return _run; }
+
+        /// The histogram of all the completed runs
+        HdrHistogram &getPooled() { return _pooled; }
+    };
+
+} // namespace MetaSim
+
+#endif // __QUANTILE_HPP__
@@ -0,0 +1,256 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <randomgen.hpp>
+
+namespace MetaSim {
+
+    using namespace std;
+
+    namespace {
+        const uint64_t MODULE_53 = uint64_t(1) << 53;
+
+        inline uint64_t splitmix64(uint64_t &x)
+        {
+            uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+    }
+
+    /*-----------------------------------------------------*/
+
+    Xoshiro256Gen::Xoshiro256Gen(RandNum s) : RandomGen(s, MODULE_53)
+    {
+        init(s);
+    }
+
+    void Xoshiro256Gen::init(RandNum s)
+    {
+        _seed = s;
+        uint64_t x = uint64_t(s);
+        for (int i = 0; i < 4; ++i) _s[i] = splitmix64(x);
+    }
+
+    void Xoshiro256Gen::jump(const uint64_t *poly)
+    {
+        uint64_t t[4] = { 0, 0, 0, 0 };
+        for (int i = 0; i < 4; ++i)
+            for (int b = 0; b < 64; ++b) {
+                if (poly[i] & (uint64_t(1) << b))
+                    for (int k = 0; k < 4; ++k) t[k] ^= _s[k];
+                next();
+            }
+        for (int k = 0; k < 4; ++k) _s[k] = t[k];
+    }
+
+    void Xoshiro256Gen::jump()
+    {
+        static const uint64_t JUMP[] = { 
+            0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 
+            0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL 
+        };
+        jump(JUMP);
+    }
+
+    void Xoshiro256Gen::longJump()
+    {
+        static const uint64_t LONG_JUMP[] = { 
+            0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL, 
+            0x77710069854ee241ULL, 0x39109bb02acbe635ULL 
+        };
+        jump(LONG_JUMP);
+    }
+
+    RandomGen *Xoshiro256Gen::clone() const
+    {
+        return new Xoshiro256Gen(*this);
+    }
+
+    RandomGen *Xoshiro256Gen::split()
+    {
+        Xoshiro256Gen *g = new Xoshiro256Gen(*this);
+        jump();
+        return g;
+    }
+
+    RandomGen *Xoshiro256Gen::splitLong()
+    {
+        Xoshiro256Gen *g = new Xoshiro256Gen(*this);
+        longJump();
+        return g;
+    }
+
+    void Xoshiro256Gen::getState(vector<uint64_t> &s) const
+    {
+        s.insert(s.end(), _s, _s + 4);
+    }
+
+    void Xoshiro256Gen::setState(const uint64_t *&s)
+    {
+        for (int i = 0; i < 4; ++i) _s[i] = *s++;
+    }
+
+    /*-----------------------------------------------------*/
+
+    const Pcg64Gen::uint128 Pcg64Gen::MULT = 
+        (uint128(2549297995355413924ULL) << 64) + 4865540595714422341ULL;
+
+    Pcg64Gen::Pcg64Gen(RandNum s, RandNum stream) : 
+        RandomGen(s, MODULE_53), _state(0), _inc(0), _seed(s)
+    {
+        _inc = (uint128(uint64_t(stream)) << 1) | 1;
+        init(s);
+    }
+
+    void Pcg64Gen::init(RandNum s)
+    {
+        _seed = s;
+        _state = 0;
+        next();
+        _state += uint64_t(s);
+        next();
+    }
+
+    void Pcg64Gen::advance(uint64_t lo, uint64_t hi)
+    {
+        // Brown, "Random number generation with arbitrary strides"
+        uint128 delta = (uint128(hi) << 64) | lo;
+        uint128 curMult = MULT, curPlus = _inc;
+        uint128 accMult = 1, accPlus = 0;
+        while (delta > 0) {
+            if (delta & 1) {
+                accMult *= curMult;
+                accPlus = accPlus * curMult + curPlus;
+            }
+            curPlus = (curMult + 1) * curPlus;
+            curMult *= curMult;
+            delta >>= 1;
+        }
+        _state = accMult * _state + accPlus;
+    }
+
+    RandomGen *Pcg64Gen::clone() const
+    {
+        return new Pcg64Gen(*this);
+    }
+
+    RandomGen *Pcg64Gen::split()
+    {
+        Pcg64Gen *g = new Pcg64Gen(*this);
+        jump();
+        return g;
+    }
+
+    RandomGen *Pcg64Gen::splitLong()
+    {
+        Pcg64Gen *g = new Pcg64Gen(*this);
+        longJump();
+        return g;
+    }
+
+    void Pcg64Gen::getState(vector<uint64_t> &s) const
+    {
+        s.push_back(uint64_t(_state));
+        s.push_back(uint64_t(_state >> 64));
+        s.push_back(uint64_t(_inc));
+        s.push_back(uint64_t(_inc >> 64));
+    }
+
+    void Pcg64Gen::setState(const uint64_t *&s)
+    {
+        _state = uint128(s[0]) | (uint128(s[1]) << 64);
+        _inc = uint128(s[2]) | (uint128(s[3]) << 64);
+        s += 4;
+    }
+
+    /*-----------------------------------------------------*/
+
+    PhiloxGen::PhiloxGen(RandNum s) : RandomGen(s, MODULE_53)
+    {
+        init(s);
+    }
+
+    void PhiloxGen::init(RandNum s)
+    {
+        _seed = s;
+        _key[0] = uint32_t(uint64_t(s));
+        _key[1] = uint32_t(uint64_t(s) >> 32);
+        setCounter(0, 0);
+    }
+
+    void PhiloxGen::setCounter(uint64_t lo, uint64_t hi)
+    {
+        _ctr[0] = lo;
+        _ctr[1] = hi;
+        generate();
+    }
+
+    void PhiloxGen::generate()
+    {
+        uint32_t c0 = uint32_t(_ctr[0]), c1 = uint32_t(_ctr[0] >> 32);
+        uint32_t c2 = uint32_t(_ctr[1]), c3 = uint32_t(_ctr[1] >> 32);
+        uint32_t k0 = _key[0], k1 = _key[1];
+        for (int r = 0; r < 10; ++r) {
+            uint64_t p0 = uint64_t(0xD2511F53) * c0;
+            uint64_t p1 = uint64_t(0xCD9E8D57) * c2;
+            c0 = uint32_t(p1 >> 32) ^ c1 ^ k0;
+            c1 = uint32_t(p1);
+            c2 = uint32_t(p0 >> 32) ^ c3 ^ k1;
+            c3 = uint32_t(p0);
+            k0 += 0x9E3779B9;
+            k1 += 0xBB67AE85;
+        }
+        _buf[0] = (uint64_t(c1) << 32) | c0;
+        _buf[1] = (uint64_t(c3) << 32) | c2;
+        _idx = 0;
+    }
+
+    RandomGen *PhiloxGen::clone() const
+    {
+        return new PhiloxGen(*this);
+    }
+
+    RandomGen *PhiloxGen::split()
+    {
+        PhiloxGen *g = new PhiloxGen(*this);
+        jump();
+        return g;
+    }
+
+    RandomGen *PhiloxGen::splitLong()
+    {
+        PhiloxGen *g = new PhiloxGen(*this);
+        longJump();
+        return g;
+    }
+
+    void PhiloxGen::getState(vector<uint64_t> &s) const
+    {
+        s.push_back(uint64_t(_key[0]) | (uint64_t(_key[1]) << 32));
+        s.push_back(_ctr[0]);
+        s.push_back(_ctr[1]);
+        s.push_back(uint64_t(_idx));
+    }
+
+    void PhiloxGen::setState(const uint64_t *&s)
+    {
+        _key[0] = uint32_t(s[0]);
+        _key[1] = uint32_t(s[0] >> 32);
+        setCounter(s[1], s[2]);
+        _idx = int(s[3]);
+        s += 4;
+    }
+
+} // namespace MetaSim
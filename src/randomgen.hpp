@@ -0,0 +1,233 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __RANDOMGEN_HPP__
+#define __RANDOMGEN_HPP__
+
+#include <typeinfo>
+#include <vector>
+
+#include <stdint.h>
+
+#include <randomvar.hpp>
+
+namespace MetaSim {
+
+    /**
+       \ingroup metasim_random
+
+       The xoshiro256** generator of Blackman and Vigna: 256 bits
+       of state, period 2^256 - 1, very fast and of high quality.
+       The seed is expanded to the state with splitmix64.
+
+       jump() advances the generator by 2^128 numbers, and
+       longJump() by 2^192: split() and splitLong() use them to
+       give non-overlapping sequences to the entities and to the
+       replications.
+
+       sample() returns the upper 53 bits of the output (so that
+       a uniform number is a double with full precision), with
+       the lowest bit set so that it is never 0; next() returns
+       the full 64 bits.
+    */
+    class Xoshiro256Gen : public RandomGen {
+        uint64_t _s[4];
+        RandNum _seed;
+
+        static inline uint64_t rotl(uint64_t x, int k)
+            { return (x << k) | (x >> (64 - k)); }
+
+        void jump(const uint64_t *poly);
+
+    public:
+        Xoshiro256Gen(RandNum s = 1);
+
+        virtual void init(RandNum s);
+
+        /// The next 64 bit number
+        inline uint64_t next()
+            {
+                uint64_t r = rotl(_s[1] * 5, 7) * 9;
+                uint64_t t = _s[1] << 17;
+                _s[2] ^= _s[0];
+                _s[3] ^= _s[1];
+                _s[1] ^= _s[2];
+                _s[0] ^= _s[3];
+                _s[2] ^= t;
+                _s[3] = rotl(_s[3], 45);
+                return r;
+            }
+
+        virtual RandNum sample() { return RandNum((next() >> 11) | 1); }
+
+        virtual void fill(RandNum *out, size_t n)
+            {
+                // a derived class may redefine sample() only
+                if (typeid(*this) != typeid(Xoshiro256Gen)) 
+                    return RandomGen::fill(out, n);
+                for (size_t i = 0; i < n; ++i) out[i] = RandNum((next() >> 11) | 1);
+            }
+
+        virtual RandNum getCurrSeed() { return _seed; }
+
+        /// Advances the generator by 2^128 numbers
+        void jump();
+
+        /// Advances the generator by 2^192 numbers
+        void longJump();
+
+        virtual RandomGen *clone() const;
+        virtual RandomGen *split();
+        virtual RandomGen *splitLong();
+        virtual void getState(std::vector<uint64_t> &s) const;
+        virtual void setState(const uint64_t *&s);
+    };
+
+    /**
+       \ingroup metasim_random
+
+       The PCG64 generator of O'Neill (XSL RR 128/64): a 128 bit
+       linear congruential generator with a permuted output,
+       period 2^128. The stream selects one of 2^127 different
+       sequences; the generators of the same stream can jump
+       ahead of any distance in logarithmic time (see advance()):
+       jump() advances by 2^64 numbers, longJump() by 2^96.
+
+       The output is returned like in Xoshiro256Gen.
+    */
+    class Pcg64Gen : public RandomGen {
+        typedef unsigned __int128 uint128;
+
+        uint128 _state;
+        uint128 _inc;
+        RandNum _seed;
+
+        static const uint128 MULT;
+
+    public:
+        /**
+           @param s      the seed (the initial state)
+           @param stream the sequence
+        */
+        Pcg64Gen(RandNum s = 1, RandNum stream = 0);
+
+        virtual void init(RandNum s);
+
+        /// The next 64 bit number
+        inline uint64_t next()
+            {
+                _state = _state * MULT + _inc;
+                uint64_t x = uint64_t(_state >> 64) ^ uint64_t(_state);
+                int r = int(_state >> 122);
+                return (x >> r) | (x << ((-r) & 63));
+            }
+
+        virtual RandNum sample() { return RandNum((next() >> 11) | 1); }
+
+        virtual void fill(RandNum *out, size_t n)
+            {
+                // a derived class may redefine sample() only
+                if (typeid(*this) != typeid(Pcg64Gen)) 
+                    return RandomGen::fill(out, n);
+                for (size_t i = 0; i < n; ++i) out[i] = RandNum((next() >> 11) | 1);
+            }
+
+        virtual RandNum getCurrSeed() { return _seed; }
+
+        /// Advances the generator by 2^hi * 2^64 + lo numbers
+        void advance(uint64_t lo, uint64_t hi = 0);
+
+        /// Advances the generator by 2^64 numbers
+        void jump() { advance(0, 1); }
+
+        /// Advances the generator by 2^96 numbers
+        void longJump() { advance(0, uint64_t(1) << 32); }
+
+        virtual RandomGen *clone() const;
+        virtual RandomGen *split();
+        virtual RandomGen *splitLong();
+        virtual void getState(std::vector<uint64_t> &s) const;
+        virtual void setState(const uint64_t *&s);
+    };
+
+    /**
+       \ingroup metasim_random
+
+       The Philox4x32-10 counter-based generator of Salmon et al.:
+       the numbers are the encryption of a 128 bit counter with a
+       key obtained from the seed, so any position of the sequence
+       can be reached in constant time, and the generators with
+       different keys are independent. Each block gives two 64 bit
+       numbers.
+
+       jump() advances the counter by 2^64 blocks, longJump() by
+       2^96 blocks.
+
+       The output is returned like in Xoshiro256Gen.
+    */
+    class PhiloxGen : public RandomGen {
+        uint32_t _key[2];
+        uint64_t _ctr[2];    // the counter of the current block
+        uint64_t _buf[2];    // the current block
+        int _idx;            // the next number of the block
+        RandNum _seed;
+
+        // computes the block of the counter
+        void generate();
+
+    public:
+        PhiloxGen(RandNum s = 1);
+
+        virtual void init(RandNum s);
+
+        /// The next 64 bit number
+        inline uint64_t next()
+            {
+                if (_idx == 2) {
+                    if (++_ctr[0] == 0) ++_ctr[1];
+                    generate();
+                }
+                return _buf[_idx++];
+            }
+
+        virtual RandNum sample() { return RandNum((next() >> 11) | 1); }
+
+        virtual void fill(RandNum *out, size_t n)
+            {
+                // a derived class may redefine sample() only
+                if (typeid(*this) != typeid(PhiloxGen)) 
+                    return RandomGen::fill(out, n);
+                for (size_t i = 0; i < n; ++i) out[i] = RandNum((next() >> 11) | 1);
+            }
+
+        virtual RandNum getCurrSeed() { return _seed; }
+
+        /// Moves to block ctr (lo, hi), at its first number
+        void setCounter(uint64_t lo, uint64_t hi);
+
+        /// Advances the counter by 2^64 blocks
+        void jump() { setCounter(_ctr[0], _ctr[1] + 1); }
+
+        /// Advances the counter by 2^96 blocks
+        void longJump() { setCounter(_ctr[0], _ctr[1] + (uint64_t(1) << 32)); }
+
+        virtual RandomGen *clone() const;
+        virtual RandomGen *split();
+        virtual RandomGen *splitLong();
+        virtual void getState(std::vector<uint64_t> &s) const;
+        virtual void setState(const uint64_t *&s);
+    };
+
+} // namespace MetaSim
+
+#endif // __RANDOMGEN_HPP__
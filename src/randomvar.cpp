@@ -11,13 +11,22 @@
  *   (at your option) any later version.                                   *
  *                                                                         *
  ***************************************************************************/
+#include <algorithm>
+#include <cctype>
 #include <cmath>
+#include <cstring>
 #include <memory>
 #include <string>
+#include <typeinfo>
 #include <vector>
 
 #include <cstdlib>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <randomvar.hpp>
 #include <simul.hpp>
 #include <strtoken.hpp>
@@ -33,7 +42,9 @@ namespace MetaSim {
 
     RandomGen RandomVar::_stdgen(1);
 
-    RandomGen* RandomVar::_pstdgen(&_stdgen);
+    thread_local RandomGen* RandomVar::_pstdgen(&_stdgen);
+
+    thread_local RandomVar::Method RandomVar::_defMethod(RandomVar::FAST);
 
     const RandNum RandomGen::A = 16807;
     const RandNum RandomGen::M = 2147483647;
@@ -48,7 +59,16 @@ namespace MetaSim {
 
     /*---------------------------------------------------*/
 
-    RandomGen::RandomGen(RandNum s) : _seed(s), _xn(s)
+    RandomGen::RandomGen(RandNum s) : _seed(s), _xn(s), _module(M)
+    {
+    }
+
+    RandomGen::RandomGen(RandNum s, RandNum module) : 
+        _seed(s), _xn(s), _module(module)
+    {
+    }
+
+    RandomGen::~RandomGen()
     {
     }
 
@@ -65,22 +85,73 @@ namespace MetaSim {
         return _xn;
     };
 
+    void RandomGen::fill(RandNum *out, size_t n)
+    {
+        // a derived class that redefines only sample() must get
+        // its own numbers
+        if (typeid(*this) != typeid(RandomGen)) {
+            for (size_t i = 0; i < n; ++i) out[i] = sample();
+            return;
+        }
+
+        // The same sequence of sample(), computed in 64 bits: since
+        // M = 2^31 - 1, A * x mod M is the sum of the high and the
+        // low 31 bits of the product, which is shorter than the
+        // divisions of Schrage's method (the numbers are computed
+        // one after the other, so the latency counts).
+        uint64_t x = _xn;
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t p = uint64_t(A) * x;
+            x = (p & uint64_t(M)) + (p >> 31);
+            if (x >= uint64_t(M)) x -= M;
+            out[i] = RandNum(x);
+        }
+        _xn = RandNum(x);
+    }
+
     void RandomGen::init(RandNum s)
     {
         _xn = _seed = s;
     }
 
+    RandomGen *RandomGen::clone() const
+    {
+        return new RandomGen(*this);
+    }
+
+    RandomGen *RandomGen::split()
+    {
+        return new RandomGen(sample());
+    }
+
+    RandomGen *RandomGen::splitLong()
+    {
+        return split();
+    }
+
+    void RandomGen::getState(vector<uint64_t> &s) const
+    {
+        s.push_back(uint64_t(_xn));
+    }
+
+    void RandomGen::setState(const uint64_t *&s)
+    {
+        _xn = RandNum(*s++);
+    }
+
     /*---------------------------------------------------*/
 
     const unsigned long PoissonVar::CUTOFF = 10000;
+    const double PoissonVar::SMALL = 10;
 
-    RandomVar::RandomVar(RandomGen* gen) : _gen(gen)
+    RandomVar::RandomVar(RandomGen* gen) : _gen(gen), _buf(), _bufPos(0)
     {
         if (_gen == NULL) 
             _gen = _pstdgen;
     }
 
-    RandomVar::RandomVar(const RandomVar &r) : _gen(r._gen)
+    RandomVar::RandomVar(const RandomVar &r) : 
+        _gen(r._gen), _buf(r._buf), _bufPos(r._bufPos)
     {
     }
 
@@ -100,6 +171,86 @@ namespace MetaSim {
         _pstdgen = &_stdgen;
     }
 
+    void RandomVar::fill(double *out, size_t n)
+    {
+        for (size_t i = 0; i < n; ++i) out[i] = get();
+    }
+
+    void RandomVar::setBuffer(size_t n)
+    {
+        // the prefetched values are discarded
+        _buf.resize(n);
+        _bufPos = n;
+    }
+
+    double RandomVar::refill()
+    {
+        if (_buf.empty()) return get();
+        fill(&_buf[0], _buf.size());
+        _bufPos = 1;
+        return _buf[0];
+    }
+
+    /*-----------------------------------------------------*/
+
+    namespace {
+        // numbers of the generator taken at a time
+        const size_t BLOCK = 256;
+
+        // The kernels of fill(): scalar loops over a block. The
+        // int64 -> double conversion has no vector instruction
+        // before AVX-512DQ, so the gain is in the calls saved.
+        inline void uniformKernel(const RandNum *x, double *out, size_t n,
+                                  double min, double width, double module)
+        {
+            for (size_t i = 0; i < n; ++i) 
+                out[i] = double(x[i]) * width / module + min;
+        }
+
+        inline void scaleKernel(double *out, size_t n, double a)
+        {
+            for (size_t i = 0; i < n; ++i) out[i] *= a;
+        }
+
+        // The ziggurat method of Marsaglia and Tsang: the area
+        // under the density is covered by LAYERS horizontal
+        // layers of equal area v. Layer i spans [0, x[i]] on the
+        // x axis and [f[i], f[i+1]] on the y axis; the bottom one
+        // is a rectangle of width r plus the tail beyond r, and
+        // x[0] = v / f(r) is the width of a rectangle of area v.
+        // A point x drawn in layer i is accepted immediately if
+        // x < x[i+1], that is most of the times.
+        const int LAYERS = 256;
+
+        struct Ziggurat {
+            double x[LAYERS + 1];
+            double f[LAYERS + 1];
+
+            Ziggurat(double (*dens)(double), double (*inv)(double),
+                     double r, double v)
+            {
+                x[0] = v / dens(r);
+                x[1] = r;
+                for (int i = 1; i < LAYERS - 1; ++i)
+                    x[i + 1] = inv(v / x[i] + dens(x[i]));
+                x[LAYERS] = 0;
+                for (int i = 0; i <= LAYERS; ++i) f[i] = dens(x[i]);
+            }
+        };
+
+        double normalDensity(double x) { return exp(-0.5 * x * x); }
+        double normalInverse(double y) { return sqrt(-2 * log(y)); }
+        double expDensity(double x) { return exp(-x); }
+        double expInverse(double y) { return -log(y); }
+
+        // the tables are computed once, when the library is loaded;
+        // r and v for 256 layers are from Marsaglia and Tsang (2000)
+        const Ziggurat normalZig(normalDensity, normalInverse,
+                                 3.6541528853610088, 0.00492867323399);
+        const Ziggurat expZig(expDensity, expInverse,
+                              7.69711747013104972, 0.0039496598225815572);
+    }
+
 
     /*-----------------------------------------------------*/
 
@@ -122,6 +273,19 @@ namespace MetaSim {
         return tmp;
     };
 
+    void UniformVar::fill(double *out, size_t n)
+    {
+        RandNum x[BLOCK];
+        double m = double(_gen->getModule());
+        while (n > 0) {
+            size_t k = n < BLOCK ? n : BLOCK;
+            _gen->fill(x, k);
+            uniformKernel(x, out, k, _min, _max - _min, m);
+            out += k;
+            n -= k;
+        }
+    }
+
     RandomVar *UniformVar::createInstance(vector<string> &par) 
     {
         double a,b;
@@ -138,9 +302,32 @@ namespace MetaSim {
 
     double ExponentialVar::get()
     {
-        return -log(UniformVar::get()) * _lambda;
+        if (_method == LEGACY) return -log(UniformVar::get()) * _lambda;
+
+        // the fraction of u selects the point in the layer
+        while (true) {
+            double u = UniformVar::get() * LAYERS;
+            int i = int(u);
+            double x = (u - i) * expZig.x[i];
+            if (x < expZig.x[i + 1]) return x * _lambda;
+            // the tail: the distribution has no memory
+            if (i == 0) return (expZig.x[1] - log(UniformVar::get())) * _lambda;
+            double y = expZig.f[i] + UniformVar::get() * (expZig.f[i + 1] - expZig.f[i]);
+            if (y < exp(-x)) return x * _lambda;
+        }
     };
 
+    void ExponentialVar::fill(double *out, size_t n)
+    {
+        if (_method != LEGACY) {
+            for (size_t i = 0; i < n; ++i) out[i] = ExponentialVar::get();
+            return;
+        }
+        UniformVar::fill(out, n);
+        for (size_t i = 0; i < n; ++i) out[i] = -log(out[i]);
+        scaleKernel(out, n, _lambda);
+    }
+
     RandomVar *ExponentialVar::createInstance(vector<string> &par) 
     {
         if (par.size() != 1)
@@ -158,6 +345,14 @@ namespace MetaSim {
         return _mu * pow (UniformVar::get(), -1/_order);
     };
 
+    void ParetoVar::fill(double *out, size_t n)
+    {
+        UniformVar::fill(out, n);
+        double e = -1/_order;
+        for (size_t i = 0; i < n; ++i) out[i] = pow(out[i], e);
+        scaleKernel(out, n, _mu);
+    }
+
     RandomVar *ParetoVar::createInstance(vector<string> &par) 
     {
         double a,b;
@@ -172,8 +367,38 @@ namespace MetaSim {
 
     /*-----------------------------------------------------*/
 
+    double NormalVar::get()
+    {
+        if (_method == LEGACY) return legacy();
+
+        // the fraction of u gives the sign and the point in the
+        // layer
+        while (true) {
+            double u = UniformVar::get() * (2 * LAYERS);
+            int k = int(u);
+            int i = k >> 1;
+            double x = (u - k) * normalZig.x[i];
+            // without a branch, that would be mispredicted half
+            // of the times
+            double s = _sigma * (1 - 2 * (k & 1));
+            if (x < normalZig.x[i + 1]) return _mu + s * x;
+            if (i == 0) {
+                // the tail, with the method of Marsaglia (1964)
+                double r = normalZig.x[1];
+                double a, b;
+                do {
+                    a = -log(UniformVar::get()) / r;
+                    b = -log(UniformVar::get());
+                } while (b + b < a * a);
+                return _mu + s * (r + a);
+            }
+            double y = normalZig.f[i] + UniformVar::get() * (normalZig.f[i + 1] - normalZig.f[i]);
+            if (y < exp(-0.5 * x * x)) return _mu + s * x;
+        }
+    }
+
 #ifndef CEPHES_LIB
-    double NormalVar::get() 
+    double NormalVar::legacy() 
     {
         double t1,t2,r;
   
@@ -196,12 +421,18 @@ namespace MetaSim {
         return _mu + t2 * r;
     };
 #else
-    double NormalVar::get()
+    double NormalVar::legacy()
     {
         return _mu + _sigma * ndtri(UniformVar::get());
     }
 #endif
 
+    void NormalVar::fill(double *out, size_t n)
+    {
+        // the calls of get() are not virtual
+        for (size_t i = 0; i < n; ++i) out[i] = NormalVar::get();
+    }
+
     RandomVar *NormalVar::createInstance(vector<string> &par) 
     {
         double a,b;
@@ -217,10 +448,31 @@ namespace MetaSim {
 
     /*-----------------------------------------------------*/
 
+    PoissonVar::PoissonVar(double l, RandomGen *g) : 
+        UniformVar(0, 1, g), _lambda(l), _method(_defMethod),
+        _expLambda(exp(-l)), _logLambda(log(l))
+    {
+        _b = 0.931 + 2.53 * sqrt(l);
+        _a = -0.059 + 0.02483 * _b;
+        _logAlpha = log(1.1239 + 1.1328 / (_b - 3.4));
+        _vr = 0.9277 - 3.6224 / (_b - 2);
+    }
+
     double PoissonVar::get() 
+    {
+        if (_lambda < SMALL || _method == LEGACY) return inversion();
+        return ptrs();
+    }
+
+    void PoissonVar::fill(double *out, size_t n)
+    {
+        for (size_t i = 0; i < n; ++i) out[i] = PoissonVar::get();
+    }
+
+    double PoissonVar::inversion()
     {
         double u = UniformVar::get();
-        double F = exp(-_lambda);
+        double F = _expLambda;
         double S = F;
 
         for (register unsigned int i = 1; i < CUTOFF; ++i) {
@@ -231,6 +483,25 @@ namespace MetaSim {
         return CUTOFF;
     }
 
+    // W. Hormann, "The transformed rejection method for generating
+    // Poisson random variables", Insurance: Mathematics and
+    // Economics 12, 1993
+    double PoissonVar::ptrs()
+    {
+        while (true) {
+            double u = UniformVar::get() - 0.5;
+            double v = UniformVar::get();
+            double us = 0.5 - fabs(u);
+            double k = floor((2 * _a / us + _b) * u + _lambda + 0.43);
+            // the region of immediate acceptance
+            if (us >= 0.07 && v <= _vr) return k;
+            if (k < 0 || (us < 0.013 && v > us)) continue;
+            if (log(v) + _logAlpha - log(_a / (us * us) + _b) <= 
+                -_lambda + k * _logLambda - lgamma(k + 1))
+                return k;
+        }
+    }
+
     RandomVar* PoissonVar::createInstance(vector<string> &par) 
     {
         double a;
@@ -244,72 +515,329 @@ namespace MetaSim {
 
     /*-----------------------------------------------------*/
 
-    DetVar::DetVar(const std::string &filename) :
-        _array()
+    namespace {
+        // the doubles of the binary traces are little endian
+        inline double fromLittleEndian(double v)
+        {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            uint64_t b;
+            memcpy(&b, &v, sizeof(b));
+            b = __builtin_bswap64(b);
+            memcpy(&v, &b, sizeof(b));
+#endif
+            return v;
+        }
+
+        const double POW10[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        // Parses a number like strtod(). The numbers with at most
+        // 15 significant digits and small exponents (almost all
+        // the numbers written by programs and by people) are
+        // computed directly, with a single multiplication or
+        // division by an exact power of 10, which is correctly
+        // rounded (Clinger's fast path); the others are left to
+        // strtod().
+        double parseNumber(const char *p, char **end)
+        {
+            const char *q = p;
+            bool neg = false;
+            if (*q == '-' || *q == '+') neg = (*q++ == '-');
+            uint64_t m = 0;
+            int digits = 0, exp = 0;
+            const char *d = q;
+            while (*q >= '0' && *q <= '9') {
+                if (m != 0 || *q != '0') digits++;
+                m = m * 10 + (*q++ - '0');
+                if (digits > 15) return strtod(p, end);
+            }
+            if (*q == '.') {
+                ++q;
+                while (*q >= '0' && *q <= '9') {
+                    if (m != 0 || *q != '0') digits++;
+                    m = m * 10 + (*q++ - '0');
+                    exp--;
+                    if (digits > 15) return strtod(p, end);
+                }
+            }
+            if (q == d || (q == d + 1 && *d == '.')) return strtod(p, end);
+            if (*q == 'e' || *q == 'E') {
+                const char *e = q + 1;
+                bool eneg = false;
+                if (*e == '-' || *e == '+') eneg = (*e++ == '-');
+                if (*e < '0' || *e > '9') return strtod(p, end);
+                int x = 0;
+                while (*e >= '0' && *e <= '9' && x < 1000) x = x * 10 + (*e++ - '0');
+                exp += eneg ? -x : x;
+                q = e;
+            }
+            if (exp < -22 || exp > 22 || (*q >= '0' && *q <= '9') ||
+                *q == 'x' || *q == 'X')
+                return strtod(p, end);
+            double v = double(m);
+            v = exp < 0 ? v / POW10[-exp] : v * POW10[exp];
+            *end = const_cast<char *>(q);
+            return neg ? -v : v;
+        }
+    }
+
+    /// A binary trace mapped in memory
+    struct DetVar::Mapping {
+        void *addr;
+        size_t length;
+
+        Mapping(const std::string &filename) : addr(NULL), length(0)
+        {
+            int fd = open(filename.c_str(), O_RDONLY);
+            if (fd < 0) {
+                string errMsg = Exc::_FILEOPEN  + string(filename) + "\n";
+                throw Exc(errMsg, "DetVar");
+            }
+            struct stat st;
+            if (fstat(fd, &st) < 0 || st.st_size == 0 ||
+                st.st_size % sizeof(double) != 0) {
+                close(fd);
+                throw Exc("Empty or malformed binary trace " + filename, "DetVar");
+            }
+            length = st.st_size;
+            addr = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (addr == MAP_FAILED)
+                throw Exc("Cannot map " + filename, "DetVar");
+            madvise(addr, length, MADV_SEQUENTIAL);
+        }
+
+        ~Mapping() { munmap(addr, length); }
+    };
+
+    /**
+       Reads a text trace a block at a time, and parses the
+       numbers with parseNumber(), which is much faster than the
+       operator >> of the streams.
+    */
+    struct DetVar::TextReader {
+        static const size_t BLOCK = 1 << 20;
+
+        std::string filename;
+        ifstream is;
+        vector<char> buf;
+        // the beginning of a number cut by the end of the block
+        std::string carry;
+        // the parsed values, for STREAM
+        vector<double> values;
+        size_t pos;
+        // true if the file contains some values
+        bool any;
+
+        TextReader(const std::string &f) : 
+            filename(f), is(f.c_str(), ios::binary), buf(BLOCK + 1),
+            carry(), values(), pos(0), any(false)
+        {
+            if (!is.is_open()) {
+                string errMsg = Exc::_FILEOPEN  + string(filename) + "\n";
+                throw Exc(errMsg, "DetVar");
+            }
+        }
+
+        /// Appends the numbers of the next block to out; returns
+        /// false at the end of the file
+        bool read(vector<double> &out)
+        {
+            if (!is) return false;
+            size_t c = carry.size();
+            memcpy(&buf[0], carry.data(), c);
+            is.read(&buf[c], BLOCK - c);
+            size_t n = c + is.gcount();
+            bool last = !is;
+
+            // a number can continue in the next block
+            size_t end = n;
+            if (!last) {
+                while (end > 0 && !isspace((unsigned char) buf[end - 1])) --end;
+                if (end == 0) 
+                    throw Exc("Malformed trace " + filename, "DetVar");
+            }
+            carry.assign(&buf[end], n - end);
+            buf[end] = '\0';
+
+            const char *p = &buf[0];
+            while (true) {
+                while (isspace((unsigned char) *p)) ++p;
+                if (*p == '\0') break;
+                char *q;
+                double v = parseNumber(p, &q);
+                if (q == p) 
+                    throw Exc("Malformed trace " + filename, "DetVar");
+                out.push_back(v);
+                p = q;
+            }
+            return true;
+        }
+
+        /// The next value, from the beginning after the last one
+        double next()
+        {
+            while (pos == values.size()) {
+                values.clear();
+                pos = 0;
+                if (read(values)) {
+                    if (!values.empty()) any = true;
+                    continue;
+                }
+                if (!any) throw Exc("Empty trace " + filename, "DetVar");
+                is.clear();
+                is.seekg(0);
+                carry.clear();
+            }
+            return values[pos++];
+        }
+    };
+
+    DetVar::DetVar(const std::string &filename, Mode m) :
+        _array(), _map(), _stream(), _filename(filename),
+        _data(NULL), _size(0), _count(0), _hasRange(false), _min(0), _max(0)
     {
         DBGENTER(_RANDOMVAR_DBG_LEV);
-        ifstream inFile;
-        double v;
-
         DBGPRINT_2("Reading from ", filename);
 
-        inFile.open(filename.c_str());
-        if (!inFile.is_open()) {
-            string errMsg = Exc::_FILEOPEN  + string(filename) + "\n";
-            throw Exc(errMsg, "DetVar");
+        if (m == MAP) {
+            _map.reset(new Mapping(filename));
+            _data = static_cast<const double *>(_map->addr);
+            _size = _map->length / sizeof(double);
         }
-        while (!inFile.eof()) {
-            inFile >> v;
-            _array.push_back(v);
-            DBGVAR(_array.back());
+        else if (m == STREAM) 
+            _stream.reset(new TextReader(filename));
+        else {
+            TextReader r(filename);
+            while (r.read(_array)) ;
+            _data = _array.empty() ? NULL : &_array[0];
+            _size = _array.size();
         }
-        inFile.close();
-        _count = 0;
     };
 
-    DetVar::DetVar(vector<double> &a) : _array(a) 
+    DetVar::DetVar(vector<double> &a) : 
+        _array(a), _map(), _stream(), _filename(),
+        _data(_array.empty() ? NULL : &_array[0]), _size(_array.size()),
+        _count(0), _hasRange(false), _min(0), _max(0)
     {
-        _count = 0;
     }
 
-    DetVar::DetVar(double *a, int s)
+    DetVar::DetVar(double *a, int s) :
+        _array(a, a + s), _map(), _stream(), _filename(),
+        _data(_array.empty() ? NULL : &_array[0]), _size(_array.size()),
+        _count(0), _hasRange(false), _min(0), _max(0)
     {
-        for (int i = 0; i < s; ++i) 
-            _array.push_back(a[i]);
-        _count = 0;
+    }
+
+    DetVar::DetVar(const DetVar &d) :
+        RandomVar(d), _array(d._array), _map(d._map), _stream(d._stream),
+        _filename(d._filename), _data(d._data), _size(d._size),
+        _count(d._count), _hasRange(d._hasRange), _min(d._min), _max(d._max)
+    {
+        if (!_map) _data = _array.empty() ? NULL : &_array[0];
     }
 
     double DetVar::get() 
     {
-        if (_count >= _array.size())
+        if (_stream) return _stream->next();
+        if (_count >= _size) {
+            if (_size == 0) throw Exc("Empty trace", "DetVar");
             _count = 0;
-        return _array[_count++];
+        }
+        if (_map) return fromLittleEndian(_data[_count++]);
+        return _data[_count++];
+    }
+
+    void DetVar::fill(double *out, size_t n)
+    {
+        if (_stream) {
+            for (size_t i = 0; i < n; ++i) out[i] = _stream->next();
+            return;
+        }
+        while (n > 0) {
+            if (_count >= _size) {
+                if (_size == 0) throw Exc("Empty trace", "DetVar");
+                _count = 0;
+            }
+            size_t k = min(n, _size - _count);
+            memcpy(out, _data + _count, k * sizeof(double));
+            if (_map) 
+                for (size_t i = 0; i < k; ++i) out[i] = fromLittleEndian(out[i]);
+            _count += k;
+            out += k;
+            n -= k;
+        }
+    }
+
+    void DetVar::computeRange()
+    {
+        vector<double> v;
+        const double *p = _data;
+        size_t n = _size;
+        TextReader *r = NULL;
+        if (_stream) r = new TextReader(_filename);
+
+        bool first = true;
+        while (true) {
+            if (r != NULL) {
+                v.clear();
+                if (!r->read(v)) break;
+                p = v.empty() ? NULL : &v[0];
+                n = v.size();
+            }
+            for (size_t i = 0; i < n; ++i) {
+                double x = _map ? fromLittleEndian(p[i]) : p[i];
+                if (first || x < _min) _min = x;
+                if (first || x > _max) _max = x;
+                first = false;
+            }
+            if (r == NULL) break;
+        }
+        delete r;
+        _hasRange = true;
     }
 
     double DetVar::getMaximum() throw(MaxException)
     {
-        if (_array.empty()) return 0;
-        double max = _array[0];
-        for (unsigned int i = 1; i < _array.size(); i++)
-            if (_array[i] > max) max = _array[i];
-        return max;
+        if (!_hasRange) computeRange();
+        return _max;
     }
 
     double DetVar::getMinimum() throw(MaxException)
     {
-        if (_array.empty()) return 0;
-        double min = _array[0];
-        for (unsigned int i = 1; i < _array.size(); i++)
-            if (_array[i] < min) min = _array[i];
-        return min;
+        if (!_hasRange) computeRange();
+        return _min;
+    }
+
+    void DetVar::writeBinary(const std::string &filename, const double *v, size_t n)
+    {
+        ofstream os(filename.c_str(), ios::binary);
+        if (!os.is_open()) {
+            string errMsg = Exc::_FILEOPEN  + string(filename) + "\n";
+            throw Exc(errMsg, "DetVar");
+        }
+        for (size_t i = 0; i < n; ++i) {
+            double x = fromLittleEndian(v[i]);
+            os.write(reinterpret_cast<const char *>(&x), sizeof(x));
+        }
+        if (!os) throw Exc("Cannot write " + filename, "DetVar");
     }
 
     RandomVar *DetVar::createInstance(vector<string> &par) 
     {
-        if (par.size() != 1) 
+        if (par.size() != 1 && par.size() != 2) 
             throw ParseExc("Wrong number of parameters", "DetVar");
 
-        return new DetVar(par[0]);
+        Mode m = LOAD;
+        if (par.size() == 2) {
+            if (par[1] == "map") m = MAP;
+            else if (par[1] == "stream") m = STREAM;
+            else if (par[1] != "load") 
+                throw ParseExc("Unknown mode " + par[1], "DetVar");
+        }
+        return new DetVar(par[0], m);
     } 
 
 
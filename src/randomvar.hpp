@@ -16,9 +16,12 @@
 
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include <stdint.h>
+
 #include <baseexc.hpp>
 
 #ifdef _MSC_VER
@@ -55,7 +58,12 @@ namespace MetaSim {
     //@{
     /** 
         The basic class for Random Number Generator. It is possible to
-        derive from this class to implement a new generator. */
+        derive from this class to implement a new generator (see
+        randomgen.hpp): a derived class returns from sample() numbers
+        uniformly distributed in [1, getModule() - 1].
+
+        This class implements the "minimal standard" generator of Park
+        and Miller, with 31 bit numbers. */
     class RandomGen {
         RandNum _seed;
         RandNum _xn;
@@ -66,6 +74,13 @@ namespace MetaSim {
         static const RandNum Q;	// M div A
         static const RandNum R;	// M mod A
 
+    protected:
+        /// The upper bound of the numbers returned by sample()
+        RandNum _module;
+
+        /// For the derived classes, that have their own state
+        RandomGen(RandNum s, RandNum module);
+
     public:
         /**
            Creates a Random Generator with s as initial seed.
@@ -73,19 +88,56 @@ namespace MetaSim {
         */
         RandomGen(RandNum s);
 
+        virtual ~RandomGen();
+
         /** Initialize the generator with seed s */
-        void init(RandNum s);
+        virtual void init(RandNum s);
 
         /** extract the next random number from the
             sequence */
-        RandNum sample();
+        virtual RandNum sample();
 
-        /** Returns the current sequence number. */
-        RandNum getCurrSeed() { return _xn; }
+        /** writes in out the next n numbers of the sequence, the
+            same that n calls of sample() would return, without a
+            virtual call per number. In a derived class that does
+            not redefine it, it calls sample() n times. */
+        virtual void fill(RandNum *out, size_t n);
+
+        /** Returns the current sequence number (for the derived
+            generators, the seed). */
+        virtual RandNum getCurrSeed() { return _xn; }
 
         /** return the constant M (the module of this random
             generator */
-        RandNum getModule() { return M; }
+        RandNum getModule() { return _module; }
+
+        /// Returns a copy of this generator, owned by the caller
+        virtual RandomGen *clone() const;
+
+        /**
+           Returns a new generator (owned by the caller) of the same
+           kind, for another entity or thread. The generators of
+           randomgen.hpp jump ahead, so that the new generator and
+           this one produce non-overlapping sequences (see
+           Xoshiro256Gen::jump()). This generator has a too short
+           period for that: the new one is seeded with a sample of
+           this one.
+        */
+        virtual RandomGen *split();
+
+        /**
+           Like split(), with a much longer jump: a generator
+           obtained with splitLong() can in turn be split() many
+           times without overlapping with this one. Used for the
+           replications (see Simulation::run_parallel()).
+        */
+        virtual RandomGen *splitLong();
+
+        /// Appends the state of the generator to s
+        virtual void getState(std::vector<uint64_t> &s) const;
+
+        /// Restores the state saved by getState(), advancing s
+        virtual void setState(const uint64_t *&s);
     };
 
     /**
@@ -100,17 +152,38 @@ namespace MetaSim {
         static RandomGen _stdgen;
 
         /** Pointer to the current generator (used by the next
-            RandomVar object to be created. */
-        static RandomGen *_pstdgen;
+            RandomVar object to be created. Every thread has its
+            own pointer, so that each thread can create its
+            random variables on a different generator. */
+        static thread_local RandomGen *_pstdgen;
 
         /** The current random generator (used by this
             object). By default, it is equal to _pstdgen */
         RandomGen *_gen;
 
+        /// The values prefetched by draw() (see setBuffer())
+        std::vector<double> _buf;
+        size_t _bufPos;
+
+        /// Refills the buffer and returns its first value
+        double refill();
+
     public:
 
         typedef string BASE_KEY_TYPE;
 
+        /**
+           The sampling algorithms of the variables that have more
+           than one (NormalVar, ExponentialVar, GenericVar and
+           PoissonVar).
+           FAST is the fastest (the ziggurat for NormalVar and
+           ExponentialVar, the alias method for GenericVar, PTRS
+           for PoissonVar); LEGACY is the algorithm of the previous
+           versions of the library, that gives the same sequences,
+           to reproduce old experiments.
+        */
+        enum Method { FAST, LEGACY };
+
         /**
            \ingroup metasim_exc
 
@@ -161,21 +234,65 @@ namespace MetaSim {
         /// seed
         static inline void init(RandNum s) { _pstdgen->init(s); }
   
+        /// Returns the standard generator of the calling thread
+        static inline RandomGen *getGenerator() { return _pstdgen; }
+
         /// Change the standard generator
         static RandomGen * changeGenerator(RandomGen *g);
 
         /// Restore the standard generator
         static void restoreGenerator();
 
+        /// Sets the method of the variables created from now on by
+        /// the calling thread (FAST by default)
+        static void setDefaultMethod(Method m) { _defMethod = m; }
+
+        static Method getDefaultMethod() { return _defMethod; }
+
         /** 
             This method must be overloaded in each derived
             class to return a double according to the propoer
             distriibution. */
         virtual double get() = 0;
 
+        /**
+           Writes in out the next n values of the variable, the same
+           that n calls of get() would return. The derived classes
+           override it to take the numbers from the generator in
+           blocks and transform them in scalar loops, without a
+           virtual call per value; the default calls get() n times.
+        */
+        virtual void fill(double *out, size_t n);
+
+        /**
+           Sets the size of the buffer used by draw() (0, the
+           default, disables it). 
+
+           With a buffer, the values are computed n at a time with
+           fill(), so the cost of the virtual call is amortized.
+           Note that the values are taken from the generator in
+           advance: if the generator is shared with other
+           variables, the sequence of every variable changes with
+           the size of the buffer (but remains reproducible), and
+           the values in the buffer are not part of the state of
+           the generator saved by the Time Warp engine.
+        */
+        void setBuffer(size_t n);
+
+        /// The next value: from the buffer if there is one,
+        /// otherwise from get()
+        inline double draw()
+            {
+                if (_bufPos < _buf.size()) return _buf[_bufPos++];
+                return refill();
+            }
+
         virtual double getMaximum() throw(MaxException) = 0;
         virtual double getMinimum() throw(MaxException) = 0;
 
+    protected:
+        /// Method of the next variables created by this thread
+        static thread_local Method _defMethod;
     };
 
     /**  
@@ -188,6 +305,8 @@ namespace MetaSim {
     public:
         DeltaVar(double a) : RandomVar(), _var(a) {}
         virtual double get() { return _var; } 
+        virtual void fill(double *out, size_t n) 
+            { for (size_t i = 0; i < n; ++i) out[i] = _var; }
         virtual ~DeltaVar() {};
         static RandomVar *createInstance(vector<string> &par);  
         virtual double getMaximum() throw(MaxException) {return _var;}
@@ -196,13 +315,15 @@ namespace MetaSim {
 
     /** 
         This class implements an uniform distribution, between min
-        and max. */
+        and max. The derived classes that redefine get() must
+        redefine also fill(). */
     class UniformVar : public RandomVar {
         double _min, _max;
     public:
         UniformVar(double min, double max, RandomGen *g = NULL) 
             : RandomVar(g), _min(min), _max(max) {}
         virtual double get();
+        virtual void fill(double *out, size_t n);
         virtual ~UniformVar() {}
         static RandomVar *createInstance(vector<string> &par);
         virtual double getMaximum() throw(MaxException) {return _max;}
@@ -213,11 +334,22 @@ namespace MetaSim {
        This class implements an exponential distribution, with mean m. */ 
     class ExponentialVar : public UniformVar {
         double _lambda;
+        Method _method;
     public :
         ExponentialVar(double m, RandomGen *g = NULL) : 
-            UniformVar(0, 1, g), _lambda(m) {}
+            UniformVar(0, 1, g), _lambda(m), _method(_defMethod) {}
 
+        /**
+           With the FAST method (the default, a ziggurat), a
+           value takes usually one number from the generator and no
+           logarithm; with LEGACY it is -m log(u).
+        */
         virtual double get();
+        virtual void fill(double *out, size_t n);
+
+        void setMethod(Method k) { _method = k; }
+        Method getMethod() const { return _method; }
+
 
         static RandomVar *createInstance(vector<string> &par);
         virtual double getMaximum() throw(MaxException)
@@ -234,6 +366,7 @@ namespace MetaSim {
         ParetoVar(double m, double k, RandomGen *g = NULL) : 
             UniformVar(0,1,g), _mu(m), _order(k) {};
         virtual double get();
+        virtual void fill(double *out, size_t n);
         static RandomVar *createInstance(vector<string> &par);
         virtual double getMaximum() throw(MaxException)
             {throw MaxException("ExponentialVar");}
@@ -249,12 +382,29 @@ namespace MetaSim {
         double _mu, _sigma;
         bool _yes;
         double _oldv;
+        Method _method;
+
+        /// The polar method (or ndtri())
+        double legacy();
   
     public:
         NormalVar(double m, double s, RandomGen *g = NULL) : 
-            UniformVar(0,1,g), _mu(m), _sigma(s), _yes(false)
+            UniformVar(0,1,g), _mu(m), _sigma(s), _yes(false),
+            _oldv(0), _method(_defMethod)
             {}
+
+        /**
+           With the FAST method (the default, a ziggurat), a value
+           takes usually one number from the generator; with LEGACY, the
+           polar method of Marsaglia (or ndtri(), if the library
+           is compiled with CEPHES_LIB).
+        */
         virtual double get();
+        virtual void fill(double *out, size_t n);
+
+        void setMethod(Method k) { _method = k; _yes = false; }
+        Method getMethod() const { return _method; }
+
         static RandomVar *createInstance(vector<string> &par);
         virtual double getMaximum() throw(MaxException)
             {throw MaxException("NormalVar");}
@@ -264,14 +414,35 @@ namespace MetaSim {
 
 
     /**
-       This class implements a Poisson distribution, with mean lambda */
+       This class implements a Poisson distribution, with mean lambda.
+
+       For lambda < SMALL, and with the LEGACY method, the variable
+       is sampled by sequential inversion, that takes at most
+       CUTOFF steps; for larger lambda, by the transformed rejection
+       of Hormann (PTRS), that takes a constant time on average and
+       does not underflow for lambda larger than about 700. The
+       constants of both are computed by the constructor.
+    */
     class PoissonVar : public UniformVar {
         double _lambda;
+        Method _method;
+        // exp(-lambda), for the inversion
+        double _expLambda;
+        // the constants of the PTRS
+        double _logLambda, _a, _b, _logAlpha, _vr;
+
+        double inversion();
+        double ptrs();
     public:
         static const unsigned long CUTOFF;
-        PoissonVar(double l, RandomGen *g = NULL) : 
-            UniformVar(0, 1, g), _lambda(l) {}
+        static const double SMALL;
+
+        PoissonVar(double l, RandomGen *g = NULL);
         virtual double get();
+        virtual void fill(double *out, size_t n);
+
+        void setMethod(Method k) { _method = k; }
+        Method getMethod() const { return _method; }
 
         static RandomVar *createInstance(vector<string> &par);
         virtual double getMaximum() throw(MaxException)
@@ -287,20 +458,71 @@ namespace MetaSim {
        call of get() returns one of the numbers in the sequence.  When
        the last number in the sequence has been read, the sequence
        starts over.
+
+       A file can be read in three ways (see Mode):
+       - LOAD: a text file, with the numbers separated by blanks, is
+         parsed and kept in memory;
+       - MAP: a binary file of doubles in little endian order (see
+         writeBinary()) is mapped in memory, so that the values are
+         read from the disk only when they are used, and the pages
+         already used can be dropped by the system: the trace can
+         be larger than the memory;
+       - STREAM: a text file is read and parsed a block at a time,
+         while the values are used. The copies of the variable
+         share the position in the file.
+
+       The minimum and the maximum are computed the first time they
+       are requested (for STREAM, with a pass on the whole file).
     */
     class DetVar : public RandomVar {
-        vector<double> _array;
-        unsigned int _count;
     public:
-        DetVar(const std::string &filename);
+        /// How a trace file is read
+        enum Mode { LOAD, MAP, STREAM };
+
+        DetVar(const std::string &filename, Mode m = LOAD);
         DetVar(vector<double> &a);
         DetVar(double a[], int s);
+        DetVar(const DetVar &d);
         virtual double get();
+        virtual void fill(double *out, size_t n);
         virtual ~DetVar(){}
         virtual double getMaximum() throw(MaxException);
         virtual double getMinimum() throw(MaxException);
 
+        /// The number of values, or 0 in STREAM mode
+        size_t size() const { return _size; }
+
+        /// Writes n values in a binary trace, for the MAP mode
+        static void writeBinary(const std::string &filename,
+                                const double *v, size_t n);
+
+        /**
+           Creates a variable from the parameters: the name of the
+           file and, optionally, the mode ("load", "map" or
+           "stream").
+        */
         static RandomVar *createInstance(vector<string> &par);
+
+    private:
+        struct Mapping;
+        struct TextReader;
+
+        vector<double> _array;
+        std::shared_ptr<Mapping> _map;
+        std::shared_ptr<TextReader> _stream;
+        std::string _filename;
+
+        // the values: in _array, or in the mapped file
+        const double *_data;
+        size_t _size;
+        size_t _count;
+
+        bool _hasRange;
+        double _min, _max;
+
+        DetVar &operator=(const DetVar &);
+
+        void computeRange();
     };
     //@}
 
@@ -87,6 +87,11 @@ namespace MetaSim {
                                  GenericVar,
                                  RandomVar::BASE_KEY_TYPE>
         registerGeneric(GenericName);
+
+        static registerInFactory<RandomVar,
+                                 EmpiricalVar,
+                                 RandomVar::BASE_KEY_TYPE>
+        registerEmpirical(EmpiricalName);
     } // namespace __var_stub
 
     RandomVar *parsevar(const std::string &str)
@@ -43,6 +43,7 @@ namespace MetaSim {
     const RandomVar::BASE_KEY_TYPE PoissonName ("poisson");
     const RandomVar::BASE_KEY_TYPE DetName ("trace");
     const RandomVar::BASE_KEY_TYPE GenericName ("PDF");
+    const RandomVar::BASE_KEY_TYPE EmpiricalName ("empirical");
   
     RandomVar* parsevar(const std::string &str);
 
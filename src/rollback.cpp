@@ -0,0 +1,91 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <event.hpp>
+#include <rollback.hpp>
+#include <simcontext.hpp>
+
+namespace MetaSim {
+
+    thread_local UndoLog *UndoLog::_active = NULL;
+
+    UndoLog::EventRecord::EventRecord(Event *e) :
+        _evt(e),
+        _ctx(e->_ctx),
+        _time(e->_time),
+        _lastTime(e->_lastTime),
+        _priority(e->_priority),
+        _order(e->_order),
+        _isInQueue(e->_isInQueue),
+        _disposable(e->_disposable)
+    {
+    }
+
+    void UndoLog::EventRecord::undo()
+    {
+        Event *e = _evt;
+        bool fresh = (_ctx == NULL && !_isInQueue &&
+                      e->_isInQueue && e->_disposable);
+
+        if (e->_isInQueue) e->_ctx->_eventQueue->erase(e);
+
+        // a disposable event posted for the first time by the
+        // undone event: nobody else refers to it
+        if (fresh) {
+            e->_isInQueue = false;
+            e->dispose();
+            return;
+        }
+
+        e->_ctx = _ctx;
+        e->_time = _time;
+        e->_lastTime = _lastTime;
+        e->_priority = _priority;
+        e->_order = _order;
+        e->_isInQueue = _isInQueue;
+        e->_disposable = _disposable;
+        if (_isInQueue) _ctx->_eventQueue->insert(e);
+    }
+
+    UndoLog::~UndoLog()
+    {
+        commit(mark());
+    }
+
+    UndoLog *UndoLog::activate(UndoLog *l)
+    {
+        UndoLog *old = _active;
+        _active = l;
+        return old;
+    }
+
+    void UndoLog::undo(size_t m)
+    {
+        while (mark() > m) {
+            Record *r = _records.back();
+            _records.pop_back();
+            r->undo();
+            delete r;
+        }
+    }
+
+    void UndoLog::commit(size_t m)
+    {
+        while (_base < m && !_records.empty()) {
+            delete _records.front();
+            _records.pop_front();
+            _base++;
+        }
+    }
+
+} // namespace MetaSim
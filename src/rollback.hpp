@@ -0,0 +1,181 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __ROLLBACK_HPP__
+#define __ROLLBACK_HPP__
+
+#include <cstddef>
+#include <deque>
+
+#include <tick.hpp>
+
+namespace MetaSim {
+
+    class Event;
+    class SimulationContext;
+
+    /**
+       \ingroup metasim_ee
+
+       The log used by the Time Warp engine (see
+       TimeWarpSimulation) to undo the effects of the events
+       executed speculatively. While an event is executed, every
+       change to the event queue (post(), drop(), reschedule(),
+       process()) and every change to a Rollback variable is
+       recorded in the log of the calling thread, together with
+       the information needed to undo it.
+
+       Outside of the Time Warp engine there is no active log, and
+       the cost of the recording is a single test.
+    */
+    class UndoLog {
+    public:
+        /// A change that can be undone
+        class Record {
+        public:
+            virtual ~Record() {}
+            virtual void undo() = 0;
+        };
+
+    private:
+        static thread_local UndoLog *_active;
+
+        // the saved state of an event
+        class EventRecord : public Record {
+            Event *_evt;
+            SimulationContext *_ctx;
+            Tick _time;
+            Tick _lastTime;
+            int _priority;
+            unsigned long _order;
+            bool _isInQueue;
+            bool _disposable;
+        public:
+            EventRecord(Event *e);
+            virtual void undo();
+        };
+
+        std::deque<Record *> _records;
+        size_t _base;
+        unsigned long _epoch;
+
+        UndoLog(const UndoLog &);
+        UndoLog &operator=(const UndoLog &);
+
+    public:
+        UndoLog() : _records(), _base(0), _epoch(0) {}
+        ~UndoLog();
+
+        /// The log active in the calling thread, or NULL
+        static inline UndoLog *active() { return _active; }
+
+        /// Makes this log active in the calling thread (or none,
+        /// if l is NULL); returns the previous one
+        static UndoLog *activate(UndoLog *l);
+
+        /// Adds a record to the log, which takes its ownership
+        void push(Record *r) { _records.push_back(r); }
+
+        /// Records the current state of an event
+        void saveEvent(Event *e) { push(new EventRecord(e)); }
+
+        /**
+           Starts a new epoch (i.e., the execution of a new
+           event). Rollback variables save their value only the
+           first time they are modified in every epoch.
+        */
+        void newEpoch() { _epoch++; }
+        unsigned long epoch() const { return _epoch; }
+
+        /// The position of the next record
+        size_t mark() const { return _base + _records.size(); }
+
+        /// Undoes, from the last one, the records from position m
+        void undo(size_t m);
+
+        /// Discards, without undoing them, the records before
+        /// position m
+        void commit(size_t m);
+    };
+
+    /**
+       \ingroup metasim_ee
+
+       A variable of type T whose value is restored when the Time
+       Warp engine rolls back the events that modified it.
+
+       The variable can be read freely; it must be modified only
+       through write() or the assignment operator. The first time
+       it is modified by an event, a copy of the old value is
+       saved in the UndoLog: hence, small variables (one Rollback
+       per field) give incremental state saving, while a single
+       Rollback around a structure gives copy state saving.
+
+       @code
+       class Node : public Entity {
+           Rollback<int> _count;
+           Rollback<RandomGen> _gen;
+           ...
+           void onArrival(Event *) {
+               _count = _count + 1;
+               long r = _gen.write().sample();
+           }
+       };
+       @endcode
+
+       Outside of the Time Warp engine, a Rollback behaves like a
+       plain variable.
+    */
+    template<class T>
+    class Rollback {
+        T _val;
+        unsigned long _epoch;
+
+        class ValueRecord : public UndoLog::Record {
+            Rollback *_var;
+            T _old;
+            unsigned long _epoch;
+        public:
+            ValueRecord(Rollback *v) :
+                _var(v), _old(v->_val), _epoch(v->_epoch) {}
+            virtual void undo() {
+                _var->_val = _old;
+                _var->_epoch = _epoch;
+            }
+        };
+
+    public:
+        Rollback() : _val(), _epoch(0) {}
+        Rollback(const T &v) : _val(v), _epoch(0) {}
+
+        const T &get() const { return _val; }
+        operator const T &() const { return _val; }
+
+        /// Returns a reference for modifying the value
+        T &write() {
+            UndoLog *l = UndoLog::active();
+            if (l != NULL && _epoch != l->epoch()) {
+                l->push(new ValueRecord(this));
+                _epoch = l->epoch();
+            }
+            return _val;
+        }
+
+        Rollback &operator=(const T &v) { write() = v; return *this; }
+        Rollback &operator=(const Rollback &r)
+            { write() = r._val; return *this; }
+    };
+
+} // namespace MetaSim
+
+#endif // __ROLLBACK_HPP__
@@ -0,0 +1,76 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <randomvar.hpp>
+#include <simcontext.hpp>
+#include <simul.hpp>
+
+namespace MetaSim {
+
+    thread_local SimulationContext *SimulationContext::_current = NULL;
+
+    SimulationContext::SimulationContext(EventQueue::Type q) :
+        _eventQueue(EventQueue::create(q)),
+        _eventCounter(0),
+        _eventPool(),
+        _batch(),
+        _entityMap(),
+        _entityIndex(),
+        _entityCount(0),
+        _statList(),
+        _statTotalExp(0),
+        _statExpNum(0),
+        _statEndOfSim(false),
+        _statInitFlag(false),
+        _statTransitory(0),
+        globTime(0),
+        _randomGen(NULL)
+    {
+    }
+
+    SimulationContext::~SimulationContext()
+    {
+        delete _eventQueue;
+        if (_current == this) _current = NULL;
+    }
+
+    SimulationContext &SimulationContext::createDefault()
+    {
+        // like the old singleton, the default simulation is
+        // never destroyed: static objects of the model could
+        // still refer to it at exit
+        _current = new Simulation();
+        return *_current;
+    }
+
+    SimulationContext *SimulationContext::makeCurrent()
+    {
+        SimulationContext *old = _current;
+        _current = this;
+        return old;
+    }
+
+    SimulationContext::Scope::Scope(SimulationContext &c) :
+        _old(c.makeCurrent()), _oldGen(NULL)
+    {
+        if (c._randomGen != NULL) 
+            _oldGen = RandomVar::changeGenerator(c._randomGen);
+    }
+
+    SimulationContext::Scope::~Scope()
+    {
+        if (_oldGen != NULL) RandomVar::changeGenerator(_oldGen);
+        _current = _old;
+    }
+
+} // namespace MetaSim
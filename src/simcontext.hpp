@@ -0,0 +1,164 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __SIMCONTEXT_HPP__
+#define __SIMCONTEXT_HPP__
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <basetype.hpp>
+#include <eventqueue.hpp>
+#include <mempool.hpp>
+
+namespace MetaSim {
+
+    class BaseStat;
+    class Entity;
+    class Event;
+    class RandomGen;
+    class Simulation;
+    class TimeWarpLP;
+    class UndoLog;
+
+    /**
+       \ingroup metasim_ee
+
+       The state of one simulation: the event queue, the registry
+       of the entities, the registry of the statistical objects and
+       the simulation clock. In the original design all these were
+       static members of Event, Entity, BaseStat and Simulation;
+       now every Simulation object (which derives from this class)
+       has its own copy, so that several independent simulations
+       can live in the same process, for example one per thread.
+
+       Every thread has a <i>current</i> context: entities,
+       events and statistical objects register themselves in the
+       context which is current when they are created, and the
+       SIMUL macro refers to the current context. If no context
+       has been made current, a default Simulation object is
+       created the first time it is needed, so that programs
+       written for the old singleton keep working unchanged.
+
+       @code
+       Simulation sim;
+       SimulationContext::Scope scope(sim); // sim is now current
+       // build the model, run it with SIMUL.run(...) or sim.run(...)
+       @endcode
+
+       A context can have its own random generator (the logical
+       processes of the parallel engines do): while the context is
+       made current by a Scope, it is also the default generator of
+       the RandomVar objects of the thread (see
+       RandomVar::changeGenerator()), both when the model is built
+       and when it is executed.
+
+       The objects of a model must be destroyed before the
+       Simulation they belong to.
+    */
+    class SimulationContext {
+        friend class BaseStat;
+        friend class Entity;
+        friend class Event;
+        friend class Simulation;
+        friend class TimeWarpLP;
+        friend class UndoLog;
+
+        static thread_local SimulationContext *_current;
+
+        /// Creates the default Simulation of this thread
+        static SimulationContext &createDefault();
+
+        // Event: the queue, the counter for fifo insertion, the
+        // memory of the pooled events, and the batch of
+        // simultaneous events being dispatched
+        EventQueue *_eventQueue;
+        unsigned long _eventCounter;
+        MemoryPool _eventPool;
+        std::vector<Event *> _batch;
+
+        // Entity: pairs <ID, entity>, pairs <name, entity>, and
+        // the counter for assigning unique IDs
+        std::map<int, Entity *> _entityMap;
+        std::map<std::string, Entity *> _entityIndex;
+        int _entityCount;
+
+        // BaseStat: the statistical objects and the state of the
+        // experiments
+        std::list<BaseStat *> _statList;
+        size_t _statTotalExp;
+        size_t _statExpNum;
+        bool _statEndOfSim;
+        bool _statInitFlag;
+        Tick _statTransitory;
+
+        SimulationContext(const SimulationContext &);
+        SimulationContext &operator=(const SimulationContext &);
+
+    protected:
+        /// Current simulation time
+        Tick globTime;
+
+        /// The default generator while the context is current
+        /// in a Scope (NULL: the generator is not changed)
+        RandomGen *_randomGen;
+
+        SimulationContext(EventQueue::Type q);
+
+    public:
+        virtual ~SimulationContext();
+
+        /**
+           Returns the context which is current in the calling
+           thread (creating the default one if needed).
+        */
+        static inline SimulationContext &current()
+            {
+                if (_current != NULL) return *_current;
+                return createDefault();
+            }
+
+        /**
+           Makes this context the current one for the calling
+           thread, and returns the previous one (possibly NULL).
+        */
+        SimulationContext *makeCurrent();
+
+        /// True if this context is the current one in this thread
+        bool isCurrent() const { return _current == this; }
+
+        /// The pool of the events created with Event::create()
+        const MemoryPool &getEventPool() const { return _eventPool; }
+
+        /// The event queue of this context
+        const EventQueue &getEventQueue() const { return *_eventQueue; }
+
+        /**
+           Makes a context current for the lifetime of the Scope
+           object, restoring the previous one on exit.
+        */
+        class Scope {
+            SimulationContext *_old;
+            RandomGen *_oldGen;
+            Scope(const Scope &);
+        public:
+            Scope(SimulationContext &c);
+            ~Scope();
+        };
+    };
+
+} // namespace MetaSim
+
+#endif // __SIMCONTEXT_HPP__
@@ -11,33 +11,38 @@
  *   (at your option) any later version.                                   *
  *                                                                         *
  ***************************************************************************/
+#include <algorithm>
+#include <atomic>
 #include <deque>
-
+#include <exception>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <thread>
+#include <vector>
 
 #include <entity.hpp>
+#include <randomvar.hpp>
 #include <simul.hpp>
 
 namespace MetaSim {
     using namespace std;
 
-    Simulation *Simulation::instance_ = 0;
-        
     class NoMoreEventsInQueue {};
 
 
-    Simulation::Simulation() : dbg(), numRuns(0), 
-                               actRuns(0),
-                               globTime (0),
-                               end (false)
+    Simulation::Simulation(EventQueue::Type q) : 
+        SimulationContext(q),
+        dbg(), numRuns(0), 
+        actRuns(0),
+        end (false),
+        batchDispatch(false)
     {
     }
 
-    Simulation& Simulation::getInstance()
+    Simulation::~Simulation()
     {
-        if (instance_ == 0) instance_ = new Simulation();
-                
-        return *instance_;
+        clearEventQueue();
     }
         
         
@@ -56,14 +61,14 @@ namespace MetaSim {
     // It returns the tick after the simulation step has been completed
     const Tick Simulation::sim_step() 
     {
+        Scope scope(*this);
         Event *temp;
         Tick mytime;
 
         DBGENTER(_SIMUL_DBG_LEV);
 
-        temp = Event::getFirst();   // takes the first event in the queue ...
+        temp = Event::extractFirst(); // extracts the first event in the queue
         if (temp == NULL) throw NoMoreEventsInQueue();
-        temp->drop();               // ... and extract it!
           
         mytime = temp->getTime();   // stores the current time 
           
@@ -77,19 +82,98 @@ namespace MetaSim {
           
         temp->action();               // do what it is supposed to do...
         if (temp->isDisposable())     // if it has to be deleted...
-            delete temp;                // delete it!
+            temp->dispose();            // delete it!
           
         return mytime;
     }
+
+    const Tick Simulation::sim_batch()
+    {
+        Scope scope(*this);
+        DBGENTER(_SIMUL_DBG_LEV);
+
+        Event::extractBatch();
+        if (_batch.empty()) throw NoMoreEventsInQueue();
+
+        Tick mytime = _batch[0]->getTime();
+        DBGPRINT_4("Executing a batch of ", _batch.size(), 
+                   " events at time ", mytime);
+        setTime(mytime);
+
+        size_t i = 0;
+        try {
+            for (; i < _batch.size(); ++i) {
+                Event *e = _batch[i];
+                if (e == NULL) continue;  // dropped or rescheduled
+
+                // events posted by the previous handlers with a
+                // higher priority come first
+                Event *f;
+                while ((f = Event::getFirst()) != NULL && Event::Cmp()(f, e)) {
+                    Event::extractFirst();
+                    f->action();
+                    if (f->isDisposable()) f->dispose();
+                }
+
+                e->leaveBatch();
+                e->_isInQueue = false;
+                e->action();
+                if (e->isDisposable()) e->dispose();
+            }
+        } catch (...) {
+            // the events not yet dispatched go back in the queue,
+            // with their original key
+            for (; i < _batch.size(); ++i) {
+                Event *e = _batch[i];
+                if (e == NULL) continue;
+                e->leaveBatch();
+                _eventQueue->insert(e);
+            }
+            _batch.clear();
+            throw;
+        }
+        _batch.clear();
+
+        return mytime;
+    }
         
     // this event returns the time of the first event in the queue
     // (i.e. the next event to be processed) or throws and exception 
     // if there is no more events in the queue
     const Tick Simulation::getNextEventTime()
     {
-        Event *temp = Event::getFirst();
+        Event *temp = _eventQueue->front();
         if (temp == NULL) throw NoMoreEventsInQueue();
-        else return Event::getFirst()->getTime();
+        else return temp->getTime();
+    }
+
+    void Simulation::postMessage(Event *e, Tick t, bool disp, 
+                                 unsigned long order)
+    {
+        e->postOrdered(t, disp, order);
+    }
+
+    unsigned long Simulation::getOrder(const Event *e)
+    {
+        return e->_order;
+    }
+
+    // The local events are numbered from 0, the messages from 2^63
+    // on: the top bit, 8 bits of depth, 15 bits of source and 40
+    // bits of sequence number
+    static_assert(sizeof(unsigned long) >= 8, "64 bit orders are needed");
+
+    unsigned long Simulation::messageOrder(int src, unsigned long seq,
+                                           unsigned depth)
+    {
+        return (1UL << 63) | (static_cast<unsigned long>(depth) << 55) |
+            (static_cast<unsigned long>(src) << 40) | (seq & ((1UL << 40) - 1));
+    }
+
+    unsigned Simulation::messageDepth(unsigned long order)
+    {
+        if ((order >> 63) == 0) return 0;
+        return (order >> 55) & MAX_MESSAGE_DEPTH;
     }
 
     // this function will run until a specified time, 
@@ -99,9 +183,10 @@ namespace MetaSim {
     // it stops before executing the first event after stop
     const Tick Simulation::run_to(const Tick &stop)
     {
+        Scope scope(*this);
         try {
             while (getNextEventTime() <= stop) {
-                globTime = sim_step();
+                globTime = batchDispatch ? sim_batch() : sim_step();
             }
         } catch (NoMoreEventsInQueue &e) {
             cerr << "No more events in queue: simulation time = " 
@@ -116,6 +201,7 @@ namespace MetaSim {
                 
     void Simulation::initRuns(int nRuns)
     {
+        Scope scope(*this);
         BaseStat::init(nRuns);
         globTime = 0;
         end = false;          
@@ -123,6 +209,7 @@ namespace MetaSim {
 
     void Simulation::initSingleRun()
     {
+        Scope scope(*this);
         globTime = 0;
 
         // Run Initialization:
@@ -135,6 +222,7 @@ namespace MetaSim {
 
     void Simulation::endSingleRun()
     {
+        Scope scope(*this);
         Entity::callEndRun();
         BaseStat::endRun();
 
@@ -146,6 +234,7 @@ namespace MetaSim {
     // This is the simulation engine
     void Simulation::run(Tick endTick, int nRuns) 
     {
+        Scope scope(*this);
         DBGENTER(_SIMUL_DBG_LEV);
 	bool initializeRuns = true;
 	bool terminateSim = true;
@@ -193,34 +282,201 @@ namespace MetaSim {
         while (actRuns < numRuns) {
             cout << "\n Run #" << actRuns << endl;
 
-            initSingleRun();
+            singleRun(endTick);
+                                
+            actRuns++;   // next run....
+        }
+        end = true;
+        if (terminateSim) endSim();      // the simulation is over!!
+    }
 
-            // MAIN CYCLE!!
-            try {
-                while (globTime < endTick) {
+    void Simulation::singleRun(Tick endTick)
+    {
+        initSingleRun();
+
+        // MAIN CYCLE!!
+        try {
+            // the last step, at or after endTick, executes only
+            // one event, as sim_step() does
+            while (globTime < endTick) {
+                if (batchDispatch && getNextEventTime() < endTick)
+                    globTime = sim_batch();
+                else
                     globTime = sim_step();
+            }
+        } catch (NoMoreEventsInQueue &e) {
+            cerr << "No more events in queue: simulation time =" 
+                 << globTime << endl;
+        }
+
+        endSingleRun();
+    }
+
+    int Simulation::numThreads(int nThreads)
+    {
+        if (nThreads <= 0) nThreads = thread::hardware_concurrency();
+        if (nThreads <= 0) nThreads = 1;
+        return nThreads;
+    }
+
+    void Simulation::runReplicas(Tick endTick, int nRuns, int nThreads,
+                                 const ModelFactory &factory,
+                                 vector< vector<double> > &results)
+    {
+        if (nThreads > nRuns) nThreads = nRuns;
+
+        // one generator per replica, split from the generator of
+        // this thread; the workers copy their state
+        vector< unique_ptr<RandomGen> > gens(nRuns);
+        for (int r = 0; r < nRuns; ++r) 
+            gens[r].reset(RandomVar::getGenerator()->splitLong());
+
+        size_t first = results.size();
+        results.resize(first + nRuns);
+        atomic<int> next(0);
+        exception_ptr error;
+        mutex errorMutex;
+
+        auto worker = [&] () {
+            try {
+                Simulation sim;
+                Scope scope(sim);
+                unique_ptr<RandomGen> gen(gens[0]->clone());
+                RandomGen *old = RandomVar::changeGenerator(gen.get());
+                try {
+                    shared_ptr<void> model = factory();
+                    sim.initRuns(1);
+                    int r;
+                    while ((r = next++) < nRuns) {
+                        vector<uint64_t> state;
+                        gens[r]->getState(state);
+                        const uint64_t *p = &state[0];
+                        gen->setState(p);
+                        sim.singleRun(endTick);
+                        BaseStat::getLastValues(results[first + r]);
+                    }
+                } catch (...) {
+                    RandomVar::changeGenerator(old);
+                    throw;
                 }
-            } catch (NoMoreEventsInQueue &e) {
-                cerr << "No more events in queue: simulation time =" 
-                     << globTime << endl;
+                RandomVar::changeGenerator(old);
+            } catch (...) {
+                next = nRuns;   // stops the other workers
+                lock_guard<mutex> lock(errorMutex);
+                if (!error) error = current_exception();
             }
+        };
 
-            endSingleRun();
-                                
-            actRuns++;   // next run....
+        vector<thread> workers;
+        for (int i = 0; i < nThreads; ++i) workers.push_back(thread(worker));
+        for (int i = 0; i < nThreads; ++i) workers[i].join();
+        if (error) rethrow_exception(error);
+    }
+
+    void Simulation::run_parallel(Tick endTick, int nRuns, int nThreads,
+                                  const ModelFactory &factory)
+    {
+        if (nRuns < 1) return;
+
+        vector< vector<double> > results;
+        runReplicas(endTick, nRuns, numThreads(nThreads), factory, results);
+
+        Scope scope(*this);
+        numRuns = nRuns;
+        actRuns = nRuns;
+        BaseStat::setExperiments(results);
+        end = true;
+    }
+
+    // true if all the stats in the list (or all the stats of the
+    // current context, if the list is empty) have the precision
+    static bool precisionReached(const BaseStat::List &stats, 
+                                 double relWidth,
+                                 BaseStat::CONFIDENCE_INTERVAL c)
+    {
+        BaseStat::iterator i = stats.begin(), e = stats.end();
+        if (stats.empty()) {
+            i = BaseStat::begin();
+            e = BaseStat::end();
+        }
+        for (; i != e; ++i) 
+            if (!(*i)->hasPrecision(relWidth, c)) return false;
+        return true;
+    }
+
+    size_t Simulation::run_to_precision(Tick endTick, double relWidth,
+                                        const BaseStat::List &stats,
+                                        BaseStat::CONFIDENCE_INTERVAL c,
+                                        size_t minRuns, size_t maxRuns)
+    {
+        Scope scope(*this);
+        if (minRuns < 3) minRuns = 3;
+        if (maxRuns < minRuns) maxRuns = minRuns;
+
+        initRuns(maxRuns);
+        numRuns = maxRuns;
+        actRuns = 0;
+        while (actRuns < numRuns) {
+            singleRun(endTick);
+            actRuns++;
+            if (actRuns >= minRuns) {
+                BaseStat::endSim();
+                if (precisionReached(stats, relWidth, c)) break;
+            }
         }
         end = true;
-        if (terminateSim) endSim();      // the simulation is over!!
+        endSim();
+        return actRuns;
+    }
+
+    size_t Simulation::run_parallel_to_precision(Tick endTick, 
+                                                 double relWidth,
+                                                 int nThreads,
+                                                 const ModelFactory &factory,
+                                                 const BaseStat::List &stats,
+                                                 BaseStat::CONFIDENCE_INTERVAL c,
+                                                 size_t minRuns, 
+                                                 size_t maxRuns)
+    {
+        if (minRuns < 3) minRuns = 3;
+        if (maxRuns < minRuns) maxRuns = minRuns;
+        nThreads = numThreads(nThreads);
+
+        vector< vector<double> > results;
+        size_t batch = minRuns;
+        while (true) {
+            runReplicas(endTick, batch, nThreads, factory, results);
+
+            Scope scope(*this);
+            BaseStat::setExperiments(results);
+            if (results.size() >= maxRuns || 
+                precisionReached(stats, relWidth, c)) break;
+
+            // then one replica per thread, at least
+            batch = min(max(size_t(nThreads), batch), 
+                        maxRuns - results.size());
+        }
+        numRuns = actRuns = results.size();
+        end = true;
+        return results.size();
     }
 
+    void Simulation::setEventQueue(EventQueue::Type t)
+    {
+        if (!_eventQueue->empty())
+            throw EventQueue::Exc("Cannot change a non-empty event queue");
+        EventQueue *q = EventQueue::create(t);
+        delete _eventQueue;
+        _eventQueue = q;
+    }
 
     void Simulation::clearEventQueue()
     {
+        Scope scope(*this);
         Event *temp;
-        while ((temp = Event::getFirst()) != NULL) {
-            temp->drop();
+        while ((temp = Event::extractFirst()) != NULL) {
             if (temp->isDisposable()) // if it has to be deleted...
-                delete temp;                 
+                temp->dispose();
         }
         globTime = 0;
     }
@@ -228,6 +484,8 @@ namespace MetaSim {
     // only for debug
     void Simulation::print()
     {
+        Scope scope(*this);
+        if (!dbg.filter()) return;
         DBGPRINT_3("Actual time = [",globTime,"]");
         DBGPRINT("---------- Begin Event Queue ----------");
         Event::printQueue();  
@@ -244,6 +502,20 @@ namespace MetaSim {
         //dbg.enter(lev, h);
         dbg.enter(lev, ss.str());
     }
+
+    void Simulation::dbgEnter(int lev, const char *header)
+    {
+        dbg.enter(lev);
+        if (dbg.filter()) dbgHeader(header);
+    }
+
+    void Simulation::dbgHeader(const string &header)
+    {
+        if (!dbg.filter()) return;
+        stringstream ss;
+        ss << "t = [" << globTime << "] --> " << header;
+        dbg.header(ss.str());
+    }
                 
     void Simulation::dbgExit()
     {
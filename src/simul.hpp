@@ -14,10 +14,15 @@
 #ifndef __SIMUL_HPP__
 #define __SIMUL_HPP__
 
+#include <functional>
+#include <memory>
+
 #include <basestat.hpp>
 #include <debugstream.hpp>
 #include <entity.hpp>
 #include <event.hpp>
+#include <eventqueue.hpp>
+#include <simcontext.hpp>
 
 namespace MetaSim {
 
@@ -26,7 +31,7 @@ namespace MetaSim {
   /**
         \ingroup metasim_ee
 
-        This singleton implements the simulation engine and some
+        This class implements the simulation engine and some
         debugging facilities. The main function is <i>run(Tick
         lenght, size_t runs)</i> that is responsible for running
         the simulation for one or more times.
@@ -34,16 +39,45 @@ namespace MetaSim {
         The <i>getTime()</i> returns the current globalTime in the
         simulation; the dbg object is used for debugging output.
 
+        Every Simulation object is an independent simulation
+        context (see SimulationContext), with its own event queue,
+        entities and statistics. The SIMUL macro refers to the
+        current simulation of the calling thread: unless another
+        one has been made current, this is a default Simulation
+        object created on demand, so that a program that uses a
+        single simulation does not need to create it explicitly.
+
         @author Giuseppe Lipari, Gerardo Lamastra
     */
   //@{
-  class Simulation {
-    Simulation();
+  class Simulation : public SimulationContext {
     Simulation(const Simulation &);
+    Simulation &operator=(const Simulation &);
 
-    static Simulation *instance_;
   public:
-    static Simulation &getInstance();
+    /**
+           Creates a new simulation, with an event queue of type
+           q. The new simulation is not made current: use
+           makeCurrent() or a SimulationContext::Scope before
+           creating the objects of the model.
+        */
+    Simulation(EventQueue::Type q = EventQueue::DEFAULT);
+
+    /**
+           Destroys the simulation, deleting the disposable
+           events still in the queue. All the entities, events
+           and statistics of the model must have been destroyed
+           before.
+        */
+    virtual ~Simulation();
+
+    /**
+           Returns the current simulation of the calling thread.
+        */
+    static inline Simulation &getInstance() 
+        {
+            return static_cast<Simulation &>(SimulationContext::current());
+        }
 
     /**
            Enters the <i>lev</i> debug level.
@@ -65,6 +99,19 @@ namespace MetaSim {
         */
     void dbgEnter(std::string lev, std::string header);
 
+    /**
+           Same as above, with the ID of the level (see
+           DebugStream::level()): the header is formatted only if
+           the output of the level is enabled.
+        */
+    void dbgEnter(int lev, const char *header);
+
+    /**
+           Outputs the current simulation time followed by
+           <i>header</i>, if the output of the current level is
+           enabled, and increases the indentation.
+        */
+    void dbgHeader(const std::string &header);
 
     /**
            Exits from the current debug level.
@@ -105,11 +152,123 @@ namespace MetaSim {
         */
     void run(Tick length, int runs = 1);
 
+    /**
+           A function that builds one instance of the model in
+           the current simulation, and returns an object that owns
+           it (all its entities, events, statistics and random
+           variables): the instance is destroyed when the last
+           copy of the pointer goes away.
+        */
+    typedef std::function<std::shared_ptr<void> ()> ModelFactory;
+
+    /**
+           Runs <i>runs</i> independent replicas of the model on
+           <i>threads</i> concurrent threads (if threads <= 0, one
+           per available core).
+
+           Every worker thread creates its own Simulation, makes it
+           current and calls <i>factory</i> to build its own
+           instance of the model, which is then used for all the
+           replicas executed by that worker. Before each replica,
+           the standard random generator of the worker is set to a
+           state reserved to that replica; the states are obtained
+           in advance with RandomGen::splitLong() from the standard
+           generator of the calling thread (so, with the generators
+           of randomgen.hpp, the replicas use non-overlapping
+           sequences), and the results do not depend on the number
+           of threads, nor on how the replicas are distributed
+           among them.
+
+           At the end, the values collected in every replica are
+           copied into the statistical objects of this simulation,
+           which are matched to those of the workers by their order
+           of creation: hence, this simulation must contain the same
+           statistics as the model built by the factory (the
+           simplest way is to call the factory in this simulation
+           too). Then getMean(), getConfInterval(), etc. can be
+           used as after run().
+
+           @code
+           Simulation::ModelFactory f = [] () { 
+               return std::make_shared<MyModel>(); 
+           };
+           std::shared_ptr<void> m = f();          // model of SIMUL
+           SIMUL.run_parallel(10000, 100, 0, f);
+           @endcode
+
+           An exception raised by a worker stops all the other
+           workers, and is propagated to the caller.
+
+           @param length Length of each simulation run.
+           @param runs Number of replicas.
+           @param threads Number of worker threads.
+           @param factory Builds an instance of the model.
+        */
+    void run_parallel(Tick length, int runs, int threads, 
+                      const ModelFactory &factory);
+
+    /**
+           Runs replicas of the simulation until the confidence
+           interval of every statistical object in <i>stats</i>
+           (of all the statistical objects, if the list is empty)
+           is narrow enough: the half-width must not exceed
+           <i>relWidth</i> times the mean (see
+           BaseStat::hasPrecision()). At least <i>minRuns</i>
+           (never less than 3) and at most <i>maxRuns</i> replicas
+           are executed. At the end, the statistics can be read
+           as after run().
+
+           @code
+           // stop when the mean response time is known within 2%
+           BaseStat::List l;
+           l.push_back(&respTime);
+           size_t n = SIMUL.run_to_precision(100000, 0.02, l);
+           @endcode
+
+           @return the number of replicas executed.
+        */
+    size_t run_to_precision(Tick length, double relWidth,
+                            const BaseStat::List &stats = BaseStat::List(),
+                            BaseStat::CONFIDENCE_INTERVAL c = BaseStat::C95,
+                            size_t minRuns = 5, size_t maxRuns = 1000);
+
+    /**
+           Same as run_to_precision(), but the replicas are executed
+           in batches on <i>threads</i> concurrent threads, as in
+           run_parallel(): the first batch has <i>minRuns</i>
+           replicas, the following ones as many as the threads.
+           The precision is checked after every batch, so a few
+           more replicas than strictly needed may be executed.
+           The statistics in <i>stats</i> are those of this
+           simulation.
+        */
+    size_t run_parallel_to_precision(Tick length, double relWidth,
+                                     int threads, 
+                                     const ModelFactory &factory,
+                                     const BaseStat::List &stats = BaseStat::List(),
+                                     BaseStat::CONFIDENCE_INTERVAL c = BaseStat::C95,
+                                     size_t minRuns = 5, size_t maxRuns = 1000);
+
     /**
            Returns the current simulation time.
+
+           The functions that run the simulation (run(), run_to(),
+           sim_step(), etc.) make this simulation current while
+           they execute, so they can be safely invoked on a
+           Simulation object which is not the current one.
         */
     const Tick getTime();
 
+    /**
+           Selects the implementation of the event queue (see
+           EventQueue::Type). All implementations produce the
+           same sequence of events; they only differ in
+           performance. It must be called when the queue is
+           empty, i.e. before posting any event, otherwise an
+           exception is raised.
+        */
+    void setEventQueue(EventQueue::Type t);
+
     /**
            Drops and eventually deletes all events in the queue. To be
            called after an exception!
@@ -130,6 +289,40 @@ namespace MetaSim {
         */
     const Tick sim_step();
 
+    /**
+           Performs one simulation step in batch mode: extracts
+           from the queue the first event together with all the
+           following ones with the same time and priority, sets
+           the time once and dispatches them in their (FIFO)
+           order. It returns the time of the batch.
+
+           The result is the same as calling sim_step() once per
+           event: while the batch is dispatched, its events are
+           still considered in the queue, so that a handler can
+           drop() or reschedule() them, and an event posted by a
+           handler at the same time is dispatched before the rest
+           of the batch if it has a higher priority, after it
+           otherwise. Only getFirst() and getNextEventTime() do
+           not see the events of the batch. If a handler raises an
+           exception, the events not yet dispatched are put back
+           in the queue.
+
+           It pays off when many events share the same time and
+           priority; see setBatchDispatch().
+        */
+    const Tick sim_batch();
+
+    /**
+           Selects the main loop of run(), run_to() and
+           run_to_precision(): with batch dispatch, the simultaneous
+           events are extracted and dispatched together by
+           sim_batch(), otherwise one at a time by sim_step().
+           Disabled by default.
+        */
+    void setBatchDispatch(bool b) { batchDispatch = b; }
+
+    bool getBatchDispatch() const { return batchDispatch; }
+
 
     /**
            Function to help testing and debugging.
@@ -186,6 +379,43 @@ namespace MetaSim {
     DebugStream dbg;
 
     const Tick getNextEventTime();
+
+    /// The maximum number of logical processes of the parallel
+    /// engines, and the maximum depth of a message (see
+    /// messageOrder())
+    static const int MAX_MESSAGE_SOURCES = 1 << 15;
+    static const unsigned MAX_MESSAGE_DEPTH = 255;
+
+  protected:
+    /**
+           Posts e, a message received by a logical process of the
+           parallel engines, with the insertion order returned by
+           messageOrder().
+        */
+    void postMessage(Event *e, Tick t, bool disp, unsigned long order);
+
+    /**
+           The insertion order of a message of the parallel
+           engines, sent by LP src with sequence number seq. Among
+           the events with the same time and priority, the
+           messages come after the local events (which keep the
+           order in which they are posted), and they are ordered by
+           depth, then by source LP and sequence number, whatever
+           the order in which they arrive. The depth is 0, unless
+           the message has the same time and priority as the event
+           that sends it (see TimeWarpLP::send()). Each LP can send
+           up to 2^40 messages.
+        */
+    static unsigned long messageOrder(int src, unsigned long seq, 
+                                      unsigned depth = 0);
+
+    /// The depth of a message with insertion order order (0 for
+    /// a local event)
+    static unsigned messageDepth(unsigned long order);
+
+    /// The insertion order of e, the last key of Event::Cmp
+    static unsigned long getOrder(const Event *e);
+
   private:
 
     /**
@@ -193,21 +423,38 @@ namespace MetaSim {
         */
     void setTime(Tick);
 
+    /// Executes one run, from initSingleRun() to endSingleRun()
+    void singleRun(Tick endTick);
+
+    /// The number of threads to use (threads <= 0 means all the cores)
+    static int numThreads(int threads);
+
+    /// Executes nRuns replicas of the model built by factory on
+    /// nThreads threads, appending the results to results
+    static void runReplicas(Tick endTick, int nRuns, int nThreads,
+                            const ModelFactory &factory,
+                            std::vector< std::vector<double> > &results);
+
     void endSim();
 
     size_t numRuns;
     size_t actRuns;
-    Tick globTime;
     bool end;
+    bool batchDispatch;
   };
 
   class DbgObj {
+    Simulation &_sim;
   public:
-    DbgObj(const std::string &x, const string &y) {
-      Simulation::getInstance().dbgEnter(x,y);
+    DbgObj(const std::string &x, const string &y) : 
+      _sim(Simulation::getInstance()) {
+      _sim.dbgEnter(x,y);
+    }
+    DbgObj(int x, const char *y) : _sim(Simulation::getInstance()) {
+      _sim.dbgEnter(x,y);
     }
     ~DbgObj() {
-      Simulation::getInstance().dbgExit();
+      _sim.dbgExit();
     }
   };
 
@@ -223,10 +470,17 @@ void libmetasim_is_present();
 
 #ifdef __DEBUG__
 
-#define DBGENTER(x) DbgObj __dbg_obj__(x,__PRETTY_FUNCTION__)
+// the level of every call site is interned only once
+#define DBGENTER(x) static const int __dbg_lev__ = \
+  MetaSim::DebugStream::level(x);                  \
+  DbgObj __dbg_obj__(__dbg_lev__,__PRETTY_FUNCTION__)
 
-#define DBGTAG(x,y)   do { SIMUL.dbgEnter(x,y);       \
-  SIMUL.dbgExit();} while(0)
+#define DBGTAG(x,y)   do {                              \
+  static const int __dbg_lev__ = MetaSim::DebugStream::level(x); \
+  Simulation &__dbg_sim__ = SIMUL;                      \
+  __dbg_sim__.dbg.enter(__dbg_lev__);                   \
+  if (__dbg_sim__.dbg.filter()) __dbg_sim__.dbgHeader(y); \
+  __dbg_sim__.dbgExit();} while(0)
 
 #define DBGFORCE(x)   do {\
   SIMUL.dbg.enable("__FORCE__");  \
@@ -235,12 +489,19 @@ void libmetasim_is_present();
   SIMUL.dbg.exit();               \
   SIMUL.dbg.disable("__FORCE__"); } while(0)
 
-#define DBGPRINT(x)   SIMUL.dbg << x << endl
-#define DBGPRINT_2(x,y) SIMUL.dbg << x << y << endl
-#define DBGPRINT_3(x,y,z) SIMUL.dbg << x << y << z << endl
-#define DBGPRINT_4(x,y,z,w) SIMUL.dbg << x << y << z << w << endl
-#define DBGPRINT_5(x,y,z,w,r) SIMUL.dbg << x << y << z << w << r << endl
-#define DBGPRINT_6(x,y,z,w,r,s) SIMUL.dbg << x << y << z << w << r << s << endl
+// the arguments are evaluated only if the output is enabled
+#define DBGPRINT(x)   do { if (SIMUL.dbg.filter()) \
+  SIMUL.dbg << x << endl; } while (0)
+#define DBGPRINT_2(x,y) do { if (SIMUL.dbg.filter()) \
+  SIMUL.dbg << x << y << endl; } while (0)
+#define DBGPRINT_3(x,y,z) do { if (SIMUL.dbg.filter()) \
+  SIMUL.dbg << x << y << z << endl; } while (0)
+#define DBGPRINT_4(x,y,z,w) do { if (SIMUL.dbg.filter()) \
+  SIMUL.dbg << x << y << z << w << endl; } while (0)
+#define DBGPRINT_5(x,y,z,w,r) do { if (SIMUL.dbg.filter()) \
+  SIMUL.dbg << x << y << z << w << r << endl; } while (0)
+#define DBGPRINT_6(x,y,z,w,r,s) do { if (SIMUL.dbg.filter()) \
+  SIMUL.dbg << x << y << z << w << r << s << endl; } while (0)
 
 #define DBGVAR(x) DBGPRINT_2("  --> " #x " = ", x)
 
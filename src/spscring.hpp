@@ -0,0 +1,103 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __SPSCRING_HPP__
+#define __SPSCRING_HPP__
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace MetaSim {
+
+    /**
+       \ingroup metasim_util
+
+       A lock-free ring buffer with a single producer thread and a
+       single consumer thread. The capacity is rounded up to a
+       power of two. The two indexes grow forever and are masked
+       when used, and each thread keeps a private copy of the
+       index of the other one, so that a push() or a pop() usually
+       touches only the cache line of its own index.
+    */
+    template<class T>
+    class SpscRing {
+        static const size_t LINE = 64;
+
+        std::vector<T> _buf;
+        size_t _mask;
+
+        char _pad0[LINE];
+        std::atomic<size_t> _head;  // next slot to write
+        size_t _tailCache;          // copy of _tail for the producer
+        char _pad1[LINE];
+        std::atomic<size_t> _tail;  // next slot to read
+        size_t _headCache;          // copy of _head for the consumer
+        char _pad2[LINE];
+
+        SpscRing(const SpscRing &);
+        SpscRing &operator=(const SpscRing &);
+
+    public:
+        SpscRing(size_t capacity) : _buf(), _mask(0), _head(0), 
+                                    _tailCache(0), _tail(0), _headCache(0)
+            {
+                size_t c = 2;
+                while (c < capacity) c *= 2;
+                _buf.resize(c);
+                _mask = c - 1;
+            }
+
+        size_t capacity() const { return _mask + 1; }
+
+        /// Number of elements in the ring (approximate, if called
+        /// while the other thread is working)
+        size_t size() const 
+            { 
+                return _head.load(std::memory_order_acquire) - 
+                    _tail.load(std::memory_order_acquire);
+            }
+
+        bool empty() const { return size() == 0; }
+
+        /// Producer: appends v, returns false if the ring is full
+        inline bool push(const T &v)
+            {
+                size_t h = _head.load(std::memory_order_relaxed);
+                if (h - _tailCache > _mask) {
+                    _tailCache = _tail.load(std::memory_order_acquire);
+                    if (h - _tailCache > _mask) return false;
+                }
+                _buf[h & _mask] = v;
+                _head.store(h + 1, std::memory_order_release);
+                return true;
+            }
+
+        /// Consumer: moves up to n elements to out, returns how many
+        size_t pop(T *out, size_t n)
+            {
+                size_t t = _tail.load(std::memory_order_relaxed);
+                if (_headCache - t < n)
+                    _headCache = _head.load(std::memory_order_acquire);
+                size_t avail = _headCache - t;
+                if (avail > n) avail = n;
+                for (size_t i = 0; i < avail; ++i)
+                    out[i] = _buf[(t + i) & _mask];
+                _tail.store(t + avail, std::memory_order_release);
+                return avail;
+            }
+    };
+
+} // namespace MetaSim
+
+#endif // __SPSCRING_HPP__
@@ -0,0 +1,144 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <statetrace.hpp>
+
+namespace MetaSim {
+
+    using namespace std;
+
+    StateTrace::StateTrace(const string &filename, Type type, 
+                           size_t bufferSize) :
+        Trace(filename.c_str(), type, false),
+        _type(type),
+        _bufferSize(bufferSize > 0 ? bufferSize : 1),
+        _bin(),
+        _entities(),
+        _states(),
+        _entityIds(),
+        _stateIds(),
+        _buf(),
+        _used(0)
+    {
+        openFile();
+    }
+
+    StateTrace::~StateTrace()
+    {
+        close();
+    }
+
+    void StateTrace::openFile()
+    {
+        if (_type == BINARY) {
+            _bin.reset(new BinaryTrace(_filename, _bufferSize));
+            return;
+        }
+        _os.open(_filename.c_str(), ios::out);
+        if (!_os.is_open()) throw Exc();
+        _buf.resize(_bufferSize);
+        _used = 0;
+    }
+
+    uint32_t StateTrace::entity(const string &name)
+    {
+        map<string, uint32_t>::iterator i = _entityIds.find(name);
+        if (i != _entityIds.end()) return i->second;
+        uint32_t id = _entities.size();
+        _entityIds[name] = id;
+        _entities.push_back(name + '\t');
+        return id;
+    }
+
+    uint32_t StateTrace::state(const string &name)
+    {
+        map<string, uint32_t>::iterator i = _stateIds.find(name);
+        if (i != _stateIds.end()) return i->second;
+        uint32_t id = _states.size();
+        _stateIds[name] = id;
+        _states.push_back(name + '\n');
+        return id;
+    }
+
+    void StateTrace::recordText(Tick t, uint32_t entity, uint32_t state)
+    {
+        const string &e = _entities[entity];
+        const string &s = _states[state];
+
+        // the time, written backwards from the end of a small buffer
+        char num[24];
+        char *p = num + sizeof(num);
+        *--p = '\t';
+        int64_t v = int64_t(t);
+        uint64_t u = v < 0 ? 0 - uint64_t(v) : uint64_t(v);
+        do {
+            *--p = char('0' + u % 10);
+            u /= 10;
+        } while (u != 0);
+        if (v < 0) *--p = '-';
+        size_t n = num + sizeof(num) - p;
+
+        size_t len = n + e.size() + s.size();
+        if (_used + len > _buf.size()) {
+            flush();
+            if (len > _buf.size()) _buf.resize(len);
+        }
+        char *out = &_buf[_used];
+        memcpy(out, p, n);
+        memcpy(out + n, e.data(), e.size());
+        memcpy(out + n + e.size(), s.data(), s.size());
+        _used += len;
+    }
+
+    void StateTrace::flush()
+    {
+        if (_bin) {
+            _bin->flush();
+            return;
+        }
+        if (_used > 0) _os.write(&_buf[0], _used);
+        _used = 0;
+    }
+
+    void StateTrace::close()
+    {
+        if (_bin) {
+            // the separators are not part of the names
+            for (size_t i = 0; i < _entities.size(); ++i)
+                _bin->setName(BinaryTrace::ENTITY_NAME, i, 
+                              _entities[i].substr(0, _entities[i].size() - 1));
+            for (size_t i = 0; i < _states.size(); ++i)
+                _bin->setName(BinaryTrace::TYPE_NAME, i, 
+                              _states[i].substr(0, _states[i].size() - 1));
+            _bin->close();
+            _bin.reset();
+            return;
+        }
+        if (!_os.is_open()) return;
+        flush();
+        _os.close();
+    }
+
+    void StateTrace::reopen(const string &filename)
+    {
+        close();
+        _filename = filename;
+        openFile();
+    }
+
+    void StateTrace::open(bool)
+    {
+        reopen(_filename);
+    }
+
+} // namespace MetaSim
@@ -0,0 +1,130 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __STATETRACE_HPP__
+#define __STATETRACE_HPP__
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include <bintrace.hpp>
+#include <tick.hpp>
+#include <trace.hpp>
+
+namespace MetaSim {
+
+    /**
+       \ingroup metasim_stat
+
+       A trace of the state changes of a set of entities: every
+       record is the time, the entity and its new state. The
+       entities and the states are interned once with entity()
+       and state(), which return small integer IDs, and then
+       record() takes only the IDs, so that recording costs no
+       string construction and no stream formatting.
+
+       With type ASCII, every record is a line of text made of the
+       time, the entity name and the state name, separated by
+       tabs. The names are kept already formatted, so a line is
+       produced by converting the time and copying the two names
+       in a large buffer, written with a single write when full.
+
+       With type BINARY, the records are written with a
+       BinaryTrace (the state is the record type), and the names
+       are written only once, when the file is closed. The file
+       can be converted to the same text format with trace2ascii.
+
+       @code
+       StateTrace t("states.txt");
+       uint32_t cpu = t.entity("CPU0");
+       uint32_t busy = t.state("BUSY");
+       ...
+       t.record(SIMUL.getTime(), cpu, busy);
+       @endcode
+    */
+    class StateTrace : public Trace {
+    public:
+        /**
+           Creates the file.
+
+           @param filename   the name of the file
+           @param type       ASCII for text, BINARY for a BinaryTrace
+           @param bufferSize the size of the buffer, in bytes for the
+                             text traces, in records for the binary
+                             ones
+        */
+        StateTrace(const std::string &filename, Type type = ASCII,
+                   size_t bufferSize = 65536);
+        ~StateTrace();
+
+        /// Returns the ID of the entity called name, interning it
+        /// the first time
+        uint32_t entity(const std::string &name);
+
+        /// Returns the ID of the state called name, interning it
+        /// the first time
+        uint32_t state(const std::string &name);
+
+        /// Records that entity entered state at time t
+        inline void record(Tick t, uint32_t entity, uint32_t state)
+            {
+                if (_bin) _bin->record(t, state, entity);
+                else recordText(t, entity, state);
+            }
+
+        /**
+           Closes the current file and starts writing in a new
+           one, of the same type. The IDs of the entities and of
+           the states remain valid.
+        */
+        void reopen(const std::string &filename);
+
+        /// Same as reopen() on the current file, which is created
+        /// again: the type of the trace does not change
+        virtual void open(bool type = BINARY);
+
+        /// Writes the buffered records to the file
+        void flush();
+
+        /// Writes the buffered records (and the names, for the
+        /// binary traces), and closes the file
+        virtual void close();
+
+        Type getType() const { return _type; }
+
+    private:
+        Type _type;
+        size_t _bufferSize;
+        std::unique_ptr<BinaryTrace> _bin;
+
+        // the names, followed by the separator of the text format
+        std::vector<std::string> _entities;
+        std::vector<std::string> _states;
+        std::map<std::string, uint32_t> _entityIds;
+        std::map<std::string, uint32_t> _stateIds;
+
+        std::vector<char> _buf;
+        size_t _used;
+
+        void recordText(Tick t, uint32_t entity, uint32_t state);
+        void openFile();
+    };
+
+} // namespace MetaSim
+
+#endif // __STATETRACE_HPP__
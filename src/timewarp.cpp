@@ -0,0 +1,319 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <algorithm>
+#include <exception>
+#include <thread>
+
+#include <barrier.hpp>
+#include <basestat.hpp>
+#include <timewarp.hpp>
+
+namespace MetaSim {
+
+    using namespace std;
+
+    TimeWarpLP::TimeWarpLP(TimeWarpSimulation *tw, int id) :
+        Simulation(), _tw(tw), _id(id), _inMutex(), _inbox(),
+        _processed(), _log(), _msgs(), _msgKey(), _gen(id + 1), _gens(),
+        _sent(0), _rollbacks(0), _undone(0), _committed(0)
+    {
+        _gens.push_back(&_gen);
+        _randomGen = &_gen;
+    }
+
+    TimeWarpLP *TimeWarpLP::current()
+    {
+        return dynamic_cast<TimeWarpLP *>(&SimulationContext::current());
+    }
+
+    Tick TimeWarpLP::nextTime()
+    {
+        Event *e = _eventQueue->front();
+        if (e == NULL) return MAXTICK;
+        return e->getTime();
+    }
+
+    void TimeWarpLP::receive(const Message &m)
+    {
+        lock_guard<mutex> lock(_inMutex);
+        _inbox.push_back(m);
+        _tw->_msgSent++;
+    }
+
+    void TimeWarpLP::send(int dst, Event *e, Tick t, bool disp)
+    {
+        // the destination would give the memory back to the pool
+        // of this LP from its own thread
+        if (e->isPooled())
+            throw TimeWarpSimulation::Exc("A pooled event cannot be sent");
+        if (UndoLog::active() != &_log)
+            throw TimeWarpSimulation::Exc("Send outside of an event of the LP");
+        if (dst < 0 || dst >= _tw->size())
+            throw TimeWarpSimulation::Exc("Unknown destination LP");
+        if (t < globTime)
+            throw TimeWarpSimulation::Exc("Message in the past");
+
+        if (dst == _id) {
+            e->post(t, disp);
+            return;
+        }
+
+        // a message with the same time and priority as the sending
+        // event comes after all the events with that time and
+        // priority executed by this LP, so that no event can be
+        // ordered before its causes
+        const Processed &cur = _processed.back();
+        unsigned depth = 0;
+        if (t == cur.time && e->getPriority() < cur.priority)
+            throw TimeWarpSimulation::Exc("Message before the sending event");
+        if (t == cur.time && e->getPriority() == cur.priority) {
+            for (size_t i = _processed.size(); i-- > 0 && _processed[i].time == t; )
+                if (_processed[i].priority == cur.priority)
+                    depth = max(depth, messageDepth(_processed[i].order) + 1);
+            if (depth > MAX_MESSAGE_DEPTH)
+                throw TimeWarpSimulation::Exc("Too many messages with the same time");
+        }
+
+        Message m;
+        m.evt = e;
+        m.time = t;
+        m.src = _id;
+        m.seq = _sent++;
+        m.order = messageOrder(_id, m.seq, depth);
+        m.disp = disp;
+        m.anti = false;
+        _processed.back().sent.push_back(make_pair(dst, m));
+        _tw->_lp[dst]->receive(m);
+    }
+
+    void TimeWarpLP::drain()
+    {
+        vector<Message> in;
+        {
+            lock_guard<mutex> lock(_inMutex);
+            in.swap(_inbox);
+        }
+        // counted in advance, so that an exception cannot leave
+        // the GVT computation waiting for the other messages
+        _tw->_msgRecv += in.size();
+        for (size_t i = 0; i < in.size(); ++i) handle(in[i]);
+    }
+
+    void TimeWarpLP::handle(const Message &m)
+    {
+        MsgKey key(m.src, m.seq);
+        if (!m.anti) {
+            // undoes the events that should have come after it
+            rollback(m.time, m.evt->getPriority(), m.order, false);
+            postMessage(m.evt, m.time, m.disp, m.order);
+            _msgs[key] = m.evt;
+            _msgKey[m.evt] = key;
+            return;
+        }
+
+        map<MsgKey, Event *>::iterator i = _msgs.find(key);
+        if (i == _msgs.end())
+            throw TimeWarpSimulation::Exc("Anti-message without message");
+        Event *e = i->second;
+        _msgs.erase(i);
+        _msgKey.erase(e);
+
+        // the message has already been executed: undo it
+        if (!e->isInQueue()) rollback(m.time, e->getPriority(), getOrder(e), true);
+        e->drop();
+        if (m.disp) e->dispose();
+    }
+
+    void TimeWarpLP::execute(Event *e)
+    {
+        _processed.push_back(Processed());
+        Processed &p = _processed.back();
+        p.evt = e;
+        p.time = e->getTime();
+        p.priority = e->getPriority();
+        p.order = getOrder(e);
+        p.prevTime = globTime;
+        p.mark = _log.mark();
+        p.counter = _eventCounter;
+        p.seq = _sent;
+        for (BaseStat::iterator i = BaseStat::begin(); i != BaseStat::end(); ++i)
+            (*i)->saveState(p.stats);
+        for (size_t i = 0; i < _gens.size(); ++i)
+            _gens[i]->getState(p.gens);
+
+        _log.saveEvent(e);
+        Event::extractFirst();
+        globTime = p.time;
+
+        _log.newEpoch();
+        UndoLog *old = UndoLog::activate(&_log);
+        try {
+            e->action();
+        } catch (...) {
+            UndoLog::activate(old);
+            throw;
+        }
+        UndoLog::activate(old);
+    }
+
+    void TimeWarpLP::rollback(Tick t, int prio, unsigned long order, bool inclusive)
+    {
+        // an event posted with no delay can be executed after
+        // events with a greater key: the executed events are not
+        // sorted within the same time
+        size_t first = _processed.size();
+        for (size_t i = _processed.size(); i-- > 0; ) {
+            const Processed &p = _processed[i];
+            if (p.time < t) break;
+            if (p.time > t || p.priority > prio ||
+                (p.priority == prio && (p.order > order || 
+                                        (p.order == order && inclusive))))
+                first = i;
+        }
+
+        unsigned long undone = _undone;
+        while (_processed.size() > first) {
+            Processed &p = _processed.back();
+
+            for (size_t i = p.sent.size(); i-- > 0; ) {
+                Message anti = p.sent[i].second;
+                anti.anti = true;
+                _tw->_lp[p.sent[i].first]->receive(anti);
+            }
+
+            _log.undo(p.mark);
+            const double *s = p.stats.empty() ? NULL : &p.stats[0];
+            for (BaseStat::iterator i = BaseStat::begin(); i != BaseStat::end(); ++i)
+                (*i)->restoreState(s);
+            const uint64_t *g = p.gens.empty() ? NULL : &p.gens[0];
+            for (size_t i = 0; i < _gens.size(); ++i)
+                _gens[i]->setState(g);
+            _eventCounter = p.counter;
+            _sent = p.seq;
+            globTime = p.prevTime;
+
+            _processed.pop_back();
+            _undone++;
+        }
+        if (_undone != undone) _rollbacks++;
+    }
+
+    void TimeWarpLP::fossil(Tick gvt)
+    {
+        // an event at gvt can still send a message with the same
+        // time and a higher priority: only the earlier ones are safe
+        while (!_processed.empty() && _processed.front().time < gvt) {
+            Event *e = _processed.front().evt;
+            _processed.pop_front();
+            _committed++;
+
+            map<Event *, MsgKey>::iterator i = _msgKey.find(e);
+            if (i != _msgKey.end()) {
+                _msgs.erase(i->second);
+                _msgKey.erase(i);
+            }
+            if (e->isDisposable() && !e->isInQueue()) e->dispose();
+        }
+        _log.commit(_processed.empty() ? _log.mark() : _processed.front().mark);
+    }
+
+    TimeWarpSimulation::TimeWarpSimulation(int n) :
+        _lp(), _batch(1000), _msgSent(0), _msgRecv(0)
+    {
+        if (n < 1) throw Exc("At least one LP is needed");
+        if (n > Simulation::MAX_MESSAGE_SOURCES) throw Exc("Too many LPs");
+        for (int i = 0; i < n; ++i)
+            _lp.push_back(new TimeWarpLP(this, i));
+    }
+
+    TimeWarpSimulation::~TimeWarpSimulation()
+    {
+        for (size_t i = 0; i < _lp.size(); ++i) delete _lp[i];
+    }
+
+    void TimeWarpSimulation::run_to(Tick stop)
+    {
+        int n = _lp.size();
+        Barrier barrier(n);
+        vector<Tick> lvt(n);
+        vector<exception_ptr> errors(n);
+        atomic<bool> failed(false);
+
+        // every thread alternates an optimistic phase, in which
+        // it executes up to _batch events, and a GVT phase
+        auto worker = [&] (int id) {
+            TimeWarpLP &lp = *_lp[id];
+            SimulationContext::Scope scope(lp);
+            while (true) {
+                try {
+                    for (size_t k = 0; k < _batch && !failed; ++k) {
+                        lp.drain();
+                        Event *e = Event::getFirst();
+                        if (e == NULL || e->getTime() > stop) break;
+                        lp.execute(e);
+                    }
+                } catch (...) {
+                    errors[id] = current_exception();
+                    failed = true;
+                }
+
+                // handle messages until none is in transit
+                bool quiet;
+                do {
+                    try {
+                        lp.drain();
+                    } catch (...) {
+                        if (!errors[id]) errors[id] = current_exception();
+                        failed = true;
+                    }
+                    barrier.wait();
+                    quiet = (_msgSent == _msgRecv);
+                    barrier.wait();
+                } while (!quiet);
+
+                lvt[id] = lp.nextTime();
+                barrier.wait();
+                Tick gvt = *min_element(lvt.begin(), lvt.end());
+                bool finish = failed || gvt > stop;
+                if (!failed) lp.fossil(gvt);
+                barrier.wait();
+                if (finish) break;
+            }
+        };
+
+        vector<thread> workers;
+        for (int i = 0; i < n; ++i) workers.push_back(thread(worker, i));
+        for (int i = 0; i < n; ++i) workers[i].join();
+        for (int i = 0; i < n; ++i)
+            if (errors[i]) rethrow_exception(errors[i]);
+
+        for (int i = 0; i < n; ++i)
+            if (_lp[i]->globTime < stop) _lp[i]->globTime = stop;
+    }
+
+    void TimeWarpSimulation::run(Tick stop)
+    {
+        for (size_t i = 0; i < _lp.size(); ++i) {
+            _lp[i]->initRuns(1);
+            _lp[i]->initSingleRun();
+        }
+        run_to(stop);
+        for (size_t i = 0; i < _lp.size(); ++i) {
+            _lp[i]->endSingleRun();
+            SimulationContext::Scope scope(*_lp[i]);
+            BaseStat::endSim();
+        }
+    }
+
+} // namespace MetaSim
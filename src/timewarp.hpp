@@ -0,0 +1,266 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __TIMEWARP_HPP__
+#define __TIMEWARP_HPP__
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <baseexc.hpp>
+#include <event.hpp>
+#include <randomvar.hpp>
+#include <rollback.hpp>
+#include <simul.hpp>
+#include <tick.hpp>
+
+namespace MetaSim {
+
+    class TimeWarpSimulation;
+
+    /**
+       \ingroup metasim_ee
+
+       A logical process of a TimeWarpSimulation: a partition of
+       the model, with its own entities, event queue and clock,
+       executed speculatively by its own thread. As for the
+       LogicalProcess of the conservative engine, it is populated
+       by making it current while the entities are created, and it
+       communicates with the other LPs only through send().
+
+       Since the events of an LP can be undone, the state of the
+       entities that is modified by the events must be declared
+       with Rollback variables, and the random generators used by
+       the events must be registered with addGenerator(). The
+       generator returned by getGenerator() is registered by
+       default, and it is the default generator of the random
+       variables created while the LP is current (see
+       SimulationContext): each LP draws its own sequence, and the
+       variables created without a generator need no care. The
+       event queue and the statistical objects of the LP are saved
+       by the engine.
+    */
+    class TimeWarpLP : public Simulation {
+        friend class TimeWarpSimulation;
+
+        // a message (or anti-message, which cancels the message
+        // with the same source and sequence number)
+        struct Message {
+            Event *evt;
+            Tick time;
+            int src;
+            unsigned long seq;
+            unsigned long order;
+            bool disp;
+            bool anti;
+        };
+
+        // an executed event, with the state needed to undo it
+        struct Processed {
+            Event *evt;
+            Tick time;
+            int priority;
+            unsigned long order;
+            Tick prevTime;
+            size_t mark;
+            unsigned long counter;
+            unsigned long seq;
+            std::vector<double> stats;
+            std::vector<uint64_t> gens;
+            std::vector< std::pair<int, Message> > sent;
+        };
+
+        typedef std::pair<int, unsigned long> MsgKey;
+
+        TimeWarpSimulation *_tw;
+        int _id;
+
+        std::mutex _inMutex;
+        std::vector<Message> _inbox;
+
+        std::deque<Processed> _processed;
+        UndoLog _log;
+
+        // the messages received and not yet committed
+        std::map<MsgKey, Event *> _msgs;
+        std::map<Event *, MsgKey> _msgKey;
+
+        RandomGen _gen;
+        std::vector<RandomGen *> _gens;
+
+        unsigned long _sent;
+        unsigned long _rollbacks;
+        unsigned long _undone;
+        unsigned long _committed;
+
+        TimeWarpLP(TimeWarpSimulation *tw, int id);
+
+        // puts a message in the inbox (called by other threads)
+        void receive(const Message &m);
+
+        // handles the messages in the inbox
+        void drain();
+        void handle(const Message &m);
+
+        // executes event e, the first of the queue
+        void execute(Event *e);
+
+        // undoes the executed events from the first one that comes
+        // after the key (t, prio, order) in the order of the queue
+        // (or has that key, if inclusive is true)
+        void rollback(Tick t, int prio, unsigned long order, bool inclusive);
+
+        // commits the executed events with time before gvt
+        void fossil(Tick gvt);
+
+        // the time of the next event, or MAXTICK
+        Tick nextTime();
+
+    public:
+        /// The index of this LP in its TimeWarpSimulation
+        int getID() const { return _id; }
+
+        /// Returns the LP current in the calling thread, or NULL
+        static TimeWarpLP *current();
+
+        /**
+           Sends event e to LP dst, which will post it at time t.
+           It can only be called while an event of this LP is
+           executed, and t cannot be in the past; there is no
+           lookahead constraint. The event must belong to LP dst
+           and must not be already posted nor created by
+           Event::create(). If the sending event
+           is rolled back, the message is cancelled by an
+           anti-message and, if disp is true, the event is
+           deleted. With t equal to the current time, e cannot
+           have a higher priority than the sending event; with the
+           same priority, it comes after all the events with that
+           time and priority already executed by this LP, so that
+           it is never ordered before its causes.
+        */
+        void send(int dst, Event *e, Tick t, bool disp = false);
+
+        /// The standard generator of the LP, saved by the engine
+        RandomGen &getGenerator() { return _gen; }
+
+        /// Registers another generator to be saved by the engine
+        void addGenerator(RandomGen *g) { _gens.push_back(g); }
+
+        /// Number of rollbacks of this LP
+        unsigned long getRollbacks() const { return _rollbacks; }
+
+        /// Number of events undone by the rollbacks
+        unsigned long getUndoneEvents() const { return _undone; }
+
+        /// Number of events executed and committed
+        unsigned long getCommittedEvents() const { return _committed; }
+    };
+
+    /**
+       \ingroup metasim_ee
+
+       Optimistic parallel simulation engine (Time Warp,
+       Jefferson). Every logical process (see TimeWarpLP) executes
+       its events as soon as possible, without waiting for the
+       other LPs. When a message arrives with a time in the past of
+       the destination (a straggler), the destination rolls back:
+       the events executed after that time are undone with their
+       UndoLog (event queue and Rollback variables), the
+       statistics and the generators are restored from the copies
+       saved before each event, and anti-messages are sent to
+       cancel the messages sent by the undone events, possibly
+       causing further rollbacks.
+
+       Every <i>batch</i> executed events (see setBatch()), the
+       LPs stop and compute the Global Virtual Time: they handle
+       all the messages until none is in transit, then GVT is the
+       time of the earliest unprocessed event of all the LPs. No
+       event before GVT can be rolled back any longer, so the
+       executed events before GVT are committed (fossil
+       collection): their undo records are freed and the
+       disposable events are deleted.
+
+       Conservative synchronisation (ParallelSimulation) needs a
+       positive lookahead on every link; Time Warp can be used
+       when the lookahead is very small or zero. The events are
+       executed in the same order as in the conservative engine
+       (time, priority, then the local events before the messages,
+       see Simulation::messageOrder()), and a message that comes
+       before an executed event in this order causes a rollback:
+       hence the result does not depend on the scheduling of the
+       threads.
+    */
+    class TimeWarpSimulation {
+        friend class TimeWarpLP;
+
+        std::vector<TimeWarpLP *> _lp;
+        size_t _batch;
+
+        // messages put in the inboxes, and handled
+        std::atomic<unsigned long> _msgSent;
+        std::atomic<unsigned long> _msgRecv;
+
+        TimeWarpSimulation(const TimeWarpSimulation &);
+        TimeWarpSimulation &operator=(const TimeWarpSimulation &);
+
+    public:
+        /**
+           \ingroup metasim_exc
+
+           Exceptions for the Time Warp engine.
+        */
+        class Exc : public BaseExc {
+        public:
+            Exc(const std::string message,
+                const std::string cl = "TimeWarpSimulation",
+                const std::string md = "timewarp.cpp")
+                : BaseExc(message,cl,md) {} ;
+        };
+
+        /// Creates a Time Warp simulation with n logical processes
+        TimeWarpSimulation(int n);
+        ~TimeWarpSimulation();
+
+        /// The number of logical processes
+        int size() const { return _lp.size(); }
+
+        /// Returns the i-th logical process
+        TimeWarpLP &getLP(int i) { return *_lp.at(i); }
+
+        /// Sets the number of events executed by every LP
+        /// between two GVT computations
+        void setBatch(size_t b) { _batch = b > 0 ? b : 1; }
+
+        /**
+           Executes one run: calls Entity::newRun() on all the
+           entities, executes all the events up to time
+           <i>stop</i> (included), then calls Entity::endRun() and
+           closes the statistics of every LP.
+        */
+        void run(Tick stop);
+
+        /**
+           Executes all the events up to time <i>stop</i>
+           (included), without initialising or closing the run:
+           it is the equivalent of Simulation::run_to().
+        */
+        void run_to(Tick stop);
+    };
+
+} // namespace MetaSim
+
+#endif // __TIMEWARP_HPP__
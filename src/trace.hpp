@@ -136,9 +136,9 @@ namespace MetaSim {
 
     /// Records the value on the file, one value per line.
     //@{
-    void record(double value) { _os << value << std::endl; }
-    void record(long double value){_os << value << std::endl;}
-    void record(int value){_os << value << std::endl;}
+    void record(double value) { _os << value << '\n'; }
+    void record(long double value){_os << value << '\n';}
+    void record(int value){_os << value << '\n';}
     void record(const char * str){_os << str;}
 
     /// DEPRECATED substitute with the particle mechanism
@@ -0,0 +1,51 @@
+/***************************************************************************
+    begin                : Thu Apr 24 15:54:58 CEST 2003
+    copyright            : (C) 2003 by Giuseppe Lipari
+    email                : lipari@sssup.it
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+/*
+ * Converts a binary trace written by BinaryTrace into the text
+ * format of TraceAscii.
+ *
+ * Usage: trace2ascii trace.bin [trace.txt]
+ */
+#include <fstream>
+#include <iostream>
+
+#include <bintrace.hpp>
+
+using namespace std;
+using namespace MetaSim;
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2 || argc > 3) {
+        cerr << "Usage: " << argv[0] << " trace.bin [trace.txt]" << endl;
+        return 1;
+    }
+
+    try {
+        BinaryTraceReader r(argv[1]);
+        if (argc == 3) {
+            ofstream os(argv[2]);
+            if (!os) {
+                cerr << "Cannot open " << argv[2] << endl;
+                return 1;
+            }
+            r.toAscii(os);
+        }
+        else r.toAscii(cout);
+    } catch (BaseExc &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
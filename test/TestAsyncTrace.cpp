@@ -0,0 +1,155 @@
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include <asynctrace.hpp>
+#include <bintrace.hpp>
+#include <spscring.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+using namespace std;
+
+TEST_CASE("TestSpscRingThreads", "testAsyncTrace")
+{
+    SpscRing<unsigned long> ring(100);
+    REQUIRE( ring.capacity() == 128 );
+
+    const unsigned long N = 200000;
+    thread producer([&] () {
+            for (unsigned long i = 0; i < N; ++i)
+                while (!ring.push(i)) this_thread::yield();
+        });
+
+    vector<unsigned long> buf(37);
+    unsigned long expected = 0;
+    bool ordered = true;
+    while (expected < N) {
+        size_t n = ring.pop(&buf[0], buf.size());
+        for (size_t i = 0; i < n; ++i)
+            if (buf[i] != expected++) ordered = false;
+    }
+    producer.join();
+    REQUIRE( ordered );
+    REQUIRE( ring.empty() );
+}
+
+TEST_CASE("TestCompressedTrace", "testAsyncTrace")
+{
+    const char *file = "test_ctrace.bin";
+    {
+        BinaryTrace t(file, 13, true);
+        for (int i = 0; i < 1000; ++i)
+            t.record(Tick(5 * i - (i % 7)), i % 4, (i % 3 == 0) ? 
+                     BinaryTrace::NO_ENTITY : i % 9, (i % 2) ? i * 0.25 : 0);
+        t.setName(BinaryTrace::TYPE_NAME, 2, "WAIT");
+    }
+
+    BinaryTraceReader r(file, 10);
+    REQUIRE( r.size() == 1000 );
+    REQUIRE( (r.getHeader().flags & BinaryTrace::FLAG_COMPRESSED) != 0 );
+    REQUIRE( r.getName(BinaryTrace::TYPE_NAME, 2) == "WAIT" );
+
+    TraceRecord rec;
+    int i = 0;
+    bool same = true;
+    while (r.next(rec)) {
+        uint32_t ent = (i % 3 == 0) ? BinaryTrace::NO_ENTITY : i % 9;
+        if (rec.tick != 5 * i - (i % 7) || int(rec.type) != (i % 4) ||
+            rec.entity != ent || rec.payload != ((i % 2) ? i * 0.25 : 0))
+            same = false;
+        i++;
+    }
+    REQUIRE( i == 1000 );
+    REQUIRE( same );
+    remove(file);
+}
+
+TEST_CASE("TestAsyncTraceBlock", "testAsyncTrace")
+{
+    const char *file = "test_atrace.bin";
+    const int N = 100000;
+    {
+        // a small ring, so that the producer has to wait
+        AsyncTrace t(file, AsyncTrace::BLOCK, 64);
+        for (int i = 0; i < N; ++i) t.record(Tick(i), i % 5, i % 11, i);
+        t.setName(BinaryTrace::ENTITY_NAME, 3, "node_3");
+        t.close();
+        REQUIRE( t.getRecords() == (unsigned long) N );
+        REQUIRE( t.getWritten() == (unsigned long) N );
+        REQUIRE( t.getDropped() == 0 );
+        REQUIRE( t.getPending() == 0 );
+    }
+
+    BinaryTraceReader r(file);
+    REQUIRE( r.size() == (uint64_t) N );
+    REQUIRE( r.getName(BinaryTrace::ENTITY_NAME, 3) == "node_3" );
+    TraceRecord rec;
+    int i = 0;
+    bool same = true;
+    while (r.next(rec)) {
+        if (rec.tick != i || int(rec.type) != (i % 5) || 
+            int(rec.entity) != (i % 11) || rec.payload != i)
+            same = false;
+        i++;
+    }
+    REQUIRE( i == N );
+    REQUIRE( same );
+    remove(file);
+}
+
+TEST_CASE("TestAsyncTraceDrop", "testAsyncTrace")
+{
+    const char *file = "test_atrace_drop.bin";
+    const int N = 100000;
+    {
+        AsyncTrace t(file, AsyncTrace::DROP, 2);
+        for (int i = 0; i < N; ++i) t.record(Tick(i), 0, 0);
+        t.close();
+        REQUIRE( t.getRecords() == (unsigned long) N );
+        REQUIRE( (t.getWritten() + t.getDropped()) == (unsigned long) N );
+        REQUIRE( t.getStalls() == t.getDropped() );
+        REQUIRE( t.getStallTime() == 0 );
+    }
+
+    // the records that were not dropped are in order
+    BinaryTraceReader r(file);
+    TraceRecord rec;
+    int64_t last = -1;
+    bool ordered = true;
+    while (r.next(rec)) {
+        if (rec.tick <= last) ordered = false;
+        last = rec.tick;
+    }
+    REQUIRE( ordered );
+    remove(file);
+}
+
+TEST_CASE("TestAsyncTraceReopen", "testAsyncTrace")
+{
+    const char *file = "test_atrace_reopen.bin";
+    {
+        // the first run is discarded by open(), as with a Trace
+        AsyncTrace t(file, AsyncTrace::BLOCK, 64);
+        for (int i = 0; i < 5000; ++i) t.record(Tick(i), 1, 1);
+        t.setName(BinaryTrace::ENTITY_NAME, 1, "node_1");
+        t.open();
+        REQUIRE( t.getRecords() == 0 );
+        for (int i = 0; i < 3000; ++i) t.record(Tick(2 * i), 2, 2, i);
+    }
+
+    BinaryTraceReader r(file);
+    REQUIRE( r.size() == 3000 );
+    REQUIRE( r.getName(BinaryTrace::ENTITY_NAME, 1) == "node_1" );
+    TraceRecord rec;
+    int i = 0;
+    bool same = true;
+    while (r.next(rec)) {
+        if (rec.tick != 2 * i || rec.type != 2 || rec.payload != i) same = false;
+        i++;
+    }
+    REQUIRE( i == 3000 );
+    REQUIRE( same );
+    remove(file);
+}
@@ -0,0 +1,136 @@
+#include <utility>
+#include <vector>
+
+#include <event.hpp>
+#include <eventqueue.hpp>
+#include <gevent.hpp>
+#include <simul.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+using namespace std;
+
+namespace {
+    typedef vector< pair<Tick, int> > Log;
+
+    // all the stations wake up on the same slots, and perturb
+    // each other: drops, reschedules, and new events at the same
+    // time with higher and equal priority
+    class Station : public Event {
+    public:
+        int id;
+        vector<Station *> *all;
+        Log *log;
+        unsigned *rnd;
+
+        Station(int i, vector<Station *> *a, Log *l, unsigned *r) :
+            Event(0), id(i), all(a), log(l), rnd(r) {}
+
+        virtual void doit()
+        {
+            Tick t = SIMUL.getTime();
+            log->push_back(make_pair(t, id));
+
+            *rnd = *rnd * 1103515245 + 12345;
+            unsigned r = (*rnd >> 8);
+            Station *other = (*all)[r % all->size()];
+            Log *l = log;
+            int i = id;
+            switch ((r / 16) % 5) {
+            case 0:
+                other->drop();
+                other->post(t + 10);
+                break;
+            case 1:
+                other->reschedule(t);
+                break;
+            case 2:
+                Event::create<FunctionEvent>([l, i] (Event *e) {
+                        l->push_back(make_pair(e->getTime(), 100 + i));
+                    }, -1)->post(t, true);
+                break;
+            case 3:
+                Event::create<FunctionEvent>([l, i] (Event *e) {
+                        l->push_back(make_pair(e->getTime(), 200 + i));
+                    }, 0)->post(t, true);
+                break;
+            }
+            if (!isInQueue()) post((t / 10 + 1) * 10);
+        }
+    };
+
+    Log runStations(EventQueue::Type q, bool batch)
+    {
+        Simulation sim(q);
+        SimulationContext::Scope scope(sim);
+        sim.setBatchDispatch(batch);
+
+        Log log;
+        unsigned rnd = 1;
+        vector<Station *> all;
+        for (int i = 0; i < 20; ++i)
+            all.push_back(new Station(i, &all, &log, &rnd));
+        for (int i = 0; i < 20; ++i) all[i]->post(10);
+
+        sim.run_to(2000);
+        REQUIRE( !sim.getBatchDispatch() == !batch );
+
+        sim.clearEventQueue();
+        for (int i = 0; i < 20; ++i) delete all[i];
+        return log;
+    }
+
+    class Thrower : public Event {
+    public:
+        int *count;
+        bool fail;
+        Thrower(int *c, bool f) : Event(), count(c), fail(f) {}
+        virtual void doit()
+        {
+            (*count)++;
+            if (fail) {
+                fail = false;
+                throw BaseExc("failure");
+            }
+        }
+    };
+}
+
+TEST_CASE("TestBatchDispatchSameResult", "testBatch")
+{
+    EventQueue::Type types[] = { EventQueue::SET, EventQueue::BINARY_HEAP, 
+                                 EventQueue::QUAD_HEAP, EventQueue::PAIRING_HEAP,
+                                 EventQueue::CALENDAR };
+    Log ref = runStations(EventQueue::DEFAULT, false);
+    REQUIRE( ref.size() > 4000 );
+    for (int i = 0; i < 5; ++i) {
+        Log l = runStations(types[i], true);
+        REQUIRE( l == ref );
+    }
+}
+
+TEST_CASE("TestBatchDispatchException", "testBatch")
+{
+    Simulation sim;
+    SimulationContext::Scope scope(sim);
+    int count = 0;
+    vector<Thrower *> evts;
+    for (int i = 0; i < 5; ++i) {
+        evts.push_back(new Thrower(&count, i == 1));
+        evts.back()->post(5);
+    }
+
+    REQUIRE_THROWS( sim.sim_batch() );
+    REQUIRE( count == 2 );
+    // the others are back in the queue, in their order
+    REQUIRE( sim.getEventQueue().size() == 3 );
+    REQUIRE( Event::getFirst() == evts[2] );
+    REQUIRE( evts[4]->isInQueue() );
+
+    REQUIRE( sim.sim_batch() == 5 );
+    REQUIRE( count == 5 );
+    REQUIRE( sim.getEventQueue().empty() );
+
+    for (int i = 0; i < 5; ++i) delete evts[i];
+}
@@ -0,0 +1,81 @@
+#include <cmath>
+
+#include <batchmeans.hpp>
+#include <simul.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+using namespace std;
+
+namespace {
+    // an AR(1) process with mean 10, starting far from it
+    class AR1 {
+        double _x;
+        unsigned long _s;
+    public:
+        AR1(double x0) : _x(x0), _s(42) {}
+        double next()
+        {
+            _s = _s * 6364136223846793005UL + 1442695040888963407UL;
+            double u = double(_s >> 11) / double(1UL << 53) * 2 - 1;
+            _x = 10 + 0.9 * (_x - 10) + u;
+            return _x;
+        }
+    };
+}
+
+TEST_CASE("TestBatchMeansWarmup", "testBatchMeans")
+{
+    Simulation sim;
+    SimulationContext::Scope scope(sim);
+
+    StatBatchMeans stat("ar1");
+    BaseStat::init(1);
+    BaseStat::newRun();
+    AR1 p(1000);
+    const int N = 200000;
+    for (int i = 0; i < N; ++i) stat.record(p.next());
+    BaseStat::endRun();
+    BaseStat::endSim();
+
+    REQUIRE( stat.getObservations() == (size_t) N );
+    REQUIRE( stat.getBatchMeans().size() == 20 );
+
+    // the warm-up (about 100 values) is discarded, not much more
+    REQUIRE( stat.getTruncation() >= 20 );
+    REQUIRE( stat.getTruncation() < (size_t) N / 20 );
+
+    double hw = stat.getBatchConfInterval();
+    REQUIRE( hw > 0.001 );
+    REQUIRE( hw < 0.1 );
+    REQUIRE( fabs(stat.getLastValue() - 10) < 2 * hw );
+    REQUIRE( fabs(stat.getLag1Correlation()) < 0.5 );
+}
+
+TEST_CASE("TestBatchMeansCapacity", "testBatchMeans")
+{
+    Simulation sim;
+    SimulationContext::Scope scope(sim);
+
+    // few stored batches: they are merged many times
+    StatBatchMeans stat("ar1", 10, 40);
+    BaseStat::init(1);
+    BaseStat::newRun();
+    AR1 p(10);
+    for (int i = 0; i < 100000; ++i) stat.record(p.next());
+
+    stat.analyze();
+    REQUIRE( stat.getObservations() == 100000 );
+    REQUIRE( stat.getBatchMeans().size() == 10 );
+    REQUIRE( fabs(stat.getValue() - 10) < 3 * stat.getBatchConfInterval() );
+
+    vector<double> s;
+    stat.saveState(s);
+    for (int i = 0; i < 1000; ++i) stat.record(0);
+    const double *ptr = &s[0];
+    stat.restoreState(ptr);
+    REQUIRE( stat.getObservations() == 100000 );
+
+    REQUIRE_THROWS( StatBatchMeans("bad", 2) );
+}
@@ -0,0 +1,103 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <bintrace.hpp>
+#include <event.hpp>
+#include <simul.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+using namespace std;
+
+namespace {
+    class Beep : public Event {
+    public:
+        virtual void doit() {}
+    };
+}
+
+TEST_CASE("TestBinaryTraceRoundTrip", "testBinaryTrace")
+{
+    const char *file = "test_bintrace.bin";
+    {
+        // a small buffer, to write in several segments
+        BinaryTrace t(file, 7);
+        for (int i = 0; i < 100; ++i)
+            t.record(Tick(10 * i), i % 3, i % 5, i * 0.5);
+        t.setName(BinaryTrace::TYPE_NAME, 0, "IDLE");
+        t.setName(BinaryTrace::TYPE_NAME, 1, "BUSY");
+        t.setName(BinaryTrace::ENTITY_NAME, 4, "node_4");
+        REQUIRE( t.getRecords() == 100 );
+    }
+
+    BinaryTraceReader r(file, 16);
+    REQUIRE( r.size() == 100 );
+    REQUIRE( r.getName(BinaryTrace::TYPE_NAME, 1) == "BUSY" );
+    REQUIRE( r.getName(BinaryTrace::ENTITY_NAME, 4) == "node_4" );
+    REQUIRE( r.getName(BinaryTrace::ENTITY_NAME, 3) == "3" );
+
+    int n = 0;
+    for (BinaryTraceReader::iterator i = r.begin(); i != r.end(); ++i, ++n) {
+        REQUIRE( i->tick == 10 * n );
+        REQUIRE( i->type == uint32_t(n % 3) );
+        REQUIRE( i->entity == uint32_t(n % 5) );
+        REQUIRE( i->payload == n * 0.5 );
+    }
+    REQUIRE( n == 100 );
+
+    r.rewind();
+    ostringstream os;
+    r.toAscii(os);
+    istringstream is(os.str());
+    string line;
+    getline(is, line);
+    REQUIRE( line == "0\t0\tIDLE" );
+    getline(is, line);
+    REQUIRE( line == "10\t1\tBUSY\t0.5" );
+
+    remove(file);
+}
+
+TEST_CASE("TestBinaryTraceEvents", "testBinaryTrace")
+{
+    const char *file = "test_bintrace_evt.bin";
+    {
+        Simulation sim;
+        SimulationContext::Scope scope(sim);
+        BinaryTrace t(file);
+        Beep b;
+        b.addTrace(&t);
+        b.post(5);
+        sim.run_to(5);
+        b.post(8);
+        sim.run_to(10);
+    }
+
+    BinaryTraceReader r(file);
+    REQUIRE( r.size() == 2 );
+    TraceRecord rec;
+    REQUIRE( r.next(rec) );
+    REQUIRE( rec.tick == 5 );
+    REQUIRE( rec.entity == BinaryTrace::NO_ENTITY );
+    REQUIRE( r.getName(BinaryTrace::TYPE_NAME, rec.type) == typeid(Beep).name() );
+    REQUIRE( r.next(rec) );
+    REQUIRE( rec.tick == 8 );
+    REQUIRE( !r.next(rec) );
+
+    remove(file);
+}
+
+TEST_CASE("TestBinaryTraceBadFile", "testBinaryTrace")
+{
+    const char *file = "test_bintrace_bad.bin";
+    {
+        ofstream os(file);
+        os << "this is not a trace, but it is long enough for a header";
+    }
+    REQUIRE_THROWS_AS( BinaryTraceReader r(file), BinaryTraceReader::Exc );
+    REQUIRE_THROWS_AS( BinaryTraceReader r("no_such_file.bin"), BinaryTraceReader::Exc );
+    remove(file);
+}
@@ -0,0 +1,108 @@
+#include <vector>
+
+#include <randomgen.hpp>
+#include <randomvar.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+using namespace std;
+
+namespace {
+    // fill() on a variable returns the same values of get() on an
+    // identical variable with an identical generator, also across
+    // the blocks taken from the generator
+    template<class V>
+    bool sameAsGet(V &a, V &b, size_t n)
+    {
+        vector<double> v(n);
+        a.fill(&v[0], n);
+        bool ok = true;
+        for (size_t i = 0; i < n; ++i) ok = ok && (v[i] == b.get());
+        return ok;
+    }
+
+    // generators that redefine only sample()
+    class StepGen : public RandomGen {
+        RandNum _n;
+    public:
+        StepGen() : RandomGen(1), _n(0) {}
+        virtual RandNum sample() { return _n = (_n + 7) % 1000; }
+    };
+
+    class OddGen : public Xoshiro256Gen {
+    public:
+        OddGen() : Xoshiro256Gen(1) {}
+        virtual RandNum sample() { return Xoshiro256Gen::sample() | 3; }
+    };
+}
+
+TEST_CASE("TestFillUniform", "testBulkSampling")
+{
+    RandomGen g1(17), g2(17);
+    UniformVar a(-2, 5, &g1), b(-2, 5, &g2);
+    REQUIRE( sameAsGet(a, b, 1000) );
+    REQUIRE( sameAsGet(a, b, 3) );
+
+    Xoshiro256Gen x1(3), x2(3);
+    UniformVar c(0, 1, &x1), d(0, 1, &x2);
+    REQUIRE( sameAsGet(c, d, 777) );
+}
+
+TEST_CASE("TestFillDerivedGen", "testBulkSampling")
+{
+    StepGen g1, g2;
+    UniformVar a(0, 10, &g1), b(0, 10, &g2);
+    REQUIRE( sameAsGet(a, b, 500) );
+
+    OddGen x1, x2;
+    UniformVar c(0, 1, &x1), d(0, 1, &x2);
+    REQUIRE( sameAsGet(c, d, 500) );
+}
+
+TEST_CASE("TestFillDistributions", "testBulkSampling")
+{
+    RandomGen g1(5), g2(5);
+    ExponentialVar e1(3, &g1), e2(3, &g2);
+    REQUIRE( sameAsGet(e1, e2, 600) );
+
+    ParetoVar p1(1, 2.5, &g1), p2(1, 2.5, &g2);
+    REQUIRE( sameAsGet(p1, p2, 600) );
+
+    NormalVar n1(10, 2, &g1), n2(10, 2, &g2);
+    REQUIRE( sameAsGet(n1, n2, 601) );
+
+    PoissonVar q1(4, &g1), q2(4, &g2);
+    REQUIRE( sameAsGet(q1, q2, 100) );
+
+    DeltaVar d1(7), d2(7);
+    REQUIRE( sameAsGet(d1, d2, 10) );
+}
+
+TEST_CASE("TestDrawBuffer", "testBulkSampling")
+{
+    Pcg64Gen g1(9), g2(9), g3(9);
+    ExponentialVar a(2, &g1), b(2, &g2), c(2, &g3);
+
+    // without buffer draw() is get()
+    bool ok = true;
+    for (int i = 0; i < 100; ++i) {
+        double x = b.get();
+        ok = ok && (a.draw() == x) && (c.draw() == x);
+    }
+    REQUIRE( ok );
+
+    // with a buffer, the same sequence
+    a.setBuffer(64);
+    c.setBuffer(10);
+    for (int i = 0; i < 1000; ++i) {
+        double x = b.get();
+        ok = ok && (a.draw() == x) && (c.draw() == x);
+    }
+    REQUIRE( ok );
+
+    // c has taken exactly 1100 values: without buffer it goes on
+    // from the generator
+    c.setBuffer(0);
+    REQUIRE( c.draw() == b.get() );
+}
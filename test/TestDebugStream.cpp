@@ -0,0 +1,76 @@
+// the DBG macros are tested as in a debug build
+#define __DEBUG__
+
+#include <sstream>
+#include <string>
+
+#include <debugstream.hpp>
+#include <simul.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+using namespace std;
+
+namespace {
+    int evaluated = 0;
+
+    int sideEffect()
+    {
+        evaluated++;
+        return 42;
+    }
+
+    void traced()
+    {
+        DBGENTER("TestDebugTraced");
+        DBGPRINT_2("value ", sideEffect());
+    }
+}
+
+TEST_CASE("TestDebugLevelIDs", "testDebug")
+{
+    int a = DebugStream::level("TestDebugA");
+    int b = DebugStream::level("TestDebugB");
+    REQUIRE( a != b );
+    REQUIRE( DebugStream::level("TestDebugA") == a );
+    REQUIRE( DebugStream::levelName(b) == "TestDebugB" );
+
+    DebugStream d;
+    REQUIRE( !d.isEnabled(a) );
+    d.enable("TestDebugA");
+    d.enable("TestDebugA");
+    REQUIRE( d.isEnabled(a) );
+    REQUIRE( !d.isEnabled(b) );
+    d.disable(a);
+    REQUIRE( !d.isEnabled(a) );
+}
+
+TEST_CASE("TestDebugLazy", "testDebug")
+{
+    Simulation sim;
+    SimulationContext::Scope scope(sim);
+    ostringstream os;
+    sim.dbg.setStream(os);
+    evaluated = 0;
+
+    traced();
+    REQUIRE( evaluated == 0 );
+    REQUIRE( os.str().empty() );
+
+    sim.dbg.enable("TestDebugTraced");
+    traced();
+    REQUIRE( evaluated == 1 );
+    REQUIRE( os.str().find("value 42") != string::npos );
+    REQUIRE( os.str().find("traced") != string::npos );
+
+    // outside the time window nothing is formatted
+    os.str("");
+    sim.dbg.setTransitory(10, 20);
+    traced();
+    REQUIRE( evaluated == 1 );
+    REQUIRE( os.str().empty() );
+
+    sim.dbg.disable("TestDebugTraced");
+    sim.dbg.setTransitory(0);
+}
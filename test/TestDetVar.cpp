@@ -0,0 +1,118 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#include <randomvar.hpp>
+#include <regvar.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+using namespace std;
+
+TEST_CASE("TestDetVarText", "testDetVar")
+{
+    {
+        ofstream os("detvar.txt");
+        os << "1 2.5\n-3\n\t4e2\n";
+    }
+    DetVar v("detvar.txt");
+    REQUIRE( v.size() == 4 );
+    REQUIRE( v.get() == 1 );
+    REQUIRE( v.get() == 2.5 );
+    REQUIRE( v.get() == -3 );
+    REQUIRE( v.get() == 400 );
+    REQUIRE( v.get() == 1 );
+    REQUIRE( v.getMinimum() == -3 );
+    REQUIRE( v.getMaximum() == 400 );
+
+    DetVar s("detvar.txt", DetVar::STREAM), l("detvar.txt");
+    bool ok = true;
+    for (int i = 0; i < 10; ++i) ok = ok && (s.get() == l.get());
+    REQUIRE( ok );
+    REQUIRE( s.getMinimum() == -3 );
+    REQUIRE( s.getMaximum() == 400 );
+
+    {
+        ofstream os("detvar.txt");
+        os << "5 1 x 2";
+    }
+    REQUIRE_THROWS( DetVar("detvar.txt") );
+    remove("detvar.txt");
+}
+
+TEST_CASE("TestDetVarParser", "testDetVar")
+{
+    // the same values of strtod(), also when it falls back to it
+    const char *num[] = {
+        "0", "-0", "+7", "0.1", "3.14159", "1e22", "1e23", "2.5e-22",
+        "1.7976931348623157e308", "4.9e-324", "123456789012345",
+        "1234567890123456789", "0.30000000000000004", ".5", "5.",
+        "-12.75E+2", "0x1p3", "inf", "1e0400"
+    };
+    const int n = sizeof(num) / sizeof(num[0]);
+    {
+        ofstream os("detvar.txt");
+        for (int i = 0; i < n; ++i) os << num[i] << "\n";
+    }
+    DetVar v("detvar.txt");
+    REQUIRE( v.size() == size_t(n) );
+    bool ok = true;
+    for (int i = 0; i < n; ++i) ok = ok && (v.get() == strtod(num[i], NULL));
+    REQUIRE( ok );
+    remove("detvar.txt");
+}
+
+TEST_CASE("TestDetVarBlocks", "testDetVar")
+{
+    // several blocks of the reader, with numbers cut at the end
+    // of a block
+    const int N = 300000;
+    {
+        ofstream os("detvar.txt");
+        os.precision(10);
+        for (int i = 0; i < N; ++i) os << i * 0.25 << (i % 7 ? " " : "\n");
+    }
+    DetVar v("detvar.txt");
+    DetVar s("detvar.txt", DetVar::STREAM);
+    REQUIRE( v.size() == size_t(N) );
+    bool ok = true;
+    for (int i = 0; i < N + 10; ++i) {
+        double x = (i % N) * 0.25;
+        ok = ok && (v.get() == x) && (s.get() == x);
+    }
+    REQUIRE( ok );
+    REQUIRE( s.getMaximum() == (N - 1) * 0.25 );
+    remove("detvar.txt");
+}
+
+TEST_CASE("TestDetVarMap", "testDetVar")
+{
+    vector<double> a;
+    for (int i = 0; i < 1000; ++i) a.push_back(i % 13 - 6.5);
+    DetVar::writeBinary("detvar.bin", &a[0], a.size());
+
+    vector<string> par;
+    par.push_back("detvar.bin");
+    par.push_back("map");
+    auto_ptr<RandomVar> m(DetVar::createInstance(par));
+    DetVar v(a);
+    REQUIRE( m->getMinimum() == -6.5 );
+    REQUIRE( m->getMaximum() == 5.5 );
+
+    // fill() goes around the end of the trace as get() does
+    vector<double> out(2500);
+    m->fill(&out[0], out.size());
+    bool ok = true;
+    for (size_t i = 0; i < out.size(); ++i) ok = ok && (out[i] == v.get());
+    for (int i = 0; i < 100; ++i) ok = ok && (m->get() == v.get());
+    REQUIRE( ok );
+
+    // the copies share the mapping
+    DetVar c(*dynamic_cast<DetVar *>(m.get()));
+    REQUIRE( c.size() == a.size() );
+    REQUIRE( c.get() == m->get() );
+    remove("detvar.bin");
+}
@@ -0,0 +1,75 @@
+#include <event.hpp>
+#include <eventqueue.hpp>
+#include <mempool.hpp>
+#include <simul.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+
+namespace {
+    // every packet creates the next one
+    class Packet : public Event {
+        int *_count;
+        int _left;
+    public:
+        Packet(int *c, int left) : Event(), _count(c), _left(left) {}
+        virtual void doit() {
+            (*_count)++;
+            if (_left > 0) 
+                Event::create<Packet>(_count, _left - 1)->post(SIMUL.getTime() + 1, true);
+        }
+    };
+}
+
+TEST_CASE("TestEventPoolReuse", "testEventPool")
+{
+    Simulation sim;
+    SimulationContext::Scope scope(sim);
+    int count = 0;
+
+    for (int i = 0; i < 10; ++i)
+        Event::create<Packet>(&count, 999)->post(i, true);
+    sim.run_to(2000);
+
+    const MemoryPool &pool = sim.getEventPool();
+    REQUIRE( count == 10000 );
+    REQUIRE( pool.getAllocations() == 10000 );
+    REQUIRE( pool.getInUse() == 0 );
+    REQUIRE( pool.getSlabs() == 1 );
+    // all the blocks but the first come from the free list
+    REQUIRE( pool.getReuses() == 10000 - 1 );
+}
+
+TEST_CASE("TestEventPoolQueueNodes", "testEventPool")
+{
+    Simulation sim(EventQueue::SET);
+    SimulationContext::Scope scope(sim);
+    int count = 0;
+
+    for (int i = 0; i < 10; ++i)
+        Event::create<Packet>(&count, 99)->post(i, true);
+    sim.run_to(200);
+    REQUIRE( count == 1000 );
+
+    const MemoryPool *nodes = sim.getEventQueue().getNodePool();
+    REQUIRE( nodes != NULL );
+    REQUIRE( nodes->getAllocations() == 1000 );
+    REQUIRE( nodes->getInUse() == 0 );
+    REQUIRE( nodes->getSlabs() == 1 );
+
+    Simulation heap(EventQueue::QUAD_HEAP);
+    REQUIRE( heap.getEventQueue().getNodePool() == NULL );
+}
+
+TEST_CASE("TestEventPoolClear", "testEventPool")
+{
+    Simulation sim;
+    SimulationContext::Scope scope(sim);
+    int count = 0;
+    for (int i = 0; i < 10; ++i)
+        Event::create<Packet>(&count, 5)->post(i, true);
+    REQUIRE( sim.getEventPool().getInUse() == 10 );
+    sim.clearEventQueue();
+    REQUIRE( sim.getEventPool().getInUse() == 0 );
+}
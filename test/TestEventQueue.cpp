@@ -0,0 +1,208 @@
+#include <cstdlib>
+#include <vector>
+#include <event.hpp>
+#include <eventqueue.hpp>
+#include <simul.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+using namespace std;
+
+class NumberedEvent : public Event {
+public:
+    int num;
+    NumberedEvent(int n, int p) : Event(p), num(n) {}
+    virtual void doit() {}
+};
+
+static void checkQueue(EventQueue::Type t, int range = 50)
+{
+    SIMUL.setEventQueue(t);
+
+    vector<NumberedEvent *> evts;
+    srand(1);
+    for (int i = 0; i < 1000; ++i) {
+        evts.push_back(new NumberedEvent(i, rand() % 3));
+        evts.back()->post(rand() % range);
+    }
+    // drop one event every 7
+    for (int i = 0; i < 1000; i += 7) evts[i]->drop();
+
+    int count = 0;
+    NumberedEvent *last = NULL;
+    Event *e;
+    while ((e = Event::extractFirst()) != NULL) {
+        NumberedEvent *n = static_cast<NumberedEvent *>(e);
+        REQUIRE((n->num % 7) != 0);
+        REQUIRE(!n->isInQueue());
+        if (last != NULL) {
+            REQUIRE(last->getTime() <= n->getTime());
+            if (last->getTime() == n->getTime()) {
+                REQUIRE(last->getPriority() <= n->getPriority());
+                if (last->getPriority() == n->getPriority())
+                    REQUIRE(last->num < n->num);
+            }
+        }
+        last = n;
+        count++;
+    }
+    REQUIRE(count == 1000 - 143);
+
+    for (size_t i = 0; i < evts.size(); ++i) delete evts[i];
+    SIMUL.setEventQueue(EventQueue::DEFAULT);
+}
+
+TEST_CASE("TestEventQueueSet", "testOrder")
+{
+    checkQueue(EventQueue::SET);
+}
+
+TEST_CASE("TestEventQueueBinaryHeap", "testOrder")
+{
+    checkQueue(EventQueue::BINARY_HEAP);
+}
+
+TEST_CASE("TestEventQueueQuadHeap", "testOrder")
+{
+    checkQueue(EventQueue::QUAD_HEAP);
+}
+
+TEST_CASE("TestEventQueuePairingHeap", "testOrder")
+{
+    checkQueue(EventQueue::PAIRING_HEAP);
+}
+
+TEST_CASE("TestEventQueueCalendar", "testOrder")
+{
+    checkQueue(EventQueue::CALENDAR);
+    checkQueue(EventQueue::CALENDAR, 1);
+    checkQueue(EventQueue::CALENDAR, 1000000000);
+}
+
+TEST_CASE("TestEventQueueLadder", "testOrder")
+{
+    checkQueue(EventQueue::LADDER);
+    checkQueue(EventQueue::LADDER, 1);
+    checkQueue(EventQueue::LADDER, 1000000000);
+}
+
+// classical "hold" model: extract the first event and re-post it
+// in the future; all the queues must produce the same sequence
+static vector<int> holdSequence(EventQueue::Type t, int range)
+{
+    SIMUL.setEventQueue(t);
+
+    vector<NumberedEvent *> evts;
+    vector<int> seq;
+    srand(2);
+    for (int i = 0; i < 500; ++i) {
+        evts.push_back(new NumberedEvent(i, rand() % 2));
+        evts.back()->post(rand() % range);
+    }
+    for (int i = 0; i < 20000; ++i) {
+        NumberedEvent *n = static_cast<NumberedEvent *>(Event::extractFirst());
+        seq.push_back(n->num);
+        n->post(n->getTime() + rand() % range);
+    }
+    while (Event::extractFirst() != NULL) ;
+
+    for (size_t i = 0; i < evts.size(); ++i) delete evts[i];
+    SIMUL.setEventQueue(EventQueue::DEFAULT);
+    return seq;
+}
+
+TEST_CASE("TestEventQueueHold", "testSameSequence")
+{
+    int ranges[] = {3, 100, 100000};
+    for (int r = 0; r < 3; ++r) {
+        vector<int> ref = holdSequence(EventQueue::SET, ranges[r]);
+        REQUIRE(holdSequence(EventQueue::BINARY_HEAP, ranges[r]) == ref);
+        REQUIRE(holdSequence(EventQueue::QUAD_HEAP, ranges[r]) == ref);
+        REQUIRE(holdSequence(EventQueue::PAIRING_HEAP, ranges[r]) == ref);
+        REQUIRE(holdSequence(EventQueue::CALENDAR, ranges[r]) == ref);
+        REQUIRE(holdSequence(EventQueue::LADDER, ranges[r]) == ref);
+    }
+}
+
+// many events with very skewed times, so that the ladder queue
+// spreads the crowded buckets on new rungs
+static vector<int> skewSequence(EventQueue::Type t)
+{
+    SIMUL.setEventQueue(t);
+
+    vector<NumberedEvent *> evts;
+    vector<int> seq;
+    srand(4);
+    for (int i = 0; i < 5000; ++i) {
+        evts.push_back(new NumberedEvent(i, rand() % 2));
+        evts.back()->post(rand() % 10 ? rand() % 1000 : rand() % 100000000);
+    }
+    for (int i = 0; i < 20000; ++i) {
+        NumberedEvent *n = static_cast<NumberedEvent *>(Event::extractFirst());
+        seq.push_back(n->num);
+        if (i % 10) n->post(n->getTime() + rand() % 50);
+        // and some in the past of the queue
+        if (i % 100 == 0) evts[rand() % evts.size()]->reschedule(rand() % 1000);
+    }
+    Event *e;
+    while ((e = Event::extractFirst()) != NULL) 
+        seq.push_back(static_cast<NumberedEvent *>(e)->num);
+
+    for (size_t i = 0; i < evts.size(); ++i) delete evts[i];
+    SIMUL.setEventQueue(EventQueue::DEFAULT);
+    return seq;
+}
+
+TEST_CASE("TestEventQueueSkew", "testSameSequence")
+{
+    vector<int> ref = skewSequence(EventQueue::SET);
+    REQUIRE(skewSequence(EventQueue::QUAD_HEAP) == ref);
+    REQUIRE(skewSequence(EventQueue::CALENDAR) == ref);
+    REQUIRE(skewSequence(EventQueue::LADDER) == ref);
+}
+
+// moves random events back and forth: reschedule() must give the
+// same result as drop() + post()
+static vector<int> rescheduleSequence(EventQueue::Type t, bool useDrop)
+{
+    SIMUL.setEventQueue(t);
+
+    vector<NumberedEvent *> evts;
+    vector<int> seq;
+    srand(3);
+    for (int i = 0; i < 300; ++i) {
+        evts.push_back(new NumberedEvent(i, rand() % 2));
+        evts.back()->post(rand() % 100);
+    }
+    for (int i = 0; i < 5000; ++i) {
+        NumberedEvent *n = evts[rand() % evts.size()];
+        Tick when = rand() % 100;
+        if (useDrop) {
+            n->drop();
+            n->post(when);
+        }
+        else n->reschedule(when);
+        REQUIRE(n->isInQueue());
+        REQUIRE(n->getTime() == when);
+    }
+    Event *e;
+    while ((e = Event::extractFirst()) != NULL) 
+        seq.push_back(static_cast<NumberedEvent *>(e)->num);
+
+    for (size_t i = 0; i < evts.size(); ++i) delete evts[i];
+    SIMUL.setEventQueue(EventQueue::DEFAULT);
+    return seq;
+}
+
+TEST_CASE("TestEventQueueReschedule", "testReschedule")
+{
+    vector<int> ref = rescheduleSequence(EventQueue::SET, true);
+    REQUIRE(ref.size() == 300);
+    REQUIRE(rescheduleSequence(EventQueue::SET, false) == ref);
+    REQUIRE(rescheduleSequence(EventQueue::BINARY_HEAP, false) == ref);
+    REQUIRE(rescheduleSequence(EventQueue::QUAD_HEAP, false) == ref);
+    REQUIRE(rescheduleSequence(EventQueue::PAIRING_HEAP, false) == ref);
+    REQUIRE(rescheduleSequence(EventQueue::CALENDAR, false) == ref);
+    REQUIRE(rescheduleSequence(EventQueue::LADDER, false) == ref);
+}
@@ -0,0 +1,146 @@
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <genericvar.hpp>
+#include <randomgen.hpp>
+#include <regvar.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+using namespace std;
+
+namespace {
+    // the value of the old GenericVar::get(), by linear search
+    double linear(const map<int, double> &pdf, double v)
+    {
+        double CDF = 0;
+        for (map<int, double>::const_iterator i = pdf.begin(); i != pdf.end(); ++i) {
+            CDF = CDF + i->second;
+            if (CDF > v) return i->first;
+        }
+        return -1;
+    }
+}
+
+TEST_CASE("TestGenericVarAlias", "testGenericVar")
+{
+    map<int, double> pdf;
+    pdf[1] = 0.1;
+    pdf[2] = 0.2;
+    pdf[5] = 0.3;
+    pdf[9] = 0.35;
+    pdf[12] = 0.05;
+    Xoshiro256Gen g(1);
+    GenericVar v(pdf, &g);
+    REQUIRE( v.getMinimum() == 1 );
+    REQUIRE( v.getMaximum() == 12 );
+
+    const int N = 1000000;
+    map<int, int> count;
+    for (int i = 0; i < N; ++i) count[int(v.get())]++;
+    REQUIRE( count.size() == 5 );
+    bool ok = true;
+    for (map<int, double>::iterator i = pdf.begin(); i != pdf.end(); ++i)
+        ok = ok && fabs(double(count[i->first]) / N - i->second) < 0.003;
+    REQUIRE( ok );
+}
+
+TEST_CASE("TestGenericVarLegacy", "testGenericVar")
+{
+    map<int, double> pdf;
+    for (int k = 0; k < 10; ++k) pdf[k * k] = (k + 1) / 55.0;
+
+    RandomGen g1(3), g2(3);
+    GenericVar v(pdf, &g1);
+    UniformVar u(0, 1, &g2);
+    v.setMethod(RandomVar::LEGACY);
+    bool ok = true;
+    for (int i = 0; i < 10000; ++i) ok = ok && (v.get() == linear(pdf, u.get()));
+    REQUIRE( ok );
+
+    // too many values for the precision of the Park-Miller
+    // generator: the alias method is not used
+    map<int, double> big;
+    for (int k = 0; k < 5000; ++k) big[k] = 1 / 5000.0;
+    RandomGen g3(5), g4(5);
+    GenericVar a(big, &g3), b(big, &g4);
+    b.setMethod(RandomVar::LEGACY);
+    for (int i = 0; i < 10000; ++i) ok = ok && (a.get() == b.get());
+    REQUIRE( ok );
+}
+
+TEST_CASE("TestGenericVarAliasLimit", "testGenericVar")
+{
+    // the alias method is used up to 2048 values with the
+    // Park-Miller generator, and gives a different sequence
+    bool same[2];
+    for (int n = 2048; n <= 2049; ++n) {
+        map<int, double> pdf;
+        double sum = 0;
+        for (int k = 0; k < n; ++k) sum += k % 3 + 1;
+        for (int k = 0; k < n; ++k) pdf[k] = (k % 3 + 1) / sum;
+        RandomGen g1(7), g2(7);
+        GenericVar a(pdf, &g1), b(pdf, &g2);
+        b.setMethod(RandomVar::LEGACY);
+        bool ok = true;
+        for (int i = 0; i < 1000; ++i) ok = ok && (a.get() == b.get());
+        same[n - 2048] = ok;
+    }
+    REQUIRE( !same[0] );
+    REQUIRE( same[1] );
+}
+
+TEST_CASE("TestEmpiricalVar", "testGenericVar")
+{
+    vector<double> x, f;
+    x.push_back(0); f.push_back(0.2);
+    x.push_back(1); f.push_back(0.6);
+    x.push_back(1); f.push_back(0.6);
+    x.push_back(3); f.push_back(1);
+    Xoshiro256Gen g(9);
+    EmpiricalVar v(x, f, &g);
+    REQUIRE( v.getMinimum() == 0 );
+    REQUIRE( v.getMaximum() == 3 );
+
+    const int N = 1000000;
+    int zero = 0, low = 0, high = 0;
+    double sum = 0;
+    for (int i = 0; i < N; ++i) {
+        double y = v.get();
+        sum += y;
+        if (y == 0) zero++;
+        else if (y < 0.5) low++;
+        else if (y > 2) high++;
+    }
+    // 0.2 at 0, 0.4 uniform in (0, 1), 0.4 uniform in (1, 3)
+    REQUIRE( fabs(double(zero) / N - 0.2) < 0.003 );
+    REQUIRE( fabs(double(low) / N - 0.2) < 0.003 );
+    REQUIRE( fabs(double(high) / N - 0.2) < 0.003 );
+    REQUIRE( fabs(sum / N - 1.0) < 0.005 );
+
+    vector<double> bad(f.rbegin(), f.rend());
+    REQUIRE_THROWS( EmpiricalVar(x, bad, &g) );
+}
+
+TEST_CASE("TestEmpiricalVarFile", "testGenericVar")
+{
+    {
+        ofstream os("empirical.txt");
+        os << "10 0\n20 0.5\n40 1\n";
+    }
+    auto_ptr<RandomVar> v(parsevar("empirical(empirical.txt)"));
+    REQUIRE( v->getMinimum() == 10 );
+    REQUIRE( v->getMaximum() == 40 );
+    bool ok = true;
+    for (int i = 0; i < 1000; ++i) {
+        double y = v->get();
+        ok = ok && y >= 10 && y <= 40;
+    }
+    REQUIRE( ok );
+    remove("empirical.txt");
+}
@@ -0,0 +1,93 @@
+#include <string>
+
+#include <basestat.hpp>
+#include <event.hpp>
+#include <simul.hpp>
+#include <trace.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+
+namespace {
+    class Tick1 : public Event {
+    public:
+        std::string *log;
+        Tick1(std::string *l) : Event(), log(l) {}
+        virtual void doit() { *log += "e"; }
+    };
+
+    class LogStat : public StatCount {
+        std::string *_log;
+        char _c;
+    public:
+        LogStat(std::string *l, char c) : StatCount(), _log(l), _c(c) {}
+        virtual void probe(Event *) { *_log += _c; }
+    };
+
+    class LogParticle : public ParticleInterface {
+        std::string *_log;
+        char _c;
+        int *_deleted;
+    public:
+        LogParticle(std::string *l, char c, int *d) :
+            _log(l), _c(c), _deleted(d) {}
+        ~LogParticle() { (*_deleted)++; }
+        virtual void probe() { *_log += _c; }
+    };
+
+    class LogTrace : public Trace {
+        std::string *_log;
+        char _c;
+    public:
+        LogTrace(std::string *l, char c) :
+            Trace("", ASCII, false), _log(l), _c(c) {}
+        virtual void record(Event *) { *_log += _c; }
+    };
+}
+
+TEST_CASE("TestObserverOrder", "testObservers")
+{
+    Simulation sim;
+    SimulationContext::Scope scope(sim);
+    std::string log;
+    int deleted = 0;
+
+    {
+        Tick1 e(&log);
+        LogStat s1(&log, 'S'), s2(&log, 's');
+        LogTrace t1(&log, 'T'), t2(&log, 't');
+
+        // added in mixed order: stats, particles and traces are
+        // invoked in this order, each in order of insertion
+        e.addTrace(&t1);
+        e.addParticle(new LogParticle(&log, 'P', &deleted));
+        e.addStat(&s1);
+        e.addTrace(&t2);
+        e.addStat(&s2);
+        e.addParticle(new LogParticle(&log, 'p', &deleted));
+
+        e.post(1);
+        sim.run_to(1);
+        REQUIRE( log == "eSsPpTt" );
+    }
+    // the particles are owned by the event
+    REQUIRE( deleted == 2 );
+}
+
+TEST_CASE("TestObserverSize", "testObservers")
+{
+    REQUIRE( sizeof(ObserverList) <= 4 * sizeof(void *) );
+
+    ObserverList l;
+    int a, b, c;
+    REQUIRE( l.empty() );
+    l.add(&c, ObserverList::TRACE);
+    l.add(&a, ObserverList::STAT);
+    l.add(&b, ObserverList::PARTICLE);
+    REQUIRE( l.size() == 3 );
+    REQUIRE( l[0].obj == &a );
+    REQUIRE( l[1].obj == &b );
+    REQUIRE( l[2].obj == &c );
+    REQUIRE( l.count(ObserverList::STAT) == 1 );
+}
@@ -0,0 +1,303 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include <entity.hpp>
+#include <event.hpp>
+#include <parallel.hpp>
+#include <randomvar.hpp>
+#include <simul.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+using namespace std;
+
+// tokens hop among the nodes with random delays; every node has
+// its own generator, so the result does not depend on how the
+// nodes are partitioned
+class Node;
+
+class Hop : public Event {
+    Node *_dst;
+public:
+    Hop(Node *n) : Event(), _dst(n) {}
+    virtual void doit();
+};
+
+class Node : public Entity {
+    RandomGen _gen;
+public:
+    vector<Node *> *all;
+    int idx;
+    int lp;
+    bool parallel;
+    int count;
+    long long checksum;
+
+    Node(int i, int p, vector<Node *> *a, bool par) : 
+        Entity("node" + to_string(i)), _gen(i + 1), all(a), idx(i), 
+        lp(p), parallel(par), count(0), checksum(0) {}
+
+    void arrive() {
+        Tick now = SIMUL.getTime();
+        count++;
+        checksum = checksum * 31 + (long int) now;
+
+        Node *dst = (*all)[(idx + 1 + _gen.sample() % 3) % all->size()];
+        Tick t = now + 10 + _gen.sample() % 20;
+        Hop *h = new Hop(dst);
+        if (!parallel || dst->lp == lp) h->post(t, true);
+        else LogicalProcess::current()->send(dst->lp, h, t, true);
+    }
+
+    void newRun() { 
+        count = 0; 
+        checksum = 0; 
+        (new Hop(this))->post(idx % 7, true); 
+    }
+    void endRun() {}
+};
+
+void Hop::doit() { _dst->arrive(); }
+
+static const int NODES = 24;
+
+static void runSequential(vector<int> &count, vector<long long> &sum)
+{
+    Simulation sim;
+    SimulationContext::Scope scope(sim);
+    vector<Node *> nodes;
+    for (int i = 0; i < NODES; ++i) 
+        nodes.push_back(new Node(i, 0, &nodes, false));
+
+    sim.initRuns();
+    sim.initSingleRun();
+    sim.run_to(5000);
+    sim.endSingleRun();
+
+    for (int i = 0; i < NODES; ++i) {
+        count.push_back(nodes[i]->count);
+        sum.push_back(nodes[i]->checksum);
+        delete nodes[i];
+    }
+}
+
+static void runParallel(int nlp, vector<int> &count, vector<long long> &sum)
+{
+    ParallelSimulation ps(nlp);
+    vector<Node *> nodes;
+    for (int i = 0; i < NODES; ++i) {
+        int lp = i * nlp / NODES;
+        SimulationContext::Scope scope(ps.getLP(lp));
+        nodes.push_back(new Node(i, lp, &nodes, true));
+    }
+    for (int i = 0; i < nlp; ++i)
+        for (int j = 0; j < nlp; ++j)
+            if (i != j) ps.connect(i, j, 10);
+
+    ps.run(5000);
+
+    for (int i = 0; i < NODES; ++i) {
+        count.push_back(nodes[i]->count);
+        sum.push_back(nodes[i]->checksum);
+        SimulationContext::Scope scope(ps.getLP(nodes[i]->lp));
+        delete nodes[i];
+    }
+}
+
+TEST_CASE("TestParallelSameResult", "testParallel")
+{
+    vector<int> c1, c2, c4;
+    vector<long long> s1, s2, s4;
+    runSequential(c1, s1);
+    runParallel(2, c2, s2);
+    runParallel(4, c4, s4);
+
+    REQUIRE( c1[0] > 10 );
+    REQUIRE( c1 == c2 );
+    REQUIRE( s1 == s2 );
+    REQUIRE( c1 == c4 );
+    REQUIRE( s1 == s4 );
+}
+
+TEST_CASE("TestParallelLookahead", "testParallel")
+{
+    ParallelSimulation ps(2);
+    REQUIRE_THROWS( ps.connect(0, 1, 0) );
+    ps.connect(0, 1, 10);
+    REQUIRE( ps.getLookahead(0, 1) == 10 );
+    REQUIRE( ps.getLookahead(1, 0) == MAXTICK );
+
+    SimulationContext::Scope scope(ps.getLP(0));
+    Hop h(NULL);
+    REQUIRE( LogicalProcess::current() == &ps.getLP(0) );
+    REQUIRE_THROWS( ps.getLP(0).send(1, &h, 5) );
+    REQUIRE_THROWS( ps.getLP(0).send(0, &h, 50) );
+}
+
+TEST_CASE("TestParallelPooledSend", "testParallel")
+{
+    ParallelSimulation ps(2);
+    ps.connect(0, 1, 10);
+
+    SimulationContext::Scope scope(ps.getLP(0));
+    Hop *h = Event::create<Hop>(nullptr);
+    REQUIRE( h->isPooled() );
+    REQUIRE_THROWS_AS( ps.getLP(0).send(1, h, 50), ParallelSimulation::Exc );
+    REQUIRE( !h->isInQueue() );
+    h->dispose();
+}
+
+// the nodes draw from random variables created without a generator,
+// so they take the generator of their LP; the hops to a node have
+// the index of the node as priority, so that the events with the
+// same time and priority are interchangeable
+class VarNode;
+
+class VarHop : public Event {
+    VarNode *_dst;
+public:
+    VarHop(VarNode *n, int prio) : Event(prio), _dst(n) {}
+    virtual void doit();
+};
+
+class VarNode : public Entity {
+    UniformVar _next;
+    ExponentialVar _delay;
+public:
+    vector<VarNode *> *all;
+    int idx;
+    int lp;
+    bool parallel;
+    long long checksum;
+
+    VarNode(int i, int p, vector<VarNode *> *a, bool par) : 
+        Entity("varnode" + to_string(i)), _next(0, 3), _delay(8),
+        all(a), idx(i), lp(p), parallel(par), checksum(0) {}
+
+    void arrive() {
+        Tick now = SIMUL.getTime();
+        checksum = checksum * 31 + (long int) now;
+
+        VarNode *dst = (*all)[(idx + 1 + int(_next.get())) % all->size()];
+        Tick t = now + 10 + Tick(int64_t(_delay.get()));
+        VarHop *h = new VarHop(dst, dst->idx);
+        if (!parallel || dst->lp == lp) h->post(t, true);
+        else LogicalProcess::current()->send(dst->lp, h, t, true);
+    }
+
+    void newRun() { 
+        checksum = 0; 
+        (new VarHop(this, idx))->post(idx % 7, true); 
+    }
+    void endRun() {}
+};
+
+void VarHop::doit() { _dst->arrive(); }
+
+TEST_CASE("TestParallelDefaultGenerator", "testParallel")
+{
+    const int NLP = 3;
+    RandomGen *before = RandomVar::getGenerator();
+    ParallelSimulation ps(NLP);
+    for (int i = 0; i < NLP; ++i)
+        for (int j = 0; j < NLP; ++j)
+            if (i != j) ps.connect(i, j, 10);
+
+    // the sequential run uses a copy of the generator of each LP
+    // for the nodes of its partition
+    vector<long long> seq;
+    {
+        Simulation sim;
+        SimulationContext::Scope scope(sim);
+        vector<unique_ptr<RandomGen> > gens;
+        for (int p = 0; p < NLP; ++p) 
+            gens.push_back(unique_ptr<RandomGen>(ps.getLP(p).getGenerator().clone()));
+        vector<VarNode *> nodes;
+        for (int i = 0; i < NODES; ++i) {
+            RandomGen *old = RandomVar::changeGenerator(gens[i % NLP].get());
+            nodes.push_back(new VarNode(i, 0, &nodes, false));
+            RandomVar::changeGenerator(old);
+        }
+        sim.initRuns();
+        sim.initSingleRun();
+        sim.run_to(5000);
+        sim.endSingleRun();
+        for (int i = 0; i < NODES; ++i) {
+            seq.push_back(nodes[i]->checksum);
+            delete nodes[i];
+        }
+    }
+
+    vector<VarNode *> nodes;
+    for (int i = 0; i < NODES; ++i) {
+        SimulationContext::Scope scope(ps.getLP(i % NLP));
+        nodes.push_back(new VarNode(i, i % NLP, &nodes, true));
+    }
+    ps.run(5000);
+
+    vector<long long> par;
+    for (int i = 0; i < NODES; ++i) {
+        par.push_back(nodes[i]->checksum);
+        SimulationContext::Scope scope(ps.getLP(nodes[i]->lp));
+        delete nodes[i];
+    }
+    REQUIRE( seq[0] != 0 );
+    REQUIRE( seq == par );
+    REQUIRE( RandomVar::getGenerator() == before );
+}
+
+// the messages with the same time and priority as local events are
+// executed after them, by source LP and sequence number, as in the
+// Time Warp engine
+class TraceEvt : public Event {
+    long long *_trace;
+    int _code;
+public:
+    TraceEvt(long long *t, int code, int prio) : 
+        Event(prio), _trace(t), _code(code) {}
+    virtual void doit() { *_trace = *_trace * 100 + _code; }
+};
+
+class TraceSender : public Event {
+    long long *_trace;
+    vector<int> _codes;
+public:
+    TraceSender(long long *t, const vector<int> &c) : 
+        Event(5), _trace(t), _codes(c) {}
+    virtual void doit() {
+        for (size_t i = 0; i < _codes.size(); ++i) {
+            int prio = _codes[i] >= 30 ? 0 : 5;
+            LogicalProcess::current()->send(2, new TraceEvt(_trace, _codes[i], prio), 
+                                            10, true);
+        }
+    }
+};
+
+TEST_CASE("TestParallelTieOrder", "testParallel")
+{
+    long long trace = 0;
+    ParallelSimulation ps(3);
+    ps.connect(0, 2, 3);
+    ps.connect(1, 2, 3);
+    TraceSender s0(&trace, vector<int>{10, 11}), s1(&trace, vector<int>{20, 21, 30});
+    {
+        SimulationContext::Scope scope(ps.getLP(0));
+        s0.post(7);
+    }
+    {
+        SimulationContext::Scope scope(ps.getLP(1));
+        s1.post(4);
+    }
+    {
+        SimulationContext::Scope scope(ps.getLP(2));
+        for (int i = 0; i < 3; ++i)
+            (new TraceEvt(&trace, 2 + i, 5))->post(10, true);
+    }
+    ps.run(20);
+
+    long long expected = 0;
+    int order[] = { 30, 2, 3, 4, 10, 11, 20, 21 };
+    for (int i = 0; i < 8; ++i) expected = expected * 100 + order[i];
+    REQUIRE( trace == expected );
+}
@@ -0,0 +1,99 @@
+#include <cmath>
+#include <vector>
+
+#include <randomgen.hpp>
+#include <randomvar.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+using namespace std;
+
+namespace {
+    // checks the mean and the variance of n samples of Poisson(l)
+    bool moments(double l, int n)
+    {
+        Xoshiro256Gen g(17);
+        PoissonVar v(l, &g);
+        double sum = 0, sum2 = 0;
+        bool integer = true;
+        for (int i = 0; i < n; ++i) {
+            double x = v.get();
+            integer = integer && x >= 0 && x == floor(x);
+            sum += x;
+            sum2 += x * x;
+        }
+        double m = sum / n;
+        double var = sum2 / n - m * m;
+        // about 5 standard errors
+        return integer && fabs(m - l) < 5 * sqrt(l / n) &&
+            fabs(var / l - 1) < 5 * sqrt(2.0 / n);
+    }
+}
+
+TEST_CASE("TestPoissonMoments", "testPoisson")
+{
+    REQUIRE( moments(0.5, 200000) );
+    REQUIRE( moments(9.5, 200000) );
+    REQUIRE( moments(10, 200000) );
+    REQUIRE( moments(57.3, 200000) );
+    REQUIRE( moments(800, 200000) );
+    REQUIRE( moments(1e6, 200000) );
+}
+
+TEST_CASE("TestPoissonPTRS", "testPoisson")
+{
+    // chi-square against the probabilities of Poisson(30), on
+    // the values from 15 to 45 and the two tails
+    const double l = 30;
+    const int N = 500000;
+    RandomGen g(4);
+    PoissonVar v(l, &g);
+    vector<int> count(33, 0);
+    for (int i = 0; i < N; ++i) {
+        int k = int(v.get());
+        if (k < 15) count[0]++;
+        else if (k > 45) count[32]++;
+        else count[k - 14]++;
+    }
+    vector<double> p(33, 0);
+    for (int k = 0; k < 200; ++k) {
+        double pk = exp(-l + k * log(l) - lgamma(k + 1.0));
+        if (k < 15) p[0] += pk;
+        else if (k > 45) p[32] += pk;
+        else p[k - 14] += pk;
+    }
+    double chi = 0;
+    for (int b = 0; b < 33; ++b)
+        chi += (count[b] - N * p[b]) * (count[b] - N * p[b]) / (N * p[b]);
+    // 32 degrees of freedom: the 99.9% quantile is about 62.5
+    REQUIRE( chi < 62.5 );
+}
+
+TEST_CASE("TestPoissonLegacy", "testPoisson")
+{
+    // the inversion, as in the previous versions
+    RandomGen g1(8), g2(8), g3(8);
+    PoissonVar a(20, &g1), b(4, &g3);
+    UniformVar u(0, 1, &g2);
+    a.setMethod(RandomVar::LEGACY);
+    bool ok = true;
+    for (int i = 0; i < 2000; ++i) {
+        double x = u.get(), F = exp(-20.0), S = F;
+        unsigned int k = 1;
+        for (; k < PoissonVar::CUTOFF; ++k) {
+            if (x < S) break;
+            F = F * 20 / double(k);
+            S += F;
+        }
+        ok = ok && (a.get() == k - 1);
+    }
+    REQUIRE( ok );
+
+    // below SMALL the default is the inversion too
+    RandomGen g4(8);
+    PoissonVar c(4, &g4);
+    c.setMethod(RandomVar::LEGACY);
+    for (int i = 0; i < 2000; ++i) ok = ok && (b.get() == c.get());
+    REQUIRE( ok );
+}
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <quantile.hpp>
+#include <simul.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+using namespace std;
+
+namespace {
+    // 1..n in a scrambled order
+    vector<double> samples(int n)
+    {
+        vector<double> v;
+        for (int i = 1; i <= n; ++i) v.push_back(i);
+        unsigned long s = 12345;
+        for (int i = n - 1; i > 0; --i) {
+            s = s * 6364136223846793005UL + 1442695040888963407UL;
+            swap(v[i], v[(s >> 33) % (i + 1)]);
+        }
+        return v;
+    }
+
+    bool near(double x, double y, double rel)
+    {
+        return fabs(x - y) <= rel * fabs(y);
+    }
+}
+
+TEST_CASE("TestTDigest", "testQuantile")
+{
+    vector<double> v = samples(100000);
+    TDigest d;
+    for (size_t i = 0; i < v.size(); ++i) d.add(v[i]);
+
+    REQUIRE( d.count() == 100000 );
+    REQUIRE( d.centroids() < 200 );
+    REQUIRE( d.min() == 1 );
+    REQUIRE( d.max() == 100000 );
+    REQUIRE( near(d.quantile(0.5), 50000, 0.01) );
+    REQUIRE( near(d.quantile(0.99), 99000, 0.001) );
+    REQUIRE( near(d.quantile(0.999), 99900, 0.0002) );
+
+    // two halves merged
+    TDigest a, b;
+    for (size_t i = 0; i < v.size(); ++i) 
+        ((i % 2) ? a : b).add(v[i]);
+    a.merge(b);
+    REQUIRE( a.count() == 100000 );
+    REQUIRE( near(a.quantile(0.99), 99000, 0.001) );
+
+    vector<double> s;
+    a.save(s);
+    TDigest c;
+    const double *p = &s[0];
+    c.restore(p);
+    REQUIRE( p == &s[0] + s.size() );
+    REQUIRE( c.quantile(0.99) == a.quantile(0.99) );
+}
+
+TEST_CASE("TestHdrHistogram", "testQuantile")
+{
+    vector<double> v = samples(100000);
+    HdrHistogram h(1e6, 3);
+    for (size_t i = 0; i < v.size(); ++i) h.add(v[i]);
+
+    REQUIRE( h.count() == 100000 );
+    REQUIRE( h.quantile(0.5) >= 50000 );
+    REQUIRE( near(h.quantile(0.5), 50000, 0.001) );
+    REQUIRE( near(h.quantile(0.99), 99000, 0.001) );
+    REQUIRE( h.quantile(1) == 100000 );
+    REQUIRE( h.quantile(0) == 1 );
+
+    // the small values are exact
+    HdrHistogram e(1e6, 3);
+    for (int i = 0; i < 100; ++i) e.add(i % 10);
+    REQUIRE( e.quantile(0.5) == 4 );
+    REQUIRE( e.quantile(0.95) == 9 );
+
+    HdrHistogram a(1e6, 3), b(1e6, 3);
+    for (size_t i = 0; i < v.size(); ++i) 
+        ((i % 2) ? a : b).add(v[i]);
+    a.merge(b);
+    REQUIRE( a.quantile(0.99) == h.quantile(0.99) );
+
+    HdrHistogram other(1e6, 2);
+    REQUIRE_THROWS( a.merge(other) );
+}
+
+TEST_CASE("TestStatQuantileRuns", "testQuantile")
+{
+    Simulation sim;
+    SimulationContext::Scope scope(sim);
+
+    StatQuantile p2("p2", 0.99);
+    StatTDigest td("td", 0.99);
+    StatHistogram hdr("hdr", 0.99, 1e6);
+
+    vector<double> v = samples(20000);
+    BaseStat::init(3);
+    for (int run = 0; run < 3; ++run) {
+        BaseStat::newRun();
+        for (size_t i = 0; i < v.size(); ++i) {
+            double x = v[i] + run * 1000;
+            p2.record(x);
+            td.record(x);
+            hdr.record(x);
+        }
+        BaseStat::endRun();
+    }
+    BaseStat::endSim();
+
+    // p99 of run r is 19800 + 1000 r
+    REQUIRE( near(p2.getLastValue(), 21800, 0.01) );
+    REQUIRE( near(td.getLastValue(), 21800, 0.002) );
+    REQUIRE( near(hdr.getLastValue(), 21800, 0.002) );
+    REQUIRE( near(td.getMean(), 20800, 0.002) );
+    REQUIRE( near(hdr.getMean(), 20800, 0.002) );
+
+    // all the samples of the three runs
+    REQUIRE( td.getPooled().count() == 60000 );
+    REQUIRE( hdr.getPooled().count() == 60000 );
+    REQUIRE( near(td.getPooled().quantile(0.5), 11000, 0.01) );
+    REQUIRE( near(hdr.getPooled().quantile(0.5), 11000, 0.002) );
+}
+
+TEST_CASE("TestStatQuantileFewSamples", "testQuantile")
+{
+    Simulation sim;
+    SimulationContext::Scope scope(sim);
+
+    StatQuantile med("med", 0.5);
+    BaseStat::init(1);
+    BaseStat::newRun();
+    med.record(3);
+    REQUIRE( med.getValue() == 3 );
+    med.record(1);
+    med.record(2);
+    REQUIRE( med.getValue() == 2 );
+
+    vector<double> s;
+    med.saveState(s);
+    med.record(100);
+    const double *p = &s[0];
+    med.restoreState(p);
+    REQUIRE( med.getValue() == 2 );
+}
@@ -0,0 +1,121 @@
+#include <cmath>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include <randomgen.hpp>
+#include <randomvar.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+using namespace std;
+
+TEST_CASE("TestXoshiroReference", "testRandomGen")
+{
+    Xoshiro256Gen g;
+    vector<uint64_t> s;
+    s.push_back(1); s.push_back(2); s.push_back(3); s.push_back(4);
+    const uint64_t *p = &s[0];
+    g.setState(p);
+    REQUIRE( g.next() == 11520ULL );
+    REQUIRE( g.next() == 0ULL );
+    REQUIRE( g.next() == 1509978240ULL );
+    REQUIRE( g.next() == 1215971899390074240ULL );
+}
+
+TEST_CASE("TestPcg64Reference", "testRandomGen")
+{
+    Pcg64Gen g(42, 54);
+    REQUIRE( g.next() == 0x86b1da1d72062b68ULL );
+    REQUIRE( g.next() == 0x1304aa46c9853d39ULL );
+    REQUIRE( g.next() == 0xa3670e9e0dd50358ULL );
+
+    // advance() is the same as drawing the numbers
+    Pcg64Gen a(7), b(7);
+    for (int i = 0; i < 1000; ++i) a.next();
+    b.advance(1000);
+    REQUIRE( a.next() == b.next() );
+}
+
+TEST_CASE("TestPhiloxReference", "testRandomGen")
+{
+    // the known answer of Random123 for null key and counter
+    PhiloxGen g(0);
+    REQUIRE( g.next() == 0xe169c58d6627e8d5ULL );
+    REQUIRE( g.next() == 0x9b00dbd8bc57ac4cULL );
+
+    PhiloxGen a(5), b(5);
+    for (int i = 0; i < 10; ++i) a.next();
+    b.setCounter(5, 0);
+    REQUIRE( a.next() == b.next() );
+}
+
+namespace {
+    // checks the range and the mean of sample(), and that split
+    // and copied generators behave as expected
+    void checkGenerator(RandomGen &g)
+    {
+        double sum = 0;
+        const int N = 100000;
+        bool inRange = true;
+        for (int i = 0; i < N; ++i) {
+            RandNum x = g.sample();
+            if (x <= 0 || x >= g.getModule()) inRange = false;
+            sum += double(x) / g.getModule();
+        }
+        REQUIRE( inRange );
+        REQUIRE( fabs(sum / N - 0.5) < 0.01 );
+
+        // the state can be saved and restored
+        vector<uint64_t> s;
+        g.getState(s);
+        RandNum a = g.sample();
+        const uint64_t *p = &s[0];
+        g.setState(p);
+        REQUIRE( p == &s[0] + s.size() );
+        REQUIRE( g.sample() == a );
+
+        // a split generator starts a different sequence
+        unique_ptr<RandomGen> c(g.split());
+        unique_ptr<RandomGen> d(g.splitLong());
+        set<RandNum> seen;
+        for (int i = 0; i < 1000; ++i) {
+            seen.insert(g.sample());
+            seen.insert(c->sample());
+            seen.insert(d->sample());
+        }
+        REQUIRE( seen.size() == 3000 );
+
+        unique_ptr<RandomGen> e(g.clone());
+        REQUIRE( e->sample() == g.sample() );
+    }
+}
+
+TEST_CASE("TestGenerators", "testRandomGen")
+{
+    Xoshiro256Gen x(3);
+    checkGenerator(x);
+    Pcg64Gen p(3);
+    checkGenerator(p);
+    PhiloxGen f(3);
+    checkGenerator(f);
+
+    // the random variables use the new generators like the old one
+    Xoshiro256Gen g(11);
+    RandomGen *old = RandomVar::changeGenerator(&g);
+    UniformVar u(2, 4);
+    ExponentialVar e(3);
+    RandomVar::changeGenerator(old);
+    double su = 0, se = 0;
+    bool inRange = true;
+    for (int i = 0; i < 100000; ++i) {
+        double v = u.get();
+        if (v <= 2 || v >= 4) inRange = false;
+        su += v;
+        se += e.get();
+    }
+    REQUIRE( inRange );
+    REQUIRE( fabs(su / 100000 - 3) < 0.01 );
+    REQUIRE( fabs(se / 100000 - 3) < 0.05 );
+}
@@ -0,0 +1,141 @@
+#include <thread>
+#include <entity.hpp>
+#include <simul.hpp>
+#include "myentity.hpp"
+#include <catch.hpp>
+
+using namespace MetaSim;
+
+TEST_CASE("TestSimulationContextTwoSims", "testIndependent")
+{
+    Simulation s1, s2;
+    {
+        SimulationContext::Scope scope(s1);
+        MyEntity e1("same");
+        {
+            SimulationContext::Scope scope2(s2);
+            MyEntity e2("same");   // no clash: different registry
+
+            REQUIRE( Entity::_find("same") == &e2 );
+            REQUIRE( &SIMUL == &s2 );
+            s2.run(22);
+            REQUIRE( e2.getCounter() == 3 );
+        }
+        REQUIRE( Entity::_find("same") == &e1 );
+        REQUIRE( s2.getTime() == 0 );
+
+        // s1 was not touched by the run of s2
+        s1.run(12);
+        REQUIRE( e1.getCounter() == 2 );
+    }
+    REQUIRE( !s1.isCurrent() );
+    REQUIRE( !s2.isCurrent() );
+}
+
+static void runInThread(int *counter)
+{
+    Simulation sim;
+    SimulationContext::Scope scope(sim);
+    MyEntity e("Pippo");
+    SIMUL.run(12);
+    *counter = e.getCounter();
+}
+
+TEST_CASE("TestSimulationContextThreads", "testThreads")
+{
+    int c1 = 0, c2 = 0;
+    std::thread t1(runInThread, &c1);
+    std::thread t2(runInThread, &c2);
+    t1.join();
+    t2.join();
+    REQUIRE( c1 == 2 );
+    REQUIRE( c2 == 2 );
+}
+
+#include <basestat.hpp>
+#include <gevent.hpp>
+#include <randomvar.hpp>
+
+class Arrivals : public Entity {
+    GEvent<Arrivals> _arrival;
+    UniformVar _interval;
+    StatCount _count;
+public:
+    Arrivals() : Entity("arrivals"), _interval(1, 10), _count("count") 
+    {
+        register_handler(_arrival, this, &Arrivals::onArrival);
+    }
+    void onArrival(Event *) 
+    {
+        _count.record(1);
+        _arrival.post(SIMUL.getTime() + Tick(_interval.get()));
+    }
+    void newRun() { _arrival.post(0); }
+    void endRun() {}
+    double mean() { return _count.getMean(); }
+    double conf() { return _count.getConfInterval(); }
+    BaseStat *stat() { return &_count; }
+};
+
+static void runParallel(int threads, double &mean, double &conf)
+{
+    Simulation::ModelFactory f = [] () { 
+        return std::make_shared<Arrivals>(); 
+    };
+    RandomVar::init(12345);
+    Simulation sim;
+    SimulationContext::Scope scope(sim);
+    std::shared_ptr<Arrivals> m = std::static_pointer_cast<Arrivals>(f());
+    sim.run_parallel(1000, 20, threads, f);
+    mean = m->mean();
+    conf = m->conf();
+}
+
+TEST_CASE("TestSimulationRunParallel", "testRunParallel")
+{
+    double m1, c1, m4, c4;
+    runParallel(1, m1, c1);
+    runParallel(4, m4, c4);
+    REQUIRE( m1 == m4 );
+    REQUIRE( c1 == c4 );
+    REQUIRE( m1 > 150 );
+    REQUIRE( m1 < 250 );
+    REQUIRE( c1 > 0 );
+}
+
+TEST_CASE("TestSimulationRunToPrecision", "testRunToPrecision")
+{
+    Simulation sim;
+    SimulationContext::Scope scope(sim);
+    RandomVar::init(777);
+    Arrivals a;
+    BaseStat::List l;
+    l.push_back(a.stat());
+
+    size_t n = sim.run_to_precision(1000, 0.005, l, BaseStat::C95, 5, 500);
+    REQUIRE( n > 5 );
+    REQUIRE( n < 500 );
+    REQUIRE( a.stat()->getExpNum() == n );
+    REQUIRE( a.stat()->hasPrecision(0.005) );
+    REQUIRE( !a.stat()->hasPrecision(0.0001) );
+
+    // a looser precision is reached with less runs
+    REQUIRE( sim.run_to_precision(1000, 0.02, l) < n );
+}
+
+TEST_CASE("TestSimulationRunParallelToPrecision", "testRunToPrecision")
+{
+    Simulation::ModelFactory f = [] () { 
+        return std::make_shared<Arrivals>(); 
+    };
+    Simulation sim;
+    SimulationContext::Scope scope(sim);
+    RandomVar::init(777);
+    std::shared_ptr<Arrivals> m = std::static_pointer_cast<Arrivals>(f());
+
+    size_t n = sim.run_parallel_to_precision(1000, 0.005, 4, f);
+    REQUIRE( n > 5 );
+    REQUIRE( n < 1000 );
+    REQUIRE( m->stat()->getExpNum() == n );
+    REQUIRE( m->stat()->hasPrecision(0.005) );
+}
@@ -0,0 +1,116 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <bintrace.hpp>
+#include <statetrace.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+using namespace std;
+
+namespace {
+    string readFile(const char *name)
+    {
+        ifstream is(name);
+        stringstream ss;
+        ss << is.rdbuf();
+        return ss.str();
+    }
+
+    void fill(StateTrace &t)
+    {
+        uint32_t a = t.entity("Node_A");
+        uint32_t b = t.entity("Node_B");
+        uint32_t idle = t.state("IDLE");
+        uint32_t busy = t.state("BUSY");
+        REQUIRE( t.entity("Node_A") == a );
+        REQUIRE( t.state("BUSY") == busy );
+
+        t.record(Tick(0), a, idle);
+        t.record(Tick(12), b, busy);
+        t.record(Tick(int64_t(1234567890123LL)), a, busy);
+    }
+
+    const char *expected =
+        "0\tNode_A\tIDLE\n"
+        "12\tNode_B\tBUSY\n"
+        "1234567890123\tNode_A\tBUSY\n";
+}
+
+TEST_CASE("TestStateTraceAscii", "testStateTrace")
+{
+    const char *file = "test_statetrace.txt";
+    {
+        // a tiny buffer, to flush in the middle of the records
+        StateTrace t(file, Trace::ASCII, 20);
+        fill(t);
+    }
+    REQUIRE( readFile(file) == expected );
+
+    {
+        // the IDs remain valid in the new file
+        StateTrace t(file);
+        uint32_t a = t.entity("Node_A");
+        uint32_t idle = t.state("IDLE");
+        t.record(Tick(5), a, idle);
+        t.reopen("test_statetrace2.txt");
+        t.record(Tick(-3), a, idle);
+    }
+    REQUIRE( readFile(file) == "5\tNode_A\tIDLE\n" );
+    REQUIRE( readFile("test_statetrace2.txt") == "-3\tNode_A\tIDLE\n" );
+    remove(file);
+    remove("test_statetrace2.txt");
+}
+
+TEST_CASE("TestStateTraceBinary", "testStateTrace")
+{
+    const char *file = "test_statetrace.bin";
+    {
+        StateTrace t(file, Trace::BINARY);
+        fill(t);
+    }
+
+    // converted to text, the trace is the same as the ascii one
+    BinaryTraceReader r(file);
+    REQUIRE( r.size() == 3 );
+    stringstream ss;
+    r.toAscii(ss);
+    REQUIRE( ss.str() == expected );
+    remove(file);
+}
+
+TEST_CASE("TestStateTraceOpen", "testStateTrace")
+{
+    // open() starts the file again, keeping the type and the IDs
+    const char *file = "test_statetrace_open.txt";
+    {
+        StateTrace t(file);
+        uint32_t a = t.entity("Node_A");
+        uint32_t idle = t.state("IDLE");
+        t.record(Tick(5), a, idle);
+        t.open();
+        t.record(Tick(7), a, idle);
+    }
+    REQUIRE( readFile(file) == "7\tNode_A\tIDLE\n" );
+    remove(file);
+
+    const char *bin = "test_statetrace_open.bin";
+    {
+        StateTrace t(bin, Trace::BINARY);
+        uint32_t a = t.entity("Node_A");
+        uint32_t idle = t.state("IDLE");
+        t.record(Tick(5), a, idle);
+        t.open(Trace::ASCII);
+        t.record(Tick(7), a, idle);
+        t.record(Tick(8), a, idle);
+    }
+    BinaryTraceReader r(bin);
+    REQUIRE( r.size() == 2 );
+    stringstream ss;
+    r.toAscii(ss);
+    REQUIRE( ss.str() == "7\tNode_A\tIDLE\n8\tNode_A\tIDLE\n" );
+    remove(bin);
+}
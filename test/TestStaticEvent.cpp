@@ -0,0 +1,72 @@
+#include <memory>
+
+#include <event.hpp>
+#include <gevent.hpp>
+#include <simul.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+
+namespace {
+    class Counter {
+    public:
+        int count;
+        Tick last;
+        Counter() : count(0), last(0) {}
+        void onEvent(Event *e) { count++; last = e->getTime(); }
+    };
+}
+
+TEST_CASE("TestStaticEvent", "testStaticEvent")
+{
+    Simulation sim;
+    SimulationContext::Scope scope(sim);
+    Counter c;
+    StaticEvent<Counter, &Counter::onEvent> e(&c);
+
+    e.post(3);
+    sim.run_to(10);
+    REQUIRE( c.count == 1 );
+    REQUIRE( c.last == 3 );
+    REQUIRE( e.getObject() == &c );
+}
+
+TEST_CASE("TestFunctionEvent", "testStaticEvent")
+{
+    Simulation sim;
+    SimulationContext::Scope scope(sim);
+    int count = 0;
+
+    // small capture: stored in the event
+    FunctionEvent e([&count] (Event *) { count++; });
+    REQUIRE( e.isLocal() );
+    e.post(1);
+
+    // large capture: stored on the heap, and destroyed with the event
+    std::shared_ptr<int> p(new int(5));
+    {
+        double pad[FunctionEvent::BUFFER_SIZE / sizeof(double) + 1] = {0};
+        FunctionEvent f([p, pad, &count] (Event *) { count += *p + int(pad[0]); });
+        REQUIRE( !f.isLocal() );
+        REQUIRE( p.use_count() == 2 );
+        f.post(2);
+        sim.run_to(2);
+    }
+    REQUIRE( count == 6 );
+    REQUIRE( p.use_count() == 1 );
+
+    // disposable events from the pool
+    for (int i = 0; i < 10; ++i)
+        Event::create<FunctionEvent>([&count] (Event *) { count++; })
+            ->post(3 + i, true);
+    sim.run_to(20);
+    REQUIRE( count == 16 );
+    REQUIRE( sim.getEventPool().getInUse() == 0 );
+
+    // without handler
+    FunctionEvent n;
+    n.post(21);
+    sim.run_to(21);
+    REQUIRE( count == 16 );
+}
@@ -0,0 +1,97 @@
+#include <cmath>
+
+#include <basestat.hpp>
+#include <event.hpp>
+#include <simul.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+using namespace std;
+
+namespace {
+    // sets the value of the two stats at the given times
+    class Change : public Event {
+        StatTimeIntegral &_i;
+        StatTimeAverage &_a;
+        double _v;
+    public:
+        Change(StatTimeIntegral &i, StatTimeAverage &a, double v) : 
+            Event(), _i(i), _a(a), _v(v) {}
+        virtual void doit() { _i.record(_v); _a.record(_v); }
+    };
+}
+
+TEST_CASE("TestTimeAverage", "testTimeStat")
+{
+    Simulation sim;
+    SimulationContext::Scope scope(sim);
+
+    StatTimeIntegral integral("integral");
+    StatTimeAverage average("average");
+
+    // 0 in [0, 10), 4 in [10, 30), 1 in [30, 100); the last
+    // event ends the run at 100
+    Change c1(integral, average, 4);
+    Change c2(integral, average, 1);
+    Change c3(integral, average, 1);
+    c1.post(Tick(10));
+    c2.post(Tick(30));
+    c3.post(Tick(100));
+    sim.run(100);
+
+    REQUIRE( integral.getLastValue() == 150 );
+    REQUIRE( average.getLastValue() == 1.5 );
+
+    // the interval before 20 is discarded
+    BaseStat::setTransitory(20);
+    c1.post(Tick(10));
+    c2.post(Tick(30));
+    c3.post(Tick(100));
+    sim.run(100);
+    BaseStat::setTransitory(0);
+
+    REQUIRE( integral.getLastValue() == 110 );
+    REQUIRE( average.getLastValue() == 110.0 / 80 );
+}
+
+namespace {
+    // records 0.1 every tick
+    class Ticker : public Event {
+        StatTimeIntegral &_i;
+        StatMean &_m;
+    public:
+        Ticker(StatTimeIntegral &i, StatMean &m) : Event(), _i(i), _m(m) {}
+        virtual void doit() 
+            { 
+                _i.record(0.1); 
+                _m.record(0.1);
+                post(getTime() + 1);
+            }
+    };
+}
+
+TEST_CASE("TestTimeIntegralPrecision", "testTimeStat")
+{
+    Simulation sim;
+    SimulationContext::Scope scope(sim);
+
+    StatTimeIntegral integral("integral");
+    StatMean mean("mean");
+
+    // many intervals of length 1 with a value that is not exact
+    // in binary
+    const int N = 1000000;
+    Ticker t(integral, mean);
+    t.post(Tick(0));
+    sim.run(N);
+    REQUIRE( fabs(integral.getLastValue() - 0.1 * N) < 1e-7 );
+    REQUIRE( fabs(mean.getLastValue() - 0.1) < 1e-15 );
+
+    vector<double> s;
+    integral.saveState(s);
+    integral.record(5);
+    const double *p = &s[0];
+    integral.restoreState(p);
+    REQUIRE( integral.getLevel() == 0.1 );
+}
@@ -0,0 +1,365 @@
+#include <string>
+#include <vector>
+#include <basestat.hpp>
+#include <entity.hpp>
+#include <event.hpp>
+#include <randomvar.hpp>
+#include <rollback.hpp>
+#include <simul.hpp>
+#include <timewarp.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+using namespace std;
+
+// same model as in TestParallel.cpp, but the delays can be zero,
+// and the state of the nodes is declared for rollback
+namespace {
+
+    class TWNode;
+
+    class TWHop : public Event {
+        TWNode *_dst;
+    public:
+        TWHop(TWNode *n) : Event(), _dst(n) {}
+        virtual void doit();
+    };
+
+    class TWNode : public Entity {
+        Rollback<RandomGen> _gen;
+    public:
+        vector<TWNode *> *all;
+        int idx;
+        int lp;
+        bool parallel;
+        Rollback<int> count;
+        Rollback<long long> checksum;
+        StatCount stat;
+
+        TWNode(int i, int p, vector<TWNode *> *a, bool par) : 
+            Entity("twnode" + to_string(i)), _gen(RandomGen(i + 1)), 
+            all(a), idx(i), lp(p), parallel(par), count(0), checksum(0),
+            stat("twstat" + to_string(i)) {}
+
+        void arrive() {
+            Tick now = SIMUL.getTime();
+            count = count + 1;
+            checksum = checksum * 31 + (long int) now;
+            stat.record(1);
+
+            TWNode *dst = (*all)[(idx + 1 + _gen.write().sample() % 3) % all->size()];
+            Tick t = now + _gen.write().sample() % 20;
+            TWHop *h = new TWHop(dst);
+            if (!parallel || dst->lp == lp) h->post(t, true);
+            else TimeWarpLP::current()->send(dst->lp, h, t, true);
+        }
+
+        void newRun() { 
+            count = 0; 
+            checksum = 0; 
+            (new TWHop(this))->post(idx % 7, true); 
+        }
+        void endRun() {}
+    };
+
+    void TWHop::doit() { _dst->arrive(); }
+
+    const int NODES = 24;
+
+    struct Result {
+        vector<int> count;
+        vector<long long> sum;
+        vector<double> stat;
+    };
+
+    void collect(vector<TWNode *> &nodes, Result &r)
+    {
+        for (int i = 0; i < NODES; ++i) {
+            r.count.push_back(nodes[i]->count);
+            r.sum.push_back(nodes[i]->checksum);
+            r.stat.push_back(nodes[i]->stat.getMean());
+        }
+    }
+}
+
+static void runSequential(Result &r)
+{
+    Simulation sim;
+    SimulationContext::Scope scope(sim);
+    vector<TWNode *> nodes;
+    for (int i = 0; i < NODES; ++i) 
+        nodes.push_back(new TWNode(i, 0, &nodes, false));
+
+    sim.initRuns();
+    sim.initSingleRun();
+    sim.run_to(3000);
+    sim.endSingleRun();
+    BaseStat::endSim();
+
+    collect(nodes, r);
+    for (int i = 0; i < NODES; ++i) delete nodes[i];
+}
+
+static void runTimeWarp(int nlp, size_t batch, Result &r)
+{
+    TimeWarpSimulation tw(nlp);
+    tw.setBatch(batch);
+    vector<TWNode *> nodes;
+    for (int i = 0; i < NODES; ++i) {
+        int lp = i % nlp;
+        SimulationContext::Scope scope(tw.getLP(lp));
+        nodes.push_back(new TWNode(i, lp, &nodes, true));
+    }
+
+    tw.run(3000);
+
+    collect(nodes, r);
+    for (int i = 0; i < NODES; ++i) {
+        SimulationContext::Scope scope(tw.getLP(nodes[i]->lp));
+        delete nodes[i];
+    }
+}
+
+TEST_CASE("TestTimeWarpSameResult", "testTimeWarp")
+{
+    Result r1, r2, r4;
+    runSequential(r1);
+    runTimeWarp(2, 50, r2);
+    runTimeWarp(4, 1000, r4);
+
+    REQUIRE( r1.count[0] > 10 );
+    REQUIRE( r1.count == r2.count );
+    REQUIRE( r1.sum == r2.sum );
+    REQUIRE( r1.stat == r2.stat );
+    REQUIRE( r1.count == r4.count );
+    REQUIRE( r1.sum == r4.sum );
+    REQUIRE( r1.stat == r4.stat );
+}
+
+TEST_CASE("TestTimeWarpRollbackVar", "testTimeWarp")
+{
+    UndoLog log;
+    Rollback<int> a(1);
+    a = 2;                       // no active log: not recorded
+    REQUIRE( log.mark() == 0 );
+
+    UndoLog::activate(&log);
+    log.newEpoch();
+    size_t m = log.mark();
+    a = 3;
+    a = 4;                       // saved only once per epoch
+    REQUIRE( log.mark() == m + 1 );
+    log.newEpoch();
+    a = 5;
+    UndoLog::activate(NULL);
+
+    log.undo(m + 1);
+    REQUIRE( a == 4 );
+    log.undo(m);
+    REQUIRE( a == 2 );
+}
+
+// the messages with the same time and priority as local events are
+// executed in a fixed order: the local events first, then the
+// messages by depth, source and sequence number; a message with a
+// higher priority comes before them
+namespace {
+
+    class TraceEvt : public Event {
+        Rollback<long long> *_trace;
+        int _code;
+    public:
+        TraceEvt(Rollback<long long> *t, int code, int prio) : 
+            Event(prio), _trace(t), _code(code) {}
+        virtual void doit() { *_trace = *_trace * 100 + _code; }
+    };
+
+    // sends the messages with the given codes to LP 2, at time 10
+    class TraceSender : public Event {
+        Rollback<long long> *_trace;
+        vector<int> _codes;
+        int _prio;
+    public:
+        TraceSender(Rollback<long long> *t, const vector<int> &c, int prio) : 
+            Event(prio), _trace(t), _codes(c), _prio(prio) {}
+        virtual void doit() {
+            for (size_t i = 0; i < _codes.size(); ++i) {
+                int prio = _codes[i] >= 30 ? 0 : 5;
+                TimeWarpLP::current()->send(2, new TraceEvt(_trace, _codes[i], prio), 
+                                            10, true);
+            }
+        }
+    };
+
+    long long tieTrace(size_t batch)
+    {
+        Rollback<long long> trace(0);
+        TimeWarpSimulation tw(3);
+        tw.setBatch(batch);
+        vector<Event *> evts;
+        {
+            SimulationContext::Scope scope(tw.getLP(0));
+            evts.push_back(new TraceSender(&trace, vector<int>{10, 11}, 5));
+            evts.back()->post(3);
+            // same time and priority as the messages: depth 1
+            evts.push_back(new TraceSender(&trace, vector<int>{12}, 5));
+            evts.back()->post(10);
+        }
+        {
+            SimulationContext::Scope scope(tw.getLP(1));
+            evts.push_back(new TraceSender(&trace, vector<int>{20, 21, 30}, 5));
+            evts.back()->post(7);
+        }
+        {
+            SimulationContext::Scope scope(tw.getLP(2));
+            for (int i = 0; i < 3; ++i)
+                (new TraceEvt(&trace, 2 + i, 5))->post(10, true);
+        }
+        tw.run(20);
+        for (int i = 0; i < 3; ++i) {
+            SimulationContext::Scope scope(tw.getLP(i < 2 ? 0 : 1));
+            delete evts[i];
+        }
+        return trace;
+    }
+}
+
+TEST_CASE("TestTimeWarpTieOrder", "testTimeWarp")
+{
+    long long expected = 0;
+    int order[] = { 30, 2, 3, 4, 10, 11, 20, 21, 12 };
+    for (int i = 0; i < 9; ++i) expected = expected * 100 + order[i];
+
+    bool ok = true;
+    for (int r = 0; r < 20; ++r) 
+        ok = ok && (tieTrace(1 + r % 4) == expected) && (tieTrace(1000) == expected);
+    REQUIRE( ok );
+}
+
+TEST_CASE("TestTimeWarpMessageBeforeSender", "testTimeWarp")
+{
+    // a message at the current time with a higher priority (30
+    // has priority 0) than the sending event
+    Rollback<long long> trace(0);
+    TimeWarpSimulation tw(3);
+    TraceSender *s;
+    {
+        SimulationContext::Scope scope(tw.getLP(0));
+        s = new TraceSender(&trace, vector<int>{30}, 5);
+        s->post(10);
+    }
+    REQUIRE_THROWS_AS( tw.run(20), TimeWarpSimulation::Exc );
+    SimulationContext::Scope scope(tw.getLP(0));
+    delete s;
+}
+
+TEST_CASE("TestTimeWarpPooledSend", "testTimeWarp")
+{
+    Rollback<long long> trace(0);
+    TimeWarpSimulation tw(3);
+    SimulationContext::Scope scope(tw.getLP(0));
+    TraceEvt *e = Event::create<TraceEvt>(&trace, 1, 5);
+    REQUIRE( e->isPooled() );
+    REQUIRE_THROWS_AS( tw.getLP(0).send(2, e, 10), TimeWarpSimulation::Exc );
+    REQUIRE( !e->isInQueue() );
+    e->dispose();
+}
+
+// the nodes draw from random variables created without a generator,
+// so they take the generator of their LP; the hops to a node have
+// the index of the node as priority, so that the events with the
+// same time and priority are interchangeable
+namespace {
+
+    class VarNode;
+
+    class VarHop : public Event {
+        VarNode *_dst;
+    public:
+        VarHop(VarNode *n, int prio) : Event(prio), _dst(n) {}
+        virtual void doit();
+    };
+
+    class VarNode : public Entity {
+        UniformVar _next;
+        ExponentialVar _delay;
+    public:
+        vector<VarNode *> *all;
+        int idx;
+        int lp;
+        bool parallel;
+        Rollback<long long> checksum;
+
+        VarNode(int i, int p, vector<VarNode *> *a, bool par) : 
+            Entity("varnode" + to_string(i)), _next(0, 3), _delay(8),
+            all(a), idx(i), lp(p), parallel(par), checksum(0) {}
+
+        void arrive() {
+            Tick now = SIMUL.getTime();
+            checksum = checksum * 31 + (long int) now;
+
+            VarNode *dst = (*all)[(idx + 1 + int(_next.get())) % all->size()];
+            Tick t = now + 1 + Tick(int64_t(_delay.get()));
+            VarHop *h = new VarHop(dst, dst->idx);
+            if (!parallel || dst->lp == lp) h->post(t, true);
+            else TimeWarpLP::current()->send(dst->lp, h, t, true);
+        }
+
+        void newRun() { 
+            checksum = 0; 
+            (new VarHop(this, idx))->post(idx % 5, true); 
+        }
+        void endRun() {}
+    };
+
+    void VarHop::doit() { _dst->arrive(); }
+}
+
+TEST_CASE("TestTimeWarpDefaultGenerator", "testTimeWarp")
+{
+    const int NLP = 3;
+    TimeWarpSimulation tw(NLP);
+    RandomGen *before = RandomVar::getGenerator();
+
+    // the sequential run uses a copy of the generator of each LP
+    // for the nodes of its partition
+    vector<long long> seq;
+    {
+        Simulation sim;
+        SimulationContext::Scope scope(sim);
+        vector<RandomGen> gens;
+        for (int p = 0; p < NLP; ++p) gens.push_back(tw.getLP(p).getGenerator());
+        vector<VarNode *> nodes;
+        for (int i = 0; i < NODES; ++i) {
+            RandomGen *old = RandomVar::changeGenerator(&gens[i % NLP]);
+            nodes.push_back(new VarNode(i, 0, &nodes, false));
+            RandomVar::changeGenerator(old);
+        }
+        sim.initRuns();
+        sim.initSingleRun();
+        sim.run_to(2000);
+        sim.endSingleRun();
+        for (int i = 0; i < NODES; ++i) {
+            seq.push_back(nodes[i]->checksum);
+            delete nodes[i];
+        }
+    }
+
+    vector<VarNode *> nodes;
+    for (int i = 0; i < NODES; ++i) {
+        SimulationContext::Scope scope(tw.getLP(i % NLP));
+        nodes.push_back(new VarNode(i, i % NLP, &nodes, true));
+    }
+    tw.run(2000);
+
+    vector<long long> par;
+    for (int i = 0; i < NODES; ++i) {
+        par.push_back(nodes[i]->checksum);
+        SimulationContext::Scope scope(tw.getLP(nodes[i]->lp));
+        delete nodes[i];
+    }
+    REQUIRE( seq[0] != 0 );
+    REQUIRE( seq == par );
+    REQUIRE( RandomVar::getGenerator() == before );
+}
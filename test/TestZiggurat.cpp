@@ -0,0 +1,117 @@
+#include <cmath>
+#include <vector>
+
+#include <randomgen.hpp>
+#include <randomvar.hpp>
+
+#include "catch.hpp"
+
+using namespace MetaSim;
+using namespace std;
+
+namespace {
+    // chi-square statistic of n values of v in 100 bins of equal
+    // probability, given the cdf of the distribution
+    template<class V, class C>
+    double chiSquare(V &v, C cdf, int n)
+    {
+        const int BINS = 100;
+        vector<int> count(BINS, 0);
+        for (int i = 0; i < n; ++i) {
+            int b = int(cdf(v.get()) * BINS);
+            if (b < 0) b = 0;
+            if (b >= BINS) b = BINS - 1;
+            count[b]++;
+        }
+        double e = double(n) / BINS, chi = 0;
+        for (int b = 0; b < BINS; ++b)
+            chi += (count[b] - e) * (count[b] - e) / e;
+        return chi;
+    }
+
+    double normalCdf(double x) { return 0.5 * erfc(-(x - 2) / 3 / sqrt(2.0)); }
+    double expCdf(double x) { return 1 - exp(-x / 5); }
+}
+
+TEST_CASE("TestZigguratNormal", "testZiggurat")
+{
+    Xoshiro256Gen g(11);
+    NormalVar v(2, 3, &g);
+    REQUIRE( v.getMethod() == RandomVar::FAST );
+
+    // 99 degrees of freedom: the 99.9% quantile is about 149
+    REQUIRE( chiSquare(v, normalCdf, 1000000) < 149 );
+
+    const int N = 2000000;
+    double sum = 0, sum2 = 0;
+    int tail = 0;
+    for (int i = 0; i < N; ++i) {
+        double z = (v.get() - 2) / 3;
+        sum += z;
+        sum2 += z * z;
+        if (fabs(z) > 3.5) tail++;
+    }
+    REQUIRE( fabs(sum / N) < 0.005 );
+    REQUIRE( fabs(sum2 / N - 1) < 0.005 );
+    // P(|Z| > 3.5) = 4.65e-4, that is 930 values
+    REQUIRE( tail > 800 );
+    REQUIRE( tail < 1060 );
+}
+
+TEST_CASE("TestZigguratExponential", "testZiggurat")
+{
+    RandomGen g(3);
+    ExponentialVar v(5, &g);
+    REQUIRE( chiSquare(v, expCdf, 1000000) < 149 );
+
+    const int N = 2000000;
+    double sum = 0;
+    int tail = 0;
+    for (int i = 0; i < N; ++i) {
+        double x = v.get();
+        sum += x;
+        // beyond the bottom layer: P(X > 40) = e^-8
+        if (x > 40) tail++;
+    }
+    REQUIRE( fabs(sum / N - 5) < 0.02 );
+    REQUIRE( tail > 570 );
+    REQUIRE( tail < 770 );
+}
+
+TEST_CASE("TestLegacyMethod", "testZiggurat")
+{
+    RandomGen g1(7), g2(7);
+    ExponentialVar e(2, &g1);
+    UniformVar u(0, 1, &g2);
+    e.setMethod(RandomVar::LEGACY);
+    bool ok = true;
+    for (int i = 0; i < 1000; ++i) ok = ok && (e.get() == -log(u.get()) * 2);
+    REQUIRE( ok );
+
+    // the default of the new variables
+    RandomVar::setDefaultMethod(RandomVar::LEGACY);
+    NormalVar n1(0, 1, &g1);
+    RandomVar::setDefaultMethod(RandomVar::FAST);
+    NormalVar n2(0, 1, &g1);
+    REQUIRE( n1.getMethod() == RandomVar::LEGACY );
+    REQUIRE( n2.getMethod() == RandomVar::FAST );
+
+#ifndef CEPHES_LIB
+    // the polar method, as in the previous versions
+    RandomGen g3(9), g4(9);
+    NormalVar a(1, 2, &g3);
+    UniformVar b(0, 1, &g4);
+    a.setMethod(RandomVar::LEGACY);
+    for (int i = 0; i < 500; ++i) {
+        double t1, t2, r;
+        do {
+            t1 = 2 * b.get() - 1;
+            t2 = 2 * b.get() - 1;
+            r = t1 * t1 + t2 * t2;
+        } while (r >= 1);
+        r = sqrt(-2 * log(r) / r) * 2;
+        ok = ok && (a.get() == 1 + t2 * r) && (a.get() == 1 + t1 * r);
+    }
+    REQUIRE( ok );
+#endif
+}